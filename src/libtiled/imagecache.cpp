@@ -0,0 +1,570 @@
+/*
+ * imagecache.cpp
+ * Copyright 2026, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of libtiled.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "imagecache.h"
+
+#include <QBitmap>
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QStringList>
+#include <QTemporaryFile>
+#include <QVector>
+
+#include <cstring>
+
+using namespace Tiled;
+
+namespace {
+
+/**
+ * The default maximum size of the disk cache, in bytes.
+ */
+const qint64 defaultDiskCacheSizeLimit = qint64(512) * 1024 * 1024;
+
+struct CachedImages
+{
+    CachedImages()
+        : diskCacheSizeLimit(defaultDiskCacheSizeLimit)
+    {}
+
+    QMutex mutex;
+    QHash<QString, QImage> images;
+    QString diskCacheDirectory;
+    qint64 diskCacheSizeLimit;
+};
+
+typedef QHash<QString, QPixmap> CachedPixmaps;
+
+Q_GLOBAL_STATIC(CachedImages, cachedImages)
+Q_GLOBAL_STATIC(CachedPixmaps, cachedPixmaps)
+
+/**
+ * Returns the key identifying the current contents of the file, or an empty
+ * string when the file does not exist.
+ */
+QString fileKey(const QString &fileName)
+{
+    const QFileInfo info(fileName);
+    const QString path = info.canonicalFilePath();
+    if (path.isEmpty())
+        return QString();
+
+    return path + QLatin1Char('\n')
+            + QString::number(info.lastModified().toMSecsSinceEpoch())
+            + QLatin1Char('\n')
+            + QString::number(info.size());
+}
+
+/**
+ * The header of an image in the disk cache. The pixel data follows after the
+ * color table, at the next multiple of 16 bytes.
+ *
+ * The SHA-1 hash of the source file is stored as well, since its
+ * modification time and size are not enough to tell it apart from an
+ * earlier version on file systems with coarse timestamps.
+ */
+struct DiskImageHeader
+{
+    char magic[8];
+    quint32 version;
+    qint32 width;
+    qint32 height;
+    qint32 format;
+    qint32 bytesPerLine;
+    qint32 colorCount;
+    char sourceHash[20];
+};
+
+const char diskImageMagic[8] = { 'T', 'I', 'L', 'E', 'D', 'I', 'M', 'G' };
+const quint32 diskImageVersion = 2;
+
+qint64 diskImageDataOffset(int colorCount)
+{
+    const qint64 size = sizeof(DiskImageHeader)
+            + qint64(colorCount) * sizeof(QRgb);
+    return (size + 15) & ~qint64(15);
+}
+
+/**
+ * Returns the minimum number of bytes needed to store a line of \a width
+ * pixels in the given \a format.
+ */
+qint64 minimumBytesPerLine(int width, QImage::Format format)
+{
+    const int depth = QImage(1, 1, format).depth();
+    return (qint64(width) * depth + 7) / 8;
+}
+
+/**
+ * Returns the prefix shared by the disk cache files of all versions of the
+ * file with the given canonical \a path.
+ */
+QString diskCachePrefix(const QString &path)
+{
+    const QByteArray hash =
+            QCryptographicHash::hash(path.toUtf8(), QCryptographicHash::Sha1);
+    return QString::fromLatin1(hash.toHex()) + QLatin1Char('-');
+}
+
+/**
+ * Returns the name of the disk cache file for the current version of the
+ * file \a fileName, or an empty string when it does not exist.
+ */
+QString diskCacheFileName(const QString &fileName)
+{
+    const QFileInfo info(fileName);
+    const QString path = info.canonicalFilePath();
+    if (path.isEmpty())
+        return QString();
+
+    return diskCachePrefix(path)
+            + QString::number(info.lastModified().toMSecsSinceEpoch())
+            + QLatin1Char('-')
+            + QString::number(info.size())
+            + QLatin1String(".img");
+}
+
+/**
+ * Returns the SHA-1 hash of the contents of the file \a fileName, or an
+ * empty byte array when it can't be read. Reading the file is still much
+ * cheaper than decoding it.
+ */
+QByteArray sourceHash(const QString &fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return QByteArray();
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    while (!file.atEnd()) {
+        const QByteArray block = file.read(64 * 1024);
+        if (block.isEmpty())
+            return QByteArray();
+        hash.addData(block);
+    }
+
+    return hash.result();
+}
+
+/**
+ * Reads an image from the disk cache. The file is mapped into memory to
+ * avoid an extra read buffer, but the pixels are copied out of the mapping
+ * before returning, so no mapping is kept alive. What is saved is the time
+ * needed to decode the image, not the memory it uses.
+ *
+ * The image is only returned when it was created from a source file with
+ * the given \a hash.
+ */
+QImage readDiskImage(const QString &cacheFileName, const QByteArray &hash)
+{
+    QFile file(cacheFileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return QImage();
+
+    const qint64 size = file.size();
+    if (size < qint64(sizeof(DiskImageHeader)))
+        return QImage();
+
+    uchar *data = file.map(0, size);
+    if (!data)
+        return QImage();
+
+    DiskImageHeader header;
+    std::memcpy(&header, data, sizeof(DiskImageHeader));
+
+    QImage image;
+
+    if (std::memcmp(header.magic, diskImageMagic, sizeof(diskImageMagic)) == 0
+            && header.version == diskImageVersion
+            && header.width > 0 && header.height > 0
+            && header.format > QImage::Format_Invalid
+            && header.format < QImage::NImageFormats
+            && header.bytesPerLine > 0
+            && header.bytesPerLine >= minimumBytesPerLine(
+                   header.width, QImage::Format(header.format))
+            && header.colorCount >= 0 && header.colorCount <= 256
+            && hash.size() == int(sizeof(header.sourceHash))
+            && std::memcmp(header.sourceHash, hash.constData(),
+                           sizeof(header.sourceHash)) == 0) {
+        const qint64 offset = diskImageDataOffset(header.colorCount);
+
+        // Anything else than exactly the expected amount of pixel data
+        // means the file was truncated or not written by this version
+        if (size == offset + qint64(header.bytesPerLine) * header.height) {
+            const QImage mapped(data + offset,
+                                header.width, header.height,
+                                header.bytesPerLine,
+                                QImage::Format(header.format));
+
+            // The mapped data is only valid until the file is unmapped
+            image = mapped.copy();
+
+            if (header.colorCount > 0) {
+                QVector<QRgb> colors(header.colorCount);
+                std::memcpy(colors.data(), data + sizeof(DiskImageHeader),
+                            header.colorCount * sizeof(QRgb));
+                image.setColorTable(colors);
+            }
+        }
+    }
+
+    file.unmap(data);
+    return image;
+}
+
+/**
+ * Writes the \a image to the disk cache, replacing the cache files of older
+ * versions of the same file.
+ */
+void writeDiskImage(const QString &directory, const QString &cacheFileName,
+                    const QImage &image, const QByteArray &hash)
+{
+    if (hash.size() != int(sizeof(DiskImageHeader().sourceHash)))
+        return;
+
+    DiskImageHeader header;
+    std::memcpy(header.magic, diskImageMagic, sizeof(diskImageMagic));
+    header.version = diskImageVersion;
+    header.width = image.width();
+    header.height = image.height();
+    header.format = image.format();
+    header.bytesPerLine = image.bytesPerLine();
+    header.colorCount = image.colorCount();
+    std::memcpy(header.sourceHash, hash.constData(), sizeof(header.sourceHash));
+
+    const QVector<QRgb> colors = image.colorTable();
+    const qint64 colorsSize = colors.size() * sizeof(QRgb);
+    const qint64 headerSize = sizeof(DiskImageHeader) + colorsSize;
+    const QByteArray padding(int(diskImageDataOffset(header.colorCount)
+                                 - headerSize), '\0');
+
+    // Written to a temporary file first, so that other threads or processes
+    // never read an incomplete image
+    QTemporaryFile file(directory + QLatin1String("/XXXXXX.tmp"));
+    file.setAutoRemove(false);
+    if (!file.open())
+        return;
+
+    bool ok = file.write(reinterpret_cast<const char*>(&header),
+                         sizeof(DiskImageHeader))
+            == qint64(sizeof(DiskImageHeader));
+    ok = ok && file.write(reinterpret_cast<const char*>(colors.constData()),
+                          colorsSize) == colorsSize;
+    ok = ok && file.write(padding) == padding.size();
+    ok = ok && file.write(reinterpret_cast<const char*>(image.constBits()),
+                          image.byteCount()) == image.byteCount();
+    file.close();
+
+    const QString tempFileName = file.fileName();
+    if (!ok || !QFile::rename(tempFileName, cacheFileName)) {
+        QFile::remove(tempFileName);
+        return;
+    }
+
+    // Remove the images of previous versions of this file
+    const QFileInfo cacheFileInfo(cacheFileName);
+    const QString prefix = cacheFileInfo.fileName().section(QLatin1Char('-'),
+                                                            0, 0);
+    QDir dir(directory);
+    const QStringList oldFiles =
+            dir.entryList(QStringList(prefix + QLatin1String("-*.img")),
+                          QDir::Files);
+    foreach (const QString &oldFile, oldFiles)
+        if (oldFile != cacheFileInfo.fileName())
+            dir.remove(oldFile);
+}
+
+/**
+ * Returns when the disk cache file was last used. Reading a file updates its
+ * access time, though some file systems only do so once in a while.
+ */
+QDateTime lastUsed(const QFileInfo &info)
+{
+    return qMax(info.lastRead(), info.lastModified());
+}
+
+bool lessRecentlyUsed(const QFileInfo &a, const QFileInfo &b)
+{
+    return lastUsed(a) < lastUsed(b);
+}
+
+/**
+ * Removes the least recently used images from the disk cache until it uses
+ * at most \a limit bytes.
+ */
+void trimDiskCache(const QString &directory, qint64 limit)
+{
+    QFileInfoList files =
+            QDir(directory).entryInfoList(QStringList(QLatin1String("*.img")),
+                                          QDir::Files);
+
+    qint64 size = 0;
+    foreach (const QFileInfo &info, files)
+        size += info.size();
+
+    if (size <= limit)
+        return;
+
+    qSort(files.begin(), files.end(), lessRecentlyUsed);
+
+    foreach (const QFileInfo &info, files) {
+        if (size <= limit)
+            break;
+        if (QFile::remove(info.filePath()))
+            size -= info.size();
+    }
+}
+
+QString pixmapKey(const QString &fileKey, const QColor &transparentColor)
+{
+    if (!transparentColor.isValid())
+        return fileKey;
+    return fileKey + QLatin1Char('\n') + transparentColor.name();
+}
+
+QPixmap createPixmap(const QImage &image, const QColor &transparentColor)
+{
+    if (image.isNull())
+        return QPixmap();
+
+    QPixmap pixmap = QPixmap::fromImage(image);
+
+    if (transparentColor.isValid()) {
+        const QImage mask = image.createMaskFromColor(transparentColor.rgb());
+        pixmap.setMask(QBitmap::fromImage(mask));
+    }
+
+    return pixmap;
+}
+
+bool isCachedImage(const QString &fileKey, const QImage &image)
+{
+    CachedImages *cache = cachedImages();
+    QMutexLocker locker(&cache->mutex);
+    return cache->images.value(fileKey).cacheKey() == image.cacheKey();
+}
+
+void purgeImage(const QString &fileKey)
+{
+    CachedImages *cache = cachedImages();
+    QMutexLocker locker(&cache->mutex);
+    QHash<QString, QImage>::iterator it = cache->images.find(fileKey);
+    if (it != cache->images.end() && it.value().isDetached())
+        cache->images.erase(it);
+}
+
+} // anonymous namespace
+
+QImage ImageCache::loadImage(const QString &fileName)
+{
+    const QString key = fileKey(fileName);
+    if (key.isEmpty())
+        return QImage(fileName);
+
+    CachedImages *cache = cachedImages();
+    {
+        QMutexLocker locker(&cache->mutex);
+        QHash<QString, QImage>::const_iterator it = cache->images.find(key);
+        if (it != cache->images.constEnd())
+            return it.value();
+    }
+
+    QString diskCacheDirectory;
+    qint64 diskCacheSizeLimit;
+    {
+        QMutexLocker locker(&cache->mutex);
+        diskCacheDirectory = cache->diskCacheDirectory;
+        diskCacheSizeLimit = cache->diskCacheSizeLimit;
+    }
+
+    // Decode outside of the lock, so that different images can be decoded
+    // in parallel
+    QImage image;
+    QString cacheFileName;
+    QByteArray hash;
+
+    if (!diskCacheDirectory.isEmpty()) {
+        const QString name = diskCacheFileName(fileName);
+        if (!name.isEmpty()) {
+            cacheFileName = diskCacheDirectory + QLatin1Char('/') + name;
+            hash = sourceHash(fileName);
+            image = readDiskImage(cacheFileName, hash);
+        }
+    }
+
+    if (image.isNull()) {
+        image = QImage(fileName);
+        if (image.isNull())
+            return image;
+
+        if (!cacheFileName.isEmpty()) {
+            writeDiskImage(diskCacheDirectory, cacheFileName, image, hash);
+            trimDiskCache(diskCacheDirectory, diskCacheSizeLimit);
+        }
+    }
+
+    QMutexLocker locker(&cache->mutex);
+
+    // Another thread may have decoded the same image in the meantime
+    QHash<QString, QImage>::const_iterator it = cache->images.find(key);
+    if (it != cache->images.constEnd())
+        return it.value();
+
+    cache->images.insert(key, image);
+    return image;
+}
+
+QPixmap ImageCache::loadPixmap(const QString &fileName,
+                               const QColor &transparentColor,
+                               const QImage &image)
+{
+    const QString key = fileKey(fileName);
+    if (key.isEmpty()) {
+        if (image.isNull())
+            return createPixmap(QImage(fileName), transparentColor);
+        return createPixmap(image, transparentColor);
+    }
+
+    // Any other image may differ from the file, for example because it was
+    // changed in memory, so neither the cache nor the file may be used
+    if (!image.isNull() && !isCachedImage(key, image))
+        return createPixmap(image, transparentColor);
+
+    CachedPixmaps *pixmaps = cachedPixmaps();
+    const QString keyWithColor = pixmapKey(key, transparentColor);
+    CachedPixmaps::const_iterator it = pixmaps->find(keyWithColor);
+    if (it != pixmaps->constEnd())
+        return it.value();
+
+    QPixmap pixmap = createPixmap(image.isNull() ? loadImage(fileName)
+                                                 : image,
+                                  transparentColor);
+    if (pixmap.isNull())
+        return pixmap;
+
+    // The pixmaps need to be released while the application still exists
+    static bool clearOnExit = false;
+    if (!clearOnExit) {
+        qAddPostRoutine(ImageCache::clear);
+        clearOnExit = true;
+    }
+
+    pixmaps->insert(keyWithColor, pixmap);
+
+    // Once the pixmap exists, the decoded image is only kept when it is
+    // still used elsewhere
+    purgeImage(key);
+
+    return pixmap;
+}
+
+bool ImageCache::containsPixmap(const QString &fileName,
+                                const QColor &transparentColor)
+{
+    const QString key = fileKey(fileName);
+    if (key.isEmpty())
+        return false;
+
+    return cachedPixmaps()->contains(pixmapKey(key, transparentColor));
+}
+
+void ImageCache::purge()
+{
+    CachedPixmaps *pixmaps = cachedPixmaps();
+    CachedPixmaps::iterator it = pixmaps->begin();
+    while (it != pixmaps->end()) {
+        if (it.value().isDetached())
+            it = pixmaps->erase(it);
+        else
+            ++it;
+    }
+
+    CachedImages *cache = cachedImages();
+    QMutexLocker locker(&cache->mutex);
+    QHash<QString, QImage>::iterator imageIt = cache->images.begin();
+    while (imageIt != cache->images.end()) {
+        if (imageIt.value().isDetached())
+            imageIt = cache->images.erase(imageIt);
+        else
+            ++imageIt;
+    }
+}
+
+void ImageCache::setDiskCacheDirectory(const QString &path)
+{
+    if (!path.isEmpty())
+        QDir().mkpath(path);
+
+    CachedImages *cache = cachedImages();
+    QMutexLocker locker(&cache->mutex);
+    cache->diskCacheDirectory = path;
+}
+
+QString ImageCache::diskCacheDirectory()
+{
+    CachedImages *cache = cachedImages();
+    QMutexLocker locker(&cache->mutex);
+    return cache->diskCacheDirectory;
+}
+
+void ImageCache::setDiskCacheSizeLimit(qint64 bytes)
+{
+    CachedImages *cache = cachedImages();
+    QString directory;
+    {
+        QMutexLocker locker(&cache->mutex);
+        cache->diskCacheSizeLimit = bytes;
+        directory = cache->diskCacheDirectory;
+    }
+
+    if (!directory.isEmpty())
+        trimDiskCache(directory, bytes);
+}
+
+qint64 ImageCache::diskCacheSizeLimit()
+{
+    CachedImages *cache = cachedImages();
+    QMutexLocker locker(&cache->mutex);
+    return cache->diskCacheSizeLimit;
+}
+
+void ImageCache::clear()
+{
+    cachedPixmaps()->clear();
+
+    CachedImages *cache = cachedImages();
+    QMutexLocker locker(&cache->mutex);
+    cache->images.clear();
+}
@@ -0,0 +1,127 @@
+/*
+ * imagecache.h
+ * Copyright 2026, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of libtiled.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef IMAGECACHE_H
+#define IMAGECACHE_H
+
+#include "tiled_global.h"
+
+#include <QColor>
+#include <QImage>
+#include <QPixmap>
+#include <QString>
+
+namespace Tiled {
+
+/**
+ * A process-wide cache of decoded images, so that an image used by several
+ * tilesets, maps or image layers is only decoded and uploaded once.
+ *
+ * Entries are keyed by the canonical path of the file along with its
+ * modification time and size, so a changed file is never served from the
+ * cache. Pixmaps are additionally keyed by the transparent color that was
+ * applied to them.
+ *
+ * The cache is reference counted through the implicit sharing of QImage and
+ * QPixmap: entries that are no longer used anywhere else are removed by
+ * purge().
+ *
+ * Optionally, decoded images are also stored uncompressed in a directory on
+ * disk, from which they are read back the next time the same file is loaded,
+ * instead of decoding it again. The least recently used images are removed
+ * when the directory grows beyond its size limit.
+ */
+class TILEDSHARED_EXPORT ImageCache
+{
+public:
+    /**
+     * Returns the image stored in the file \a fileName, decoding it only
+     * when it is not already in the cache. This function is thread-safe.
+     */
+    static QImage loadImage(const QString &fileName);
+
+    /**
+     * Returns the pixmap for the file \a fileName with the given
+     * \a transparentColor masked out. Should only be called from the GUI
+     * thread.
+     *
+     * When \a image is given, it is used instead of decoding the file. The
+     * cache is only used when the image was returned by loadImage(), since
+     * any other image is not guaranteed to match the contents of the file.
+     */
+    static QPixmap loadPixmap(const QString &fileName,
+                              const QColor &transparentColor = QColor(),
+                              const QImage &image = QImage());
+
+    /**
+     * Returns whether a pixmap for the file \a fileName with the given
+     * \a transparentColor is currently in the cache.
+     */
+    static bool containsPixmap(const QString &fileName,
+                               const QColor &transparentColor = QColor());
+
+    /**
+     * Removes the images and pixmaps that are not referenced outside of the
+     * cache anymore.
+     */
+    static void purge();
+
+    /**
+     * Removes all entries from the cache.
+     */
+    static void clear();
+
+    /**
+     * Sets the directory in which decoded images are stored, so that they
+     * don't need to be decoded again in later sessions. An empty \a path,
+     * which is the default, disables the disk cache.
+     */
+    static void setDiskCacheDirectory(const QString &path);
+
+    /**
+     * Returns the directory of the disk cache, or an empty string when the
+     * disk cache is disabled.
+     */
+    static QString diskCacheDirectory();
+
+    /**
+     * Sets the maximum number of bytes used by the images in the disk cache.
+     * When a new image makes the cache grow beyond this size, the least
+     * recently used images are removed. Defaults to 512 MiB.
+     */
+    static void setDiskCacheSizeLimit(qint64 bytes);
+
+    /**
+     * Returns the maximum number of bytes used by the disk cache.
+     */
+    static qint64 diskCacheSizeLimit();
+};
+
+} // namespace Tiled
+
+#endif // IMAGECACHE_H
@@ -28,10 +28,9 @@
  */
 
 #include "imagelayer.h"
+#include "imagecache.h"
 #include "map.h"
 
-#include <QBitmap>
-
 using namespace Tiled;
 
 ImageLayer::ImageLayer(const QString &name, int x, int y, int width, int height):
@@ -58,16 +57,17 @@ bool ImageLayer::loadFromImage(const QImage &image, const QString &fileName)
         return false;
     }
 
-    mImage = QPixmap::fromImage(image);
-
-    if (mTransparentColor.isValid()) {
-        const QImage mask = image.createMaskFromColor(mTransparentColor.rgb());
-        mImage.setMask(QBitmap::fromImage(mask));
-    }
-
+    mImage = ImageCache::loadPixmap(fileName, mTransparentColor, image);
     return true;
 }
 
+bool ImageLayer::loadFromImage(const QString &fileName)
+{
+    mImageSource = fileName;
+    mImage = ImageCache::loadPixmap(fileName, mTransparentColor);
+    return !mImage.isNull();
+}
+
 bool ImageLayer::isEmpty() const
 {
     return mImage.isNull();
@@ -119,6 +119,14 @@ public:
      */
     bool loadFromImage(const QImage &image, const QString &fileName);
 
+    /**
+     * Loads this layer from the image file \a fileName, sharing the pixmap
+     * with other users of the same image through the ImageCache.
+     *
+     * @see loadFromImage(const QImage &, const QString &)
+     */
+    bool loadFromImage(const QString &fileName);
+
     /**
      * Returns true if no image source has been set.
      */
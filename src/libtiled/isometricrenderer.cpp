@@ -38,6 +38,35 @@
 
 using namespace Tiled;
 
+namespace {
+
+/**
+ * A cell that is about to be drawn as part of a row of tiles.
+ */
+struct RowCell
+{
+    const Cell *cell;
+    int x;
+};
+
+/**
+ * Orders cells so that those sharing a tileset, and within the tileset those
+ * sharing a tile, end up next to each other.
+ */
+bool rowCellLessThan(const RowCell &a, const RowCell &b)
+{
+    const Tile *tileA = a.cell->tile;
+    const Tile *tileB = b.cell->tile;
+
+    if (tileA->tileset() != tileB->tileset())
+        return tileA->tileset() < tileB->tileset();
+    if (tileA->id() != tileB->id())
+        return tileA->id() < tileB->id();
+    return a.x < b.x;
+}
+
+} // anonymous namespace
+
 QSize IsometricRenderer::mapSize() const
 {
     // Map width and height contribute equally in both directions
@@ -70,7 +99,7 @@ QRectF IsometricRenderer::boundingRect(const MapObject *object) const
     if (!object->cell().isEmpty()) {
         const QPointF bottomCenter = tileToPixelCoords(object->position());
         const Tile *tile = object->cell().tile;
-        const QSize imgSize = tile->image().size();
+        const QSize imgSize = tile->size();
         const QPoint tileOffset = tile->tileset()->tileOffset();
         return QRectF(bottomCenter.x() + tileOffset.x() - imgSize.width() / 2,
                       bottomCenter.y() + tileOffset.y() - imgSize.height(),
@@ -221,25 +250,74 @@ void IsometricRenderer::drawTileLayer(QPainter *painter,
     // Determine whether the current row is shifted half a tile to the right
     bool shifted = inUpperHalf ^ inLeftHalf;
 
+    // Each row of tiles is a diagonal through the layer, along which the sum
+    // of the tile coordinates is constant. Rows beyond the last diagonal
+    // can't contain any tiles.
+    const int layerWidth = layer->width();
+    const int layerHeight = layer->height();
+    const int lastDiagonal = layerWidth + layerHeight - 2;
+
+    /* The rows need to be drawn from back to front, but when the tiles can't
+     * overlap their horizontal neighbours, the order within a row doesn't
+     * matter. In that case the cells of each row are sorted by tile, so that
+     * the CellRenderer can draw them in larger batches.
+     */
+    const QMargins layerMargins = layer->drawMargins();
+    const bool sortRows = layerMargins.left() <= 0 &&
+                          layerMargins.right() <= tileWidth;
+    QVector<RowCell> rowCells;
+
     CellRenderer renderer(painter);
 
     for (int y = startPos.y(); y - tileHeight < rect.bottom();
          y += tileHeight / 2)
     {
-        QPoint columnItr = rowItr;
+        const int diagonal = rowItr.x() + rowItr.y();
+        if (diagonal > lastDiagonal)
+            break;
 
-        for (int x = startPos.x(); x < rect.right(); x += tileWidth) {
-            if (layer->contains(columnItr)) {
-                const Cell &cell = layer->cellAt(columnItr);
-                if (!cell.isEmpty()) {
-                    renderer.render(cell, QPointF(x, y),
+        if (diagonal >= 0) {
+            const int startX = startPos.x();
+            const int remaining = rect.right() - startX;
+            const int columns = remaining > 0
+                    ? (remaining + tileWidth - 1) / tileWidth
+                    : 0;
+
+            /* Clip the row to the columns for which the tile coordinates
+             * (rowItr.x + i, rowItr.y - i) fall within the layer, so that no
+             * time is spent on the area outside of the layer.
+             */
+            const int first = qMax(0, qMax(-rowItr.x(),
+                                           rowItr.y() - layerHeight + 1));
+            const int last = qMin(columns - 1,
+                                  qMin(layerWidth - 1 - rowItr.x(),
+                                       rowItr.y()));
+
+            for (int i = first; i <= last; ++i) {
+                const Cell &cell = layer->cellAt(rowItr.x() + i,
+                                                 rowItr.y() - i);
+                if (cell.isEmpty())
+                    continue;
+
+                if (sortRows) {
+                    const RowCell rowCell = { &cell, startX + i * tileWidth };
+                    rowCells.append(rowCell);
+                } else {
+                    renderer.render(cell, QPointF(startX + i * tileWidth, y),
                                     CellRenderer::BottomLeft);
                 }
             }
 
-            // Advance to the next column
-            ++columnItr.rx();
-            --columnItr.ry();
+            if (!rowCells.isEmpty()) {
+                qSort(rowCells.begin(), rowCells.end(), rowCellLessThan);
+
+                foreach (const RowCell &rowCell, rowCells) {
+                    renderer.render(*rowCell.cell, QPointF(rowCell.x, y),
+                                    CellRenderer::BottomLeft);
+                }
+
+                rowCells.resize(0);
+            }
         }
 
         // Advance to the next row
@@ -46,6 +46,10 @@ win32 {
     LIBS += -lz
 }
 
+greaterThan(QT_MAJOR_VERSION, 4) {
+    QT += concurrent
+}
+
 DEFINES += QT_NO_CAST_FROM_ASCII \
     QT_NO_CAST_TO_ASCII
 DEFINES += TILED_LIBRARY
@@ -53,11 +57,13 @@ contains(QT_CONFIG, reduce_exports): CONFIG += hide_symbols
 
 SOURCES += compression.cpp \
     gidmapper.cpp \
+    imagecache.cpp \
     imagelayer.cpp \
     isometricrenderer.cpp \
     layer.cpp \
     map.cpp \
     mapobject.cpp \
+    mapobjectindex.cpp \
     mapreader.cpp \
     maprenderer.cpp \
     mapwriter.cpp \
@@ -67,14 +73,17 @@ SOURCES += compression.cpp \
     staggeredrenderer.cpp \
     tile.cpp \
     tilelayer.cpp \
+    tileregion.cpp \
     tileset.cpp
 HEADERS += compression.h \
     gidmapper.h \
+    imagecache.h \
     imagelayer.h \
     isometricrenderer.h \
     layer.h \
     map.h \
     mapobject.h \
+    mapobjectindex.h \
     mapreader.h \
     mapreaderinterface.h \
     maprenderer.h \
@@ -90,6 +99,7 @@ HEADERS += compression.h \
     tiled.h \
     tiled_global.h \
     tilelayer.h \
+    tileregion.h \
     tileset.h \
     logginginterface.h
 
@@ -29,6 +29,8 @@
 
 #include "mapobject.h"
 
+#include "objectgroup.h"
+
 using namespace Tiled;
 
 MapObject::MapObject():
@@ -56,6 +58,60 @@ MapObject::MapObject(const QString &name, const QString &type,
 {
 }
 
+void MapObject::setPosition(const QPointF &pos)
+{
+    mPos = pos;
+    geometryChanged();
+}
+
+void MapObject::setX(qreal x)
+{
+    mPos.setX(x);
+    geometryChanged();
+}
+
+void MapObject::setY(qreal y)
+{
+    mPos.setY(y);
+    geometryChanged();
+}
+
+void MapObject::setSize(const QSizeF &size)
+{
+    mSize = size;
+    geometryChanged();
+}
+
+void MapObject::setWidth(qreal width)
+{
+    mSize.setWidth(width);
+    geometryChanged();
+}
+
+void MapObject::setHeight(qreal height)
+{
+    mSize.setHeight(height);
+    geometryChanged();
+}
+
+void MapObject::setPolygon(const QPolygonF &polygon)
+{
+    mPolygon = polygon;
+    geometryChanged();
+}
+
+void MapObject::setCell(const Cell &cell)
+{
+    mCell = cell;
+    geometryChanged();
+}
+
+void MapObject::setRotation(qreal rotation)
+{
+    mRotation = rotation;
+    geometryChanged();
+}
+
 void MapObject::flip(FlipDirection direction)
 {
     if (!mCell.isEmpty()) {
@@ -75,6 +131,8 @@ void MapObject::flip(FlipDirection direction)
             for (int i = 0; i < mPolygon.size(); ++i)
                 mPolygon[i].setY(center2.y() - mPolygon[i].y());
         }
+
+        geometryChanged();
     }
 }
 
@@ -88,3 +146,13 @@ MapObject *MapObject::clone() const
     o->setRotation(mRotation);
     return o;
 }
+
+/**
+ * Lets the object group know about changes to the position, size or shape of
+ * this object, so it can keep its spatial index up to date.
+ */
+void MapObject::geometryChanged()
+{
+    if (mObjectGroup)
+        mObjectGroup->objectGeometryChanged(this);
+}
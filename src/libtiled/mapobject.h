@@ -105,7 +105,7 @@ public:
     /**
      * Sets the position of this object.
      */
-    void setPosition(const QPointF &pos) { mPos = pos; }
+    void setPosition(const QPointF &pos);
 
     /**
      * Returns the x position of this object.
@@ -115,7 +115,7 @@ public:
     /**
      * Sets the x position of this object.
      */
-    void setX(qreal x) { mPos.setX(x); }
+    void setX(qreal x);
 
     /**
      * Returns the y position of this object.
@@ -125,7 +125,7 @@ public:
     /**
      * Sets the x position of this object.
      */
-    void setY(qreal y) { mPos.setY(y); }
+    void setY(qreal y);
 
     /**
      * Returns the size of this object.
@@ -135,7 +135,7 @@ public:
     /**
      * Sets the size of this object.
      */
-    void setSize(const QSizeF &size) { mSize = size; }
+    void setSize(const QSizeF &size);
 
     void setSize(qreal width, qreal height)
     { setSize(QSizeF(width, height)); }
@@ -148,7 +148,7 @@ public:
     /**
      * Sets the width of this object.
      */
-    void setWidth(qreal width) { mSize.setWidth(width); }
+    void setWidth(qreal width);
 
     /**
      * Returns the height of this object.
@@ -158,7 +158,7 @@ public:
     /**
      * Sets the height of this object.
      */
-    void setHeight(qreal height) { mSize.setHeight(height); }
+    void setHeight(qreal height);
 
     /**
      * Sets the polygon associated with this object. The polygon is only used
@@ -166,7 +166,7 @@ public:
      *
      * \sa setShape()
      */
-    void setPolygon(const QPolygonF &polygon) { mPolygon = polygon; }
+    void setPolygon(const QPolygonF &polygon);
 
     /**
      * Returns the polygon associated with this object. Returns an empty
@@ -195,7 +195,7 @@ public:
      *
      * \warning The object shape is ignored for tile objects!
      */
-    void setCell(const Cell &cell) { mCell = cell; }
+    void setCell(const Cell &cell);
 
     /**
      * Returns the tile associated with this object.
@@ -217,7 +217,7 @@ public:
     /**
      * Sets the rotation of the object
      */
-    void setRotation(qreal rotation) { mRotation = rotation; }
+    void setRotation(qreal rotation);
 
     /**
      * Returns the rotation of the object.
@@ -240,6 +240,8 @@ public:
     MapObject *clone() const;
 
 private:
+    void geometryChanged();
+
     QString mName;
     QString mType;
     QPointF mPos;
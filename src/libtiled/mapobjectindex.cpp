@@ -0,0 +1,272 @@
+/*
+ * mapobjectindex.cpp
+ * Copyright 2026, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of libtiled.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "mapobjectindex.h"
+
+#include "mapobject.h"
+
+#include <QLineF>
+
+#include <cmath>
+
+using namespace Tiled;
+
+/**
+ * The size of the cells of the index grid, in tiles.
+ */
+static const qreal CellSize = 4;
+
+/**
+ * Objects covering more cells than this are not stored in the grid.
+ */
+static const qint64 MaxCellsPerObject = 256;
+
+namespace {
+
+struct OrderedObject
+{
+    int order;
+    MapObject *object;
+
+    bool operator<(const OrderedObject &other) const
+    { return order < other.order; }
+};
+
+/**
+ * Like QRectF::intersects, but also considers rectangles without area, which
+ * is needed for point objects.
+ */
+bool touches(const QRectF &a, const QRectF &b)
+{
+    return a.left() <= b.right() && b.left() <= a.right() &&
+            a.top() <= b.bottom() && b.top() <= a.bottom();
+}
+
+} // anonymous namespace
+
+MapObjectIndex::MapObjectIndex()
+{
+}
+
+void MapObjectIndex::insert(MapObject *object, int order)
+{
+    Q_ASSERT(!mEntries.contains(object));
+
+    Entry entry;
+    entry.bounds = indexBounds(object);
+    entry.cells = cellsForBounds(entry.bounds);
+    entry.order = order;
+    entry.large = qint64(entry.cells.width()) * entry.cells.height()
+            > MaxCellsPerObject;
+
+    addToCells(object, entry);
+    mEntries.insert(object, entry);
+}
+
+void MapObjectIndex::remove(MapObject *object)
+{
+    QHash<MapObject*, Entry>::iterator it = mEntries.find(object);
+    if (it == mEntries.end())
+        return;
+
+    removeFromCells(object, it.value());
+    mEntries.erase(it);
+}
+
+void MapObjectIndex::update(MapObject *object)
+{
+    QHash<MapObject*, Entry>::iterator it = mEntries.find(object);
+    if (it == mEntries.end())
+        return;
+
+    Entry &entry = it.value();
+    const QRectF bounds = indexBounds(object);
+    if (bounds == entry.bounds)
+        return;
+
+    const QRect cells = cellsForBounds(bounds);
+    const bool large = qint64(cells.width()) * cells.height()
+            > MaxCellsPerObject;
+
+    if (cells != entry.cells || large != entry.large) {
+        removeFromCells(object, entry);
+        entry.cells = cells;
+        entry.large = large;
+        addToCells(object, entry);
+    }
+
+    entry.bounds = bounds;
+}
+
+void MapObjectIndex::setOrder(MapObject *object, int order)
+{
+    QHash<MapObject*, Entry>::iterator it = mEntries.find(object);
+    if (it != mEntries.end())
+        it.value().order = order;
+}
+
+void MapObjectIndex::clear()
+{
+    mEntries.clear();
+    mCells.clear();
+    mLargeObjects.clear();
+}
+
+QList<MapObject*> MapObjectIndex::objectsIntersecting(const QRectF &rect) const
+{
+    const QRectF r = rect.normalized();
+    const QRect cells = cellsForBounds(r);
+    const qint64 cellCount = qint64(cells.width()) * cells.height();
+
+    QVector<OrderedObject> found;
+
+    if (cellCount > mCells.size()) {
+        // Checking all objects is cheaper than looking at each cell
+        QHash<MapObject*, Entry>::const_iterator it = mEntries.constBegin();
+        QHash<MapObject*, Entry>::const_iterator it_end = mEntries.constEnd();
+        for (; it != it_end; ++it) {
+            if (touches(it.value().bounds, r)) {
+                const OrderedObject o = { it.value().order, it.key() };
+                found.append(o);
+            }
+        }
+    } else {
+        for (int y = cells.top(); y <= cells.bottom(); ++y) {
+            for (int x = cells.left(); x <= cells.right(); ++x) {
+                QHash<quint64, QVector<MapObject*> >::const_iterator cell =
+                        mCells.constFind(cellKey(x, y));
+                if (cell == mCells.constEnd())
+                    continue;
+
+                foreach (MapObject *object, cell.value()) {
+                    const Entry &entry = mEntries.constFind(object).value();
+
+                    // Objects spanning multiple cells are only reported in
+                    // the first cell they share with the queried area.
+                    const QRect shared = entry.cells & cells;
+                    if (shared.left() != x || shared.top() != y)
+                        continue;
+
+                    if (touches(entry.bounds, r)) {
+                        const OrderedObject o = { entry.order, object };
+                        found.append(o);
+                    }
+                }
+            }
+        }
+
+        foreach (MapObject *object, mLargeObjects) {
+            const Entry &entry = mEntries.constFind(object).value();
+            if (touches(entry.bounds, r)) {
+                const OrderedObject o = { entry.order, object };
+                found.append(o);
+            }
+        }
+    }
+
+    qSort(found);
+
+    QList<MapObject*> objects;
+    objects.reserve(found.size());
+    foreach (const OrderedObject &o, found)
+        objects.append(o.object);
+    return objects;
+}
+
+QRectF MapObjectIndex::indexBounds(const MapObject *object)
+{
+    const QPointF &pos = object->position();
+    QRectF bounds = object->bounds().normalized();
+
+    if (!object->polygon().isEmpty()) {
+        const QRectF polygonBounds =
+                object->polygon().boundingRect().translated(pos);
+        bounds = bounds.isNull() ? polygonBounds : bounds.united(polygonBounds);
+    }
+
+    if (object->rotation() != 0) {
+        // Rotation happens around the position of the object, in pixel
+        // coordinates. Taking twice the distance to the farthest corner
+        // covers the distortion caused by isometric projection.
+        qreal radius = 0;
+        radius = qMax(radius, QLineF(pos, bounds.topLeft()).length());
+        radius = qMax(radius, QLineF(pos, bounds.topRight()).length());
+        radius = qMax(radius, QLineF(pos, bounds.bottomLeft()).length());
+        radius = qMax(radius, QLineF(pos, bounds.bottomRight()).length());
+        radius *= 2;
+
+        bounds = QRectF(pos.x() - radius, pos.y() - radius,
+                        radius * 2, radius * 2);
+    }
+
+    return bounds;
+}
+
+QRect MapObjectIndex::cellsForBounds(const QRectF &bounds) const
+{
+    return QRect(QPoint((int) std::floor(bounds.left() / CellSize),
+                        (int) std::floor(bounds.top() / CellSize)),
+                 QPoint((int) std::floor(bounds.right() / CellSize),
+                        (int) std::floor(bounds.bottom() / CellSize)));
+}
+
+void MapObjectIndex::addToCells(MapObject *object, const Entry &entry)
+{
+    if (entry.large) {
+        mLargeObjects.append(object);
+        return;
+    }
+
+    for (int y = entry.cells.top(); y <= entry.cells.bottom(); ++y)
+        for (int x = entry.cells.left(); x <= entry.cells.right(); ++x)
+            mCells[cellKey(x, y)].append(object);
+}
+
+void MapObjectIndex::removeFromCells(MapObject *object, const Entry &entry)
+{
+    if (entry.large) {
+        mLargeObjects.removeOne(object);
+        return;
+    }
+
+    for (int y = entry.cells.top(); y <= entry.cells.bottom(); ++y) {
+        for (int x = entry.cells.left(); x <= entry.cells.right(); ++x) {
+            QHash<quint64, QVector<MapObject*> >::iterator cell =
+                    mCells.find(cellKey(x, y));
+            if (cell == mCells.end())
+                continue;
+
+            QVector<MapObject*> &objects = cell.value();
+            const int index = objects.indexOf(object);
+            if (index != -1)
+                objects.remove(index);
+            if (objects.isEmpty())
+                mCells.erase(cell);
+        }
+    }
+}
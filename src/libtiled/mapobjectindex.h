@@ -0,0 +1,123 @@
+/*
+ * mapobjectindex.h
+ * Copyright 2026, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of libtiled.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef MAPOBJECTINDEX_H
+#define MAPOBJECTINDEX_H
+
+#include "tiled_global.h"
+
+#include <QHash>
+#include <QList>
+#include <QRect>
+#include <QRectF>
+#include <QVector>
+
+namespace Tiled {
+
+class MapObject;
+
+/**
+ * A spatial index over the map objects of an object group, used to quickly
+ * find the objects within a certain area.
+ *
+ * The index divides the plane into a uniform grid of cells and stores for
+ * each cell the objects overlapping it. Objects covering a very large amount
+ * of cells are kept in a separate list instead, which is always checked.
+ *
+ * All coordinates are object coordinates (in tiles). The indexed bounds of
+ * an object are a conservative approximation, which includes its polygon and
+ * takes into account its rotation. It is up to the caller to take into
+ * account anything drawn beyond those bounds, like tile images and labels.
+ */
+class TILEDSHARED_EXPORT MapObjectIndex
+{
+public:
+    MapObjectIndex();
+
+    /**
+     * Adds the \a object to the index. The \a order is used for sorting the
+     * results of queries.
+     */
+    void insert(MapObject *object, int order);
+
+    /**
+     * Removes the \a object from the index.
+     */
+    void remove(MapObject *object);
+
+    /**
+     * Updates the location of the \a object in the index. Should be called
+     * whenever the geometry of the object changed.
+     */
+    void update(MapObject *object);
+
+    /**
+     * Changes the order associated with the \a object.
+     */
+    void setOrder(MapObject *object, int order);
+
+    /**
+     * Removes all objects from the index.
+     */
+    void clear();
+
+    /**
+     * Returns the objects whose indexed bounds intersect with \a rect, in
+     * their order.
+     */
+    QList<MapObject*> objectsIntersecting(const QRectF &rect) const;
+
+    /**
+     * Returns the conservative bounds that are used to index \a object.
+     */
+    static QRectF indexBounds(const MapObject *object);
+
+private:
+    struct Entry
+    {
+        QRectF bounds;
+        QRect cells;
+        int order;
+        bool large;
+    };
+
+    QRect cellsForBounds(const QRectF &bounds) const;
+    void addToCells(MapObject *object, const Entry &entry);
+    void removeFromCells(MapObject *object, const Entry &entry);
+
+    static quint64 cellKey(int x, int y)
+    { return (quint64(quint32(x)) << 32) | quint32(y); }
+
+    QHash<MapObject*, Entry> mEntries;
+    QHash<quint64, QVector<MapObject*> > mCells;
+    QList<MapObject*> mLargeObjects;
+};
+
+} // namespace Tiled
+
+#endif // MAPOBJECTINDEX_H
@@ -32,6 +32,7 @@
 
 #include "compression.h"
 #include "gidmapper.h"
+#include "imagecache.h"
 #include "imagelayer.h"
 #include "objectgroup.h"
 #include "map.h"
@@ -45,8 +46,11 @@
 #include <QDebug>
 #include <QDir>
 #include <QFileInfo>
+#include <QFuture>
+#include <QImageReader>
 #include <QVector>
 #include <QXmlStreamReader>
+#include <QtConcurrentRun>
 
 using namespace Tiled;
 using namespace Tiled::Internal;
@@ -54,6 +58,26 @@ using namespace Tiled::Internal;
 namespace Tiled {
 namespace Internal {
 
+/**
+ * An external image that is being decoded in the background, along with the
+ * tileset, tile or image layer that it is for.
+ */
+struct PendingImage
+{
+    enum Kind {
+        TilesetImage,
+        TileImage,
+        ImageLayerImage
+    };
+
+    Kind kind;
+    Tileset *tileset;
+    int tileId;
+    ImageLayer *imageLayer;
+    QString source;
+    QFuture<QImage> image;
+};
+
 class MapReaderPrivate
 {
     Q_DECLARE_TR_FUNCTIONS(MapReader)
@@ -64,7 +88,8 @@ public:
     MapReaderPrivate(MapReader *mapReader):
         p(mapReader),
         mMap(0),
-        mReadingExternalTileset(false)
+        mReadingExternalTileset(false),
+        mParent(0)
     {}
 
     Map *readMap(QIODevice *device, const QString &path);
@@ -112,6 +137,17 @@ private:
     Properties readProperties();
     void readProperty(Properties *properties);
 
+    /**
+     * Starts decoding the external image \a source on a worker thread.
+     */
+    QFuture<QImage> loadImage(const QString &source);
+    static QImage loadExternalImage(MapReader *reader, const QString &source);
+
+    /**
+     * Waits for the images that are being decoded and assigns them.
+     */
+    void finishLoadingImages();
+
     MapReader *p;
 
     QString mError;
@@ -121,6 +157,13 @@ private:
     GidMapper mGidMapper;
     bool mReadingExternalTileset;
 
+    /**
+     * The reader of the map when reading one of its external tilesets. The
+     * images of the tileset are finished along with those of the map.
+     */
+    MapReaderPrivate *mParent;
+    QList<PendingImage> mPendingImages;
+
     QXmlStreamReader xml;
 };
 
@@ -159,6 +202,13 @@ Tileset *MapReaderPrivate::readTileset(QIODevice *device, const QString &path)
     else
         xml.raiseError(tr("Not a tileset file."));
 
+    if (mParent) {
+        mParent->mPendingImages.append(mPendingImages);
+        mPendingImages.clear();
+    } else {
+        finishLoadingImages();
+    }
+
     mReadingExternalTileset = false;
     return tileset;
 }
@@ -242,6 +292,8 @@ Map *MapReaderPrivate::readMap()
             readUnknownElement();
     }
 
+    finishLoadingImages();
+
     // Clean up in case of error
     if (xml.hasError()) {
         // The tilesets are not owned by the map
@@ -383,9 +435,29 @@ void MapReaderPrivate::readTilesetTile(Tileset *tileset)
             tile->mergeProperties(readProperties());
         } else if (xml.name() == QLatin1String("image")) {
             QString source = xml.attributes().value(QLatin1String("source")).toString();
-            if (!source.isEmpty())
+            if (!source.isEmpty()) {
                 source = p->resolveReference(source, mPath);
-            tileset->setTileImage(id, QPixmap::fromImage(readImage()), source);
+
+                if (ImageCache::containsPixmap(source)) {
+                    tileset->setTileImage(id, ImageCache::loadPixmap(source),
+                                          source);
+                    xml.skipCurrentElement();
+                    continue;
+                }
+
+                PendingImage pending;
+                pending.kind = PendingImage::TileImage;
+                pending.tileset = tileset;
+                pending.tileId = id;
+                pending.imageLayer = 0;
+                pending.source = source;
+                pending.image = loadImage(source);
+                mPendingImages.append(pending);
+
+                xml.skipCurrentElement();
+            } else {
+                tileset->setTileImage(id, QPixmap::fromImage(readImage()), source);
+            }
         } else {
             readUnknownElement();
         }
@@ -413,6 +485,36 @@ void MapReaderPrivate::readTilesetImage(Tileset *tileset)
     const int width = atts.value(QLatin1String("width")).toString().toInt();
     mGidMapper.setTilesetWidth(tileset, width);
 
+    // The tiles need to exist while reading the rest of the map, but when the
+    // size of the image can be determined, it can be decoded in the background
+    if (!source.isEmpty() && !xml.hasError()) {
+        // Images that are already cached don't need to be read at all
+        if (ImageCache::containsPixmap(source, tileset->transparentColor())) {
+            if (!tileset->loadFromImage(source))
+                xml.raiseError(tr("Error loading tileset image:\n'%1'")
+                               .arg(source));
+            xml.skipCurrentElement();
+            return;
+        }
+
+        const QSize size = QImageReader(source).size();
+        if (size.isValid()) {
+            tileset->prepareImage(size, source);
+
+            PendingImage pending;
+            pending.kind = PendingImage::TilesetImage;
+            pending.tileset = tileset;
+            pending.tileId = -1;
+            pending.imageLayer = 0;
+            pending.source = source;
+            pending.image = loadImage(source);
+            mPendingImages.append(pending);
+
+            xml.skipCurrentElement();
+            return;
+        }
+    }
+
     if (!tileset->loadFromImage(readImage(), source))
         xml.raiseError(tr("Error loading tileset image:\n'%1'").arg(source));
 }
@@ -761,9 +863,22 @@ void MapReaderPrivate::readImageLayerImage(ImageLayer *imageLayer)
 
     source = p->resolveReference(source, mPath);
 
-    const QImage imageLayerImage = p->readExternalImage(source);
-    if (!imageLayer->loadFromImage(imageLayerImage, source))
-        xml.raiseError(tr("Error loading image layer image:\n'%1'").arg(source));
+    if (ImageCache::containsPixmap(source, imageLayer->transparentColor())) {
+        if (!imageLayer->loadFromImage(source))
+            xml.raiseError(tr("Error loading image layer image:\n'%1'")
+                           .arg(source));
+        xml.skipCurrentElement();
+        return;
+    }
+
+    PendingImage pending;
+    pending.kind = PendingImage::ImageLayerImage;
+    pending.tileset = 0;
+    pending.tileId = -1;
+    pending.imageLayer = imageLayer;
+    pending.source = source;
+    pending.image = loadImage(source);
+    mPendingImages.append(pending);
 
     xml.skipCurrentElement();
 }
@@ -954,6 +1069,62 @@ Tileset *MapReader::readTileset(const QString &fileName)
     return tileset;
 }
 
+QFuture<QImage> MapReaderPrivate::loadImage(const QString &source)
+{
+    // Images are always loaded through the reader of the map
+    MapReaderPrivate *d = this;
+    while (d->mParent)
+        d = d->mParent;
+
+    return QtConcurrent::run(loadExternalImage, d->p, source);
+}
+
+QImage MapReaderPrivate::loadExternalImage(MapReader *reader,
+                                           const QString &source)
+{
+    return reader->readExternalImage(source);
+}
+
+void MapReaderPrivate::finishLoadingImages()
+{
+    foreach (const PendingImage &pending, mPendingImages) {
+        // Always wait for the image, since it is read through the MapReader
+        const QImage image = pending.image.result();
+
+        // Nothing to do when reading has failed anyway
+        if (xml.hasError())
+            continue;
+
+        switch (pending.kind) {
+        case PendingImage::TilesetImage:
+            if (!pending.tileset->loadFromImage(image, pending.source))
+                xml.raiseError(tr("Error loading tileset image:\n'%1'")
+                               .arg(pending.source));
+            break;
+        case PendingImage::TileImage:
+            if (image.isNull())
+                xml.raiseError(tr("Error loading image:\n'%1'")
+                               .arg(pending.source));
+            pending.tileset->setTileImage(pending.tileId,
+                                          ImageCache::loadPixmap(pending.source,
+                                                                 QColor(),
+                                                                 image),
+                                          pending.source);
+            break;
+        case PendingImage::ImageLayerImage:
+            if (!pending.imageLayer->loadFromImage(image, pending.source))
+                xml.raiseError(tr("Error loading image layer image:\n'%1'")
+                               .arg(pending.source));
+            break;
+        }
+    }
+
+    mPendingImages.clear();
+
+    // Drop the decoded images that ended up not being used
+    ImageCache::purge();
+}
+
 QString MapReader::errorString() const
 {
     return d->errorString();
@@ -970,13 +1141,14 @@ QString MapReader::resolveReference(const QString &reference,
 
 QImage MapReader::readExternalImage(const QString &source)
 {
-    return QImage(source);
+    return ImageCache::loadImage(source);
 }
 
 Tileset *MapReader::readExternalTileset(const QString &source,
                                         QString *error)
 {
     MapReader reader;
+    reader.d->mParent = d;
 
     Tileset *tileset = reader.readTileset(source);
     if (!tileset)
@@ -106,6 +106,12 @@ protected:
 
     /**
      * Called when an external image is encountered while a tileset is loaded.
+     *
+     * Images are decoded in parallel, so this function may be called from
+     * any thread. When a map is read, this is called on the MapReader that
+     * reads the map, also for images of the external tilesets it refers to.
+     * Images of which a pixmap is already in the ImageCache are not read
+     * again.
      */
     virtual QImage readExternalImage(const QString &source);
 
@@ -29,8 +29,10 @@
 #include "maprenderer.h"
 
 #include "imagelayer.h"
+#include "map.h"
 #include "tile.h"
 #include "tilelayer.h"
+#include "tileset.h"
 
 #include <QPaintEngine>
 #include <QPainter>
@@ -44,6 +46,30 @@ QRectF MapRenderer::boundingRect(const ImageLayer *imageLayer) const
                   imageLayer->image().size());
 }
 
+QRectF MapRenderer::objectQueryRect(const QRectF &rect) const
+{
+    // Leave room for point markers, labels and the line width
+    qreal margin = 30 + mObjectLineWidth;
+
+    // Tile objects are drawn with their tile image next to their position
+    foreach (const Tileset *tileset, mMap->tilesets()) {
+        const QPoint offset = tileset->tileOffset();
+        margin = qMax(margin, qreal(tileset->tileWidth() + qAbs(offset.x())));
+        margin = qMax(margin, qreal(tileset->tileHeight() + qAbs(offset.y())));
+    }
+
+    const QRectF r = rect.adjusted(-margin, -margin, margin, margin);
+
+    QPolygonF corners;
+    corners << pixelToTileCoords(r.topLeft())
+            << pixelToTileCoords(r.topRight())
+            << pixelToTileCoords(r.bottomLeft())
+            << pixelToTileCoords(r.bottomRight());
+
+    // The extra tile compensates for non-linear projections
+    return corners.boundingRect().adjusted(-1, -1, 1, 1);
+}
+
 void MapRenderer::drawImageLayer(QPainter *painter,
                                  const ImageLayer *imageLayer,
                                  const QRectF &exposed)
@@ -102,14 +128,15 @@ CellRenderer::CellRenderer(QPainter *painter)
  * Renders a \a cell with the given \a origin at \a pos, taking into account
  * the flipping and tile offset.
  *
- * For performance reasons, the actual drawing is delayed until a different
- * kind of tile has to be drawn. For this reason it is necessary to call
+ * For performance reasons, the actual drawing is delayed until a tile using
+ * a different pixmap has to be drawn. For this reason it is necessary to call
  * flush when finished doing drawCell calls. This function is also called by
  * the destructor so usually an explicit call it not needed.
  */
 void CellRenderer::render(const Cell &cell, const QPointF &pos, Origin origin)
 {
-    if (mTile != cell.tile)
+    // Tiles sharing the same pixmap can be drawn in one go
+    if (mTile && mTile->pixmap().cacheKey() != cell.tile->pixmap().cacheKey())
         flush();
 
     const QSizeF size = cell.tile->size();
@@ -119,8 +146,8 @@ void CellRenderer::render(const Cell &cell, const QPointF &pos, Origin origin)
     QPainter::PixmapFragment fragment;
     fragment.x = pos.x() + offset.x() + sizeHalf.x();
     fragment.y = pos.y() + offset.y() + sizeHalf.y() - size.height();
-    fragment.sourceLeft = 0;
-    fragment.sourceTop = 0;
+    fragment.sourceLeft = cell.tile->imageRect().x();
+    fragment.sourceTop = cell.tile->imageRect().y();
     fragment.width = size.width();
     fragment.height = size.height();
     fragment.scaleX = cell.flippedHorizontally ? -1 : 1;
@@ -162,10 +189,10 @@ void CellRenderer::render(const Cell &cell, const QPointF &pos, Origin origin)
 
     const QRectF target(fragment.width * -0.5, fragment.height * -0.5,
                         fragment.width, fragment.height);
-    const QRectF source(0, 0, fragment.width, fragment.height);
+    const QRectF source(cell.tile->imageRect());
 
     mPainter->setTransform(transform);
-    mPainter->drawPixmap(target, cell.tile->image(), source);
+    mPainter->drawPixmap(target, cell.tile->pixmap(), source);
     mPainter->setTransform(oldTransform);
 }
 
@@ -179,7 +206,7 @@ void CellRenderer::flush()
 
     mPainter->drawPixmapFragments(mFragments.constData(),
                                   mFragments.size(),
-                                  mTile->image());
+                                  mTile->pixmap());
 
     mTile = 0;
     mFragments.resize(0);
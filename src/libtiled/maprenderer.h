@@ -163,6 +163,17 @@ public:
         return screenPolygon;
     }
 
+    /**
+     * Returns the area in tile coordinates in which map objects may be found
+     * that are (partially) drawn within the given \a rect of pixels. Takes
+     * into account that objects may be drawn beyond their bounds, for
+     * example due to tile images, labels and point markers.
+     *
+     * The result can be used to query the objects of an object group with
+     * ObjectGroup::objectsIntersecting.
+     */
+    QRectF objectQueryRect(const QRectF &rect) const;
+
     qreal objectLineWidth() const { return mObjectLineWidth; }
     void setObjectLineWidth(qreal lineWidth) { mObjectLineWidth = lineWidth; }
 
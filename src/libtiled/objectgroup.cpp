@@ -33,14 +33,19 @@
 #include "layer.h"
 #include "map.h"
 #include "mapobject.h"
+#include "mapobjectindex.h"
 #include "tile.h"
 #include "tileset.h"
 
+#include <QPainterPath>
+
 using namespace Tiled;
 
 ObjectGroup::ObjectGroup()
     : Layer(ObjectGroupType, QString(), 0, 0, 0, 0)
     , mDrawOrder(TopDownOrder)
+    , mIndex(0)
+    , mIndexOrderInvalidFrom(-1)
 {
 }
 
@@ -48,11 +53,14 @@ ObjectGroup::ObjectGroup(const QString &name,
                          int x, int y, int width, int height)
     : Layer(ObjectGroupType, name, x, y, width, height)
     , mDrawOrder(TopDownOrder)
+    , mIndex(0)
+    , mIndexOrderInvalidFrom(-1)
 {
 }
 
 ObjectGroup::~ObjectGroup()
 {
+    delete mIndex;
     qDeleteAll(mObjects);
 }
 
@@ -60,12 +68,20 @@ void ObjectGroup::addObject(MapObject *object)
 {
     mObjects.append(object);
     object->setObjectGroup(this);
+
+    if (mIndex)
+        mIndex->insert(object, mObjects.size() - 1);
 }
 
 void ObjectGroup::insertObject(int index, MapObject *object)
 {
     mObjects.insert(index, object);
     object->setObjectGroup(this);
+
+    if (mIndex) {
+        mIndex->insert(object, index);
+        invalidateIndexOrder(index + 1);
+    }
 }
 
 int ObjectGroup::removeObject(MapObject *object)
@@ -73,8 +89,7 @@ int ObjectGroup::removeObject(MapObject *object)
     const int index = mObjects.indexOf(object);
     Q_ASSERT(index != -1);
 
-    mObjects.removeAt(index);
-    object->setObjectGroup(0);
+    removeObjectAt(index);
     return index;
 }
 
@@ -82,6 +97,11 @@ void ObjectGroup::removeObjectAt(int index)
 {
     MapObject *object = mObjects.takeAt(index);
     object->setObjectGroup(0);
+
+    if (mIndex) {
+        mIndex->remove(object);
+        invalidateIndexOrder(index);
+    }
 }
 
 void ObjectGroup::moveObjects(int from, int to, int count)
@@ -104,6 +124,9 @@ void ObjectGroup::moveObjects(int from, int to, int count)
 
     for (int i = 0; i < count; ++i)
         mObjects.insert(to + i, movingObjects.at(i));
+
+    if (mIndex)
+        invalidateIndexOrder(qMin(from, to));
 }
 
 QRectF ObjectGroup::objectsBoundingRect() const
@@ -114,6 +137,75 @@ QRectF ObjectGroup::objectsBoundingRect() const
     return boundingRect;
 }
 
+QList<MapObject*> ObjectGroup::objectsIntersecting(const QRectF &rect) const
+{
+    return index()->objectsIntersecting(rect);
+}
+
+QList<MapObject*> ObjectGroup::objectsIntersecting(const QPolygonF &polygon) const
+{
+    QPainterPath path;
+    path.addPolygon(polygon);
+    path.closeSubpath();
+
+    QList<MapObject*> objects;
+
+    foreach (MapObject *object, index()->objectsIntersecting(polygon.boundingRect())) {
+        const QRectF bounds = MapObjectIndex::indexBounds(object);
+        const bool intersects = bounds.isEmpty()
+                ? path.contains(bounds.center())
+                : path.intersects(bounds);
+        if (intersects)
+            objects.append(object);
+    }
+
+    return objects;
+}
+
+QList<MapObject*> ObjectGroup::objectsAt(const QPointF &pos) const
+{
+    return index()->objectsIntersecting(QRectF(pos, QSizeF(0, 0)));
+}
+
+void ObjectGroup::objectGeometryChanged(MapObject *object)
+{
+    if (mIndex)
+        mIndex->update(object);
+}
+
+/**
+ * Returns the spatial index of this object group, creating it when it
+ * doesn't exist yet.
+ *
+ * The order of the objects in the index is brought up to date here rather
+ * than on each insertion or removal, so that changing many objects in a row
+ * doesn't renumber the objects following them each time.
+ */
+MapObjectIndex *ObjectGroup::index() const
+{
+    if (!mIndex) {
+        mIndex = new MapObjectIndex;
+        for (int i = 0; i < mObjects.size(); ++i)
+            mIndex->insert(mObjects.at(i), i);
+        mIndexOrderInvalidFrom = -1;
+    } else if (mIndexOrderInvalidFrom != -1) {
+        for (int i = mIndexOrderInvalidFrom; i < mObjects.size(); ++i)
+            mIndex->setOrder(mObjects.at(i), i);
+        mIndexOrderInvalidFrom = -1;
+    }
+    return mIndex;
+}
+
+/**
+ * Marks the order in the spatial index of the objects starting at index
+ * \a from as out of date.
+ */
+void ObjectGroup::invalidateIndexOrder(int from)
+{
+    if (mIndexOrderInvalidFrom == -1 || from < mIndexOrderInvalidFrom)
+        mIndexOrderInvalidFrom = from;
+}
+
 bool ObjectGroup::isEmpty() const
 {
     return mObjects.isEmpty();
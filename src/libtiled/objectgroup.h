@@ -39,9 +39,12 @@
 #include <QList>
 #include <QMetaType>
 
+class QPolygonF;
+
 namespace Tiled {
 
 class MapObject;
+class MapObjectIndex;
 
 /**
  * A group of objects on a map.
@@ -134,6 +137,42 @@ public:
      */
     QRectF objectsBoundingRect() const;
 
+    /**
+     * Returns the objects that may intersect with the given \a rect, in
+     * object coordinates. The objects are returned in the same order as they
+     * appear in this object group.
+     *
+     * The check is done using conservative object bounds (see
+     * MapObjectIndex), so the caller needs to do an exact check when needed
+     * and take into account anything drawn beyond the object bounds.
+     *
+     * The spatial index used for this query is created the first time it is
+     * needed and kept up to date from then on.
+     */
+    QList<MapObject*> objectsIntersecting(const QRectF &rect) const;
+
+    /**
+     * Returns the objects that may intersect with the given \a polygon, in
+     * object coordinates.
+     *
+     * \sa objectsIntersecting(const QRectF&)
+     */
+    QList<MapObject*> objectsIntersecting(const QPolygonF &polygon) const;
+
+    /**
+     * Returns the objects that may contain the given \a pos, in object
+     * coordinates.
+     *
+     * \sa objectsIntersecting(const QRectF&)
+     */
+    QList<MapObject*> objectsAt(const QPointF &pos) const;
+
+    /**
+     * Updates the spatial index for the given \a object. Should only be
+     * called from the MapObject class.
+     */
+    void objectGeometryChanged(MapObject *object);
+
     /**
      * Returns whether this object group contains any objects.
      */
@@ -189,9 +228,14 @@ protected:
     ObjectGroup *initializeClone(ObjectGroup *clone) const;
 
 private:
+    MapObjectIndex *index() const;
+    void invalidateIndexOrder(int from);
+
     QList<MapObject*> mObjects;
     QColor mColor;
     DrawOrder mDrawOrder;
+    mutable MapObjectIndex *mIndex;
+    mutable int mIndexOrderInvalidFrom; /**< -1 when the order is valid. */
 };
 
 
@@ -66,7 +66,7 @@ QRectF OrthogonalRenderer::boundingRect(const MapObject *object) const
     if (!object->cell().isEmpty()) {
         const QPointF bottomLeft = rect.topLeft();
         const Tile *tile = object->cell().tile;
-        const QSize imgSize = tile->image().size();
+        const QSize imgSize = tile->size();
         const QPoint tileOffset = tile->tileset()->tileOffset();
         boundingRect = QRectF(bottomLeft.x() + tileOffset.x(),
                               bottomLeft.y() + tileOffset.y() - imgSize.height(),
@@ -287,7 +287,7 @@ void OrthogonalRenderer::drawMapObject(QPainter *painter,
                                      CellRenderer::BottomLeft);
 
         if (testFlag(ShowTileObjectOutlines)) {
-            const QRect rect = cell.tile->image().rect();
+            const QRect rect(QPoint(), cell.tile->size());
             QPen pen(Qt::SolidLine);
             pen.setCosmetic(true);
             painter->setPen(pen);
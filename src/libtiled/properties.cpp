@@ -28,15 +28,176 @@
 
 #include "properties.h"
 
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSet>
+
 using namespace Tiled;
 
+namespace {
+
+struct InternedNames
+{
+    QMutex mutex;
+    QSet<QString> names;
+};
+
+Q_GLOBAL_STATIC(InternedNames, internedNames)
+
+} // anonymous namespace
+
+QString Properties::internName(const QString &name)
+{
+    InternedNames *interned = internedNames();
+    QMutexLocker locker(&interned->mutex);
+
+    QSet<QString>::const_iterator it = interned->names.constFind(name);
+    if (it != interned->names.constEnd())
+        return *it;
+
+    interned->names.insert(name);
+    return name;
+}
+
+QString Properties::value(const QString &name,
+                          const QString &defaultValue) const
+{
+    const int index = indexOf(name);
+    return index != -1 ? mProperties.at(index).value : defaultValue;
+}
+
+Properties::iterator Properties::insert(const QString &name,
+                                        const QString &value)
+{
+    const int index = lowerBound(name);
+
+    if (index < mProperties.size() && mProperties.at(index).name == name) {
+        Property *property = mProperties.data() + index;
+        property->value = value;
+        return iterator(property);
+    }
+
+    Property property;
+    property.name = internName(name);
+    property.value = value;
+    mProperties.insert(index, property);
+    return iterator(mProperties.data() + index);
+}
+
+int Properties::remove(const QString &name)
+{
+    const int index = indexOf(name);
+    if (index == -1)
+        return 0;
+
+    mProperties.remove(index);
+    return 1;
+}
+
+QString Properties::take(const QString &name)
+{
+    const int index = indexOf(name);
+    if (index == -1)
+        return QString();
+
+    const QString value = mProperties.at(index).value;
+    mProperties.remove(index);
+    return value;
+}
+
+QString &Properties::operator[](const QString &name)
+{
+    const int index = indexOf(name);
+    if (index != -1)
+        return mProperties.data()[index].value;
+
+    return insert(name, QString()).value();
+}
+
+QList<QString> Properties::keys() const
+{
+    QList<QString> keys;
+    keys.reserve(mProperties.size());
+    foreach (const Property &property, mProperties)
+        keys.append(property.name);
+    return keys;
+}
+
+QList<QString> Properties::values() const
+{
+    QList<QString> values;
+    values.reserve(mProperties.size());
+    foreach (const Property &property, mProperties)
+        values.append(property.value);
+    return values;
+}
+
+Properties::const_iterator Properties::constFind(const QString &name) const
+{
+    const int index = indexOf(name);
+    return index != -1 ? const_iterator(mProperties.constData() + index)
+                       : constEnd();
+}
+
+Properties::iterator Properties::find(const QString &name)
+{
+    const int index = indexOf(name);
+    return index != -1 ? iterator(mProperties.data() + index) : end();
+}
+
+Properties::iterator Properties::erase(iterator it)
+{
+    const int index = int(it.p - mProperties.constData());
+    mProperties.remove(index);
+    return iterator(mProperties.data() + index);
+}
+
 void Properties::merge(const Properties &other)
 {
-    // Based on QMap::unite, but using insert instead of insertMulti
-    const_iterator it = other.constEnd();
-    const const_iterator b = other.constBegin();
-    while (it != b) {
-        --it;
-        insert(it.key(), it.value());
+    // Merging into an empty set, as done when loading a map, can simply
+    // share the data of the other set
+    if (isEmpty()) {
+        mProperties = other.mProperties;
+        return;
+    }
+
+    foreach (const Property &property, other.mProperties)
+        insert(property.name, property.value);
+}
+
+/**
+ * Returns the index of the property with the given \a name, or -1 when there
+ * is no such property.
+ */
+int Properties::indexOf(const QString &name) const
+{
+    const int index = lowerBound(name);
+    if (index < mProperties.size() && mProperties.at(index).name == name)
+        return index;
+    return -1;
+}
+
+/**
+ * Returns the index of the first property whose name does not compare less
+ * than \a name. Since properties are usually added in sorted order, the
+ * last property is checked first.
+ */
+int Properties::lowerBound(const QString &name) const
+{
+    int count = mProperties.size();
+    if (count == 0 || mProperties.at(count - 1).name < name)
+        return count;
+
+    int first = 0;
+    while (count > 0) {
+        const int step = count / 2;
+        const int middle = first + step;
+        if (mProperties.at(middle).name < name) {
+            first = middle + 1;
+            count -= step + 1;
+        } else {
+            count = step;
+        }
     }
+    return first;
 }
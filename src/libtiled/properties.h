@@ -31,15 +31,153 @@
 
 #include "tiled_global.h"
 
-#include <QMap>
+#include <QList>
 #include <QString>
+#include <QVector>
 
 namespace Tiled {
 
-class TILEDSHARED_EXPORT Properties : public QMap<QString,QString>
+/**
+ * A single name/value pair stored in Properties.
+ */
+struct Property
+{
+    QString name;
+    QString value;
+
+    bool operator==(const Property &other) const
+    { return name == other.name && value == other.value; }
+};
+
+} // namespace Tiled
+
+Q_DECLARE_TYPEINFO(Tiled::Property, Q_MOVABLE_TYPE);
+
+namespace Tiled {
+
+/**
+ * A set of string properties, sorted by name.
+ *
+ * The properties are stored in a flat array rather than a tree, and the
+ * property names are interned, so that the many objects sharing the same
+ * property names also share the memory used by those names. The interface
+ * matches the subset of QMap<QString,QString> used throughout Tiled.
+ */
+class TILEDSHARED_EXPORT Properties
 {
 public:
+    class iterator;
+
+    class const_iterator
+    {
+    public:
+        const_iterator() : p(0) {}
+        explicit const_iterator(const Property *property) : p(property) {}
+
+        const QString &key() const { return p->name; }
+        const QString &value() const { return p->value; }
+        const QString &operator*() const { return p->value; }
+        const QString *operator->() const { return &p->value; }
+
+        bool operator==(const const_iterator &o) const { return p == o.p; }
+        bool operator!=(const const_iterator &o) const { return p != o.p; }
+
+        const_iterator &operator++() { ++p; return *this; }
+        const_iterator operator++(int) { const_iterator r = *this; ++p; return r; }
+        const_iterator &operator--() { --p; return *this; }
+        const_iterator operator--(int) { const_iterator r = *this; --p; return r; }
+
+    private:
+        friend class Properties;
+        const Property *p;
+    };
+
+    class iterator
+    {
+    public:
+        iterator() : p(0) {}
+        explicit iterator(Property *property) : p(property) {}
+
+        const QString &key() const { return p->name; }
+        QString &value() const { return p->value; }
+        QString &operator*() const { return p->value; }
+        QString *operator->() const { return &p->value; }
+
+        bool operator==(const iterator &o) const { return p == o.p; }
+        bool operator!=(const iterator &o) const { return p != o.p; }
+
+        iterator &operator++() { ++p; return *this; }
+        iterator operator++(int) { iterator r = *this; ++p; return r; }
+        iterator &operator--() { --p; return *this; }
+        iterator operator--(int) { iterator r = *this; --p; return r; }
+
+        operator const_iterator() const { return const_iterator(p); }
+
+    private:
+        friend class Properties;
+        Property *p;
+    };
+
+    typedef QString key_type;
+    typedef QString mapped_type;
+    typedef const_iterator ConstIterator;
+    typedef iterator Iterator;
+
+    bool isEmpty() const { return mProperties.isEmpty(); }
+    int size() const { return mProperties.size(); }
+    int count() const { return mProperties.size(); }
+    void clear() { mProperties.clear(); }
+
+    bool contains(const QString &name) const
+    { return indexOf(name) != -1; }
+
+    QString value(const QString &name,
+                  const QString &defaultValue = QString()) const;
+
+    iterator insert(const QString &name, const QString &value);
+    int remove(const QString &name);
+    QString take(const QString &name);
+
+    QString &operator[](const QString &name);
+    const QString operator[](const QString &name) const
+    { return value(name); }
+
+    QList<QString> keys() const;
+    QList<QString> values() const;
+
+    const_iterator begin() const { return constBegin(); }
+    const_iterator end() const { return constEnd(); }
+    const_iterator constBegin() const
+    { return const_iterator(mProperties.constData()); }
+    const_iterator constEnd() const
+    { return const_iterator(mProperties.constData() + mProperties.size()); }
+
+    iterator begin() { return iterator(mProperties.data()); }
+    iterator end() { return iterator(mProperties.data() + mProperties.size()); }
+
+    const_iterator find(const QString &name) const { return constFind(name); }
+    const_iterator constFind(const QString &name) const;
+    iterator find(const QString &name);
+    iterator erase(iterator it);
+
     void merge(const Properties &other);
+
+    bool operator==(const Properties &other) const
+    { return mProperties == other.mProperties; }
+    bool operator!=(const Properties &other) const
+    { return mProperties != other.mProperties; }
+
+    /**
+     * Returns the shared instance of the given property \a name. All property
+     * names stored in Properties are interned through this function.
+     */
+    static QString internName(const QString &name);
+
+private:
+    int indexOf(const QString &name) const;
+    int lowerBound(const QString &name) const;
+
+    QVector<Property> mProperties;
 };
 
 } // namespace Tiled
@@ -136,6 +136,9 @@ void StaggeredRenderer::drawTileLayer(QPainter *painter,
     const int tileWidth = map()->tileWidth();
     const int tileHeight = map()->tileHeight();
 
+    if (tileWidth <= 0 || tileHeight <= 1)
+        return;
+
     QRect rect = exposed.toAlignedRect();
     if (rect.isNull())
         rect = boundingRect(layer->bounds());
@@ -181,19 +184,34 @@ void StaggeredRenderer::drawTileLayer(QPainter *painter,
 
     CellRenderer renderer(painter);
 
-    for (; startPos.y() < rect.bottom() && startTile.y() < layer->height(); startTile.ry()++) {
-        QPoint rowTile = startTile;
-        QPoint rowPos = startPos;
+    // Determine the last row that needs to be drawn up front
+    const int remainingHeight = rect.bottom() - startPos.y();
+    const int rows = remainingHeight > 0
+            ? (remainingHeight + tileHeight / 2 - 1) / (tileHeight / 2)
+            : 0;
+    const int endY = qMin(layer->height(), startTile.y() + rows);
 
-        if ((startTile.y() + layer->y()) % 2)
-            rowPos.rx() += tileWidth / 2;
+    for (; startTile.y() < endY; startTile.ry()++) {
+        int rowX = startPos.x();
 
-        for (; rowPos.x() < rect.right() && rowTile.x() < layer->width(); rowTile.rx()++) {
-            const Cell &cell = layer->cellAt(rowTile);
-            if (!cell.isEmpty())
-                renderer.render(cell, rowPos, CellRenderer::BottomLeft);
+        if ((startTile.y() + layer->y()) % 2)
+            rowX += tileWidth / 2;
+
+        // Clip the row to the columns that are both exposed and in the layer
+        const int remainingWidth = rect.right() - rowX;
+        const int columns = remainingWidth > 0
+                ? (remainingWidth + tileWidth - 1) / tileWidth
+                : 0;
+        const int endX = qMin(layer->width(), startTile.x() + columns);
+
+        for (int x = startTile.x(); x < endX; ++x) {
+            const Cell &cell = layer->cellAt(x, startTile.y());
+            if (!cell.isEmpty()) {
+                renderer.render(cell, QPoint(rowX, startPos.y()),
+                                CellRenderer::BottomLeft);
+            }
 
-            rowPos.rx() += tileWidth;
+            rowX += tileWidth;
         }
 
         startPos.ry() += tileHeight / 2;
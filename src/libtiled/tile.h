@@ -57,6 +57,7 @@ public:
         mId(id),
         mTileset(tileset),
         mImage(image),
+        mImageRect(image.rect()),
         mTerrain(-1),
         mTerrainProbability(-1.f)
     {}
@@ -67,6 +68,7 @@ public:
         mId(id),
         mTileset(tileset),
         mImage(image),
+        mImageRect(image.rect()),
         mImageSource(imageSource),
         mTerrain(-1),
         mTerrainProbability(-1.f)
@@ -84,13 +86,51 @@ public:
 
     /**
      * Returns the image of this tile.
+     *
+     * When the tile is part of a larger image, a copy of its area is made
+     * the first time this is called. Use pixmap() and imageRect() to draw
+     * the tile instead.
      */
-    const QPixmap &image() const { return mImage; }
+    QPixmap image() const
+    {
+        if (mImageRect == mImage.rect())
+            return mImage;
+        if (mImageCopy.isNull())
+            mImageCopy = mImage.copy(mImageRect);
+        return mImageCopy;
+    }
+
+    /**
+     * Returns the pixmap that contains the image of this tile. For tiles
+     * loaded from a tileset image, this pixmap is shared by all the tiles of
+     * the tileset.
+     */
+    const QPixmap &pixmap() const { return mImage; }
+
+    /**
+     * Returns the area of pixmap() that is the image of this tile.
+     */
+    const QRect &imageRect() const { return mImageRect; }
 
     /**
      * Sets the image of this tile.
      */
-    void setImage(const QPixmap &image) { mImage = image; }
+    void setImage(const QPixmap &image)
+    {
+        mImage = image;
+        mImageRect = image.rect();
+        mImageCopy = QPixmap();
+    }
+
+    /**
+     * Sets the image of this tile to the area \a rect of \a pixmap.
+     */
+    void setImage(const QPixmap &pixmap, const QRect &rect)
+    {
+        mImage = pixmap;
+        mImageRect = rect;
+        mImageCopy = QPixmap();
+    }
 
     /**
      * Returns the file name of the external image that represents this tile.
@@ -105,17 +145,17 @@ public:
     /**
      * Returns the width of this tile.
      */
-    int width() const { return mImage.width(); }
+    int width() const { return mImageRect.width(); }
 
     /**
      * Returns the height of this tile.
      */
-    int height() const { return mImage.height(); }
+    int height() const { return mImageRect.height(); }
 
     /**
      * Returns the size of this tile.
      */
-    QSize size() const { return mImage.size(); }
+    QSize size() const { return mImageRect.size(); }
 
     /**
      * Returns the Terrain of a given corner.
@@ -157,6 +197,8 @@ private:
     int mId;
     Tileset *mTileset;
     QPixmap mImage;
+    QRect mImageRect;
+    mutable QPixmap mImageCopy;     /**< Cached result of image(). */
     QString mImageSource;
     unsigned mTerrain;
     float mTerrainProbability;
@@ -35,6 +35,7 @@
 #include "layer.h"
 #include "tiled.h"
 
+#include <QHash>
 #include <QMargins>
 #include <QString>
 #include <QVector>
@@ -88,6 +89,17 @@ public:
     bool flippedAntiDiagonally;
 };
 
+/**
+ * Hash function for using cells in a QHash or QSet.
+ */
+inline uint qHash(const Cell &cell)
+{
+    return ::qHash(cell.tile) ^
+            (uint(cell.flippedHorizontally) << 29) ^
+            (uint(cell.flippedVertically) << 30) ^
+            (uint(cell.flippedAntiDiagonally) << 31);
+}
+
 /**
  * A tile layer is a grid of cells. Each cell refers to a specific tile, and
  * stores how the tile is flipped.
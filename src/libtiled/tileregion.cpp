@@ -0,0 +1,570 @@
+/*
+ * tileregion.cpp
+ * Copyright 2026, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of libtiled.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "tileregion.h"
+
+#include <climits>
+#include <cstring>
+
+using namespace Tiled;
+
+namespace {
+
+typedef quint64 Word;
+
+inline int countTrailingZeros(Word word)
+{
+#if defined(Q_CC_GNU)
+    return __builtin_ctzll(word);
+#else
+    int count = 0;
+    while (!(word & 1)) {
+        word >>= 1;
+        ++count;
+    }
+    return count;
+#endif
+}
+
+inline int countLeadingZeros(Word word)
+{
+#if defined(Q_CC_GNU)
+    return __builtin_clzll(word);
+#else
+    int count = 0;
+    while (!(word & (Word(1) << 63))) {
+        word <<= 1;
+        ++count;
+    }
+    return count;
+#endif
+}
+
+inline int popCount(Word word)
+{
+#if defined(Q_CC_GNU)
+    return __builtin_popcountll(word);
+#else
+    int count = 0;
+    while (word) {
+        word &= word - 1;
+        ++count;
+    }
+    return count;
+#endif
+}
+
+/**
+ * Returns a word with the bits \a first to \a last (inclusive) set.
+ */
+inline Word bitMask(int first, int last)
+{
+    const Word high = (last == 63) ? ~Word(0) : (Word(1) << (last + 1)) - 1;
+    return high & (~Word(0) << first);
+}
+
+} // anonymous namespace
+
+TileRegion::TileRegion()
+    : mTop(0)
+    , mRows(0)
+    , mWordLeft(0)
+    , mStride(0)
+{
+}
+
+TileRegion::TileRegion(const QRect &rect)
+    : mTop(0)
+    , mRows(0)
+    , mWordLeft(0)
+    , mStride(0)
+{
+    add(rect);
+}
+
+TileRegion::TileRegion(const QRegion &region)
+    : mTop(0)
+    , mRows(0)
+    , mWordLeft(0)
+    , mStride(0)
+{
+    reserve(region.boundingRect());
+
+    foreach (const QRect &rect, region.rects()) {
+        setBits(rect, true);
+        mBounds |= rect;
+    }
+}
+
+int TileRegion::tileCount() const
+{
+    if (isEmpty())
+        return 0;
+
+    const int wordLeft = wordIndex(mBounds.left());
+    const int wordRight = wordIndex(mBounds.right());
+    int count = 0;
+
+    for (int y = mBounds.top(); y <= mBounds.bottom(); ++y) {
+        const Word *words = row(y) - mWordLeft;
+        for (int w = wordLeft; w <= wordRight; ++w)
+            count += popCount(words[w]);
+    }
+
+    return count;
+}
+
+bool TileRegion::contains(int x, int y) const
+{
+    if (!mBounds.contains(x, y))
+        return false;
+
+    const int word = wordIndex(x);
+    const int bit = x - word * WordBits;
+    return (row(y)[word - mWordLeft] >> bit) & 1;
+}
+
+bool TileRegion::intersects(const QRect &rect) const
+{
+    const QRect r = rect & mBounds;
+    if (r.isEmpty())
+        return false;
+
+    const int wordLeft = wordIndex(r.left());
+    const int wordRight = wordIndex(r.right());
+
+    for (int y = r.top(); y <= r.bottom(); ++y) {
+        const Word *words = row(y) - mWordLeft;
+        for (int w = wordLeft; w <= wordRight; ++w) {
+            const int first = (w == wordLeft) ? r.left() - w * WordBits : 0;
+            const int last = (w == wordRight) ? r.right() - w * WordBits
+                                              : WordBits - 1;
+            if (words[w] & bitMask(first, last))
+                return true;
+        }
+    }
+
+    return false;
+}
+
+bool TileRegion::intersects(const TileRegion &region) const
+{
+    const QRect r = mBounds & region.mBounds;
+    if (r.isEmpty())
+        return false;
+
+    const int wordLeft = wordIndex(r.left());
+    const int wordRight = wordIndex(r.right());
+
+    // Set bits are always within the bounds, so no masking is needed
+    for (int y = r.top(); y <= r.bottom(); ++y) {
+        const Word *words = row(y) - mWordLeft;
+        const Word *otherWords = region.row(y) - region.mWordLeft;
+        for (int w = wordLeft; w <= wordRight; ++w)
+            if (words[w] & otherWords[w])
+                return true;
+    }
+
+    return false;
+}
+
+void TileRegion::add(const QRect &rect)
+{
+    if (rect.isEmpty())
+        return;
+
+    reserve(rect);
+    setBits(rect, true);
+    mBounds |= rect;
+}
+
+void TileRegion::remove(const QRect &rect)
+{
+    const QRect r = rect & mBounds;
+    if (r.isEmpty())
+        return;
+
+    setBits(r, false);
+    updateBounds();
+}
+
+void TileRegion::clear()
+{
+    mBounds = QRect();
+    mTop = 0;
+    mRows = 0;
+    mWordLeft = 0;
+    mStride = 0;
+    mBits.clear();
+}
+
+TileRegion TileRegion::united(const TileRegion &region) const
+{
+    TileRegion result(*this);
+    result |= region;
+    return result;
+}
+
+TileRegion TileRegion::intersected(const TileRegion &region) const
+{
+    TileRegion result(*this);
+    result &= region;
+    return result;
+}
+
+TileRegion TileRegion::subtracted(const TileRegion &region) const
+{
+    TileRegion result(*this);
+    result -= region;
+    return result;
+}
+
+TileRegion TileRegion::translated(int dx, int dy) const
+{
+    if (isEmpty())
+        return *this;
+
+    // Moving by whole words only requires adjusting the origin
+    if (dx % WordBits == 0) {
+        TileRegion result(*this);
+        result.mTop += dy;
+        result.mWordLeft += dx / WordBits;
+        result.mBounds.translate(dx, dy);
+        return result;
+    }
+
+    TileRegion result;
+    result.reserve(mBounds.translated(dx, dy));
+
+    foreach (const QRect &run, runs())
+        result.setBits(run.translated(dx, dy), true);
+
+    result.mBounds = mBounds.translated(dx, dy);
+    return result;
+}
+
+TileRegion &TileRegion::operator|=(const TileRegion &region)
+{
+    if (region.isEmpty())
+        return *this;
+    if (isEmpty()) {
+        *this = region;
+        return *this;
+    }
+
+    reserve(region.mBounds);
+
+    const int wordLeft = wordIndex(region.mBounds.left());
+    const int wordRight = wordIndex(region.mBounds.right());
+
+    for (int y = region.mBounds.top(); y <= region.mBounds.bottom(); ++y) {
+        Word *words = row(y) - mWordLeft;
+        const Word *otherWords = region.row(y) - region.mWordLeft;
+        for (int w = wordLeft; w <= wordRight; ++w)
+            words[w] |= otherWords[w];
+    }
+
+    mBounds |= region.mBounds;
+    return *this;
+}
+
+TileRegion &TileRegion::operator&=(const TileRegion &region)
+{
+    const QRect r = mBounds & region.mBounds;
+    if (r.isEmpty()) {
+        clear();
+        return *this;
+    }
+
+    const int wordLeft = wordIndex(mBounds.left());
+    const int wordRight = wordIndex(mBounds.right());
+    const int otherWordLeft = wordIndex(region.mBounds.left());
+    const int otherWordRight = wordIndex(region.mBounds.right());
+
+    for (int y = mBounds.top(); y <= mBounds.bottom(); ++y) {
+        Word *words = row(y) - mWordLeft;
+
+        if (y < r.top() || y > r.bottom()) {
+            for (int w = wordLeft; w <= wordRight; ++w)
+                words[w] = 0;
+            continue;
+        }
+
+        const Word *otherWords = region.row(y) - region.mWordLeft;
+        for (int w = wordLeft; w <= wordRight; ++w) {
+            if (w < otherWordLeft || w > otherWordRight)
+                words[w] = 0;
+            else
+                words[w] &= otherWords[w];
+        }
+    }
+
+    mBounds = r;
+    updateBounds();
+    return *this;
+}
+
+TileRegion &TileRegion::operator-=(const TileRegion &region)
+{
+    const QRect r = mBounds & region.mBounds;
+    if (r.isEmpty())
+        return *this;
+
+    const int wordLeft = wordIndex(r.left());
+    const int wordRight = wordIndex(r.right());
+
+    for (int y = r.top(); y <= r.bottom(); ++y) {
+        Word *words = row(y) - mWordLeft;
+        const Word *otherWords = region.row(y) - region.mWordLeft;
+        for (int w = wordLeft; w <= wordRight; ++w)
+            words[w] &= ~otherWords[w];
+    }
+
+    updateBounds();
+    return *this;
+}
+
+bool TileRegion::operator==(const TileRegion &region) const
+{
+    if (mBounds != region.mBounds)
+        return false;
+    if (isEmpty())
+        return true;
+
+    const int wordLeft = wordIndex(mBounds.left());
+    const int wordRight = wordIndex(mBounds.right());
+
+    for (int y = mBounds.top(); y <= mBounds.bottom(); ++y) {
+        const Word *words = row(y) - mWordLeft;
+        const Word *otherWords = region.row(y) - region.mWordLeft;
+        for (int w = wordLeft; w <= wordRight; ++w)
+            if (words[w] != otherWords[w])
+                return false;
+    }
+
+    return true;
+}
+
+QVector<QRect> TileRegion::runs() const
+{
+    QVector<QRect> result;
+    for (int y = mBounds.top(); y <= mBounds.bottom(); ++y)
+        appendRuns(y, result);
+    return result;
+}
+
+QVector<QRect> TileRegion::rects() const
+{
+    QVector<QRect> result;
+    QVector<QRect> rowRuns;
+    int bandStart = 0;
+
+    for (int y = mBounds.top(); y <= mBounds.bottom(); ++y) {
+        rowRuns.resize(0);
+        appendRuns(y, rowRuns);
+
+        // Extend the previous band when this row has the same runs
+        bool sameRuns = bandStart < result.size() &&
+                result.size() - bandStart == rowRuns.size() &&
+                result.at(bandStart).bottom() == y - 1;
+
+        for (int i = 0; sameRuns && i < rowRuns.size(); ++i) {
+            const QRect &a = result.at(bandStart + i);
+            const QRect &b = rowRuns.at(i);
+            sameRuns = a.left() == b.left() && a.right() == b.right();
+        }
+
+        if (sameRuns) {
+            for (int i = bandStart; i < result.size(); ++i)
+                result[i].setBottom(y);
+        } else if (!rowRuns.isEmpty()) {
+            bandStart = result.size();
+            result += rowRuns;
+        }
+    }
+
+    return result;
+}
+
+QRegion TileRegion::toRegion() const
+{
+    const QVector<QRect> r = rects();
+
+    QRegion region;
+    region.setRects(r.constData(), r.size());
+    return region;
+}
+
+/**
+ * Appends the runs of tiles found on row \a y to \a runs.
+ */
+void TileRegion::appendRuns(int y, QVector<QRect> &runs) const
+{
+    const int wordLeft = wordIndex(mBounds.left());
+    const int wordRight = wordIndex(mBounds.right());
+    const Word *words = row(y) - mWordLeft;
+    int runStart = 0;
+    bool inRun = false;
+
+    for (int w = wordLeft; w <= wordRight; ++w) {
+        const Word word = words[w];
+        const int base = w * WordBits;
+        int pos = 0;
+
+        while (pos < WordBits) {
+            if (!inRun) {
+                const Word rest = word >> pos;
+                if (!rest)
+                    break;
+                pos += countTrailingZeros(rest);
+                runStart = base + pos;
+                inRun = true;
+            } else {
+                const Word rest = ~word >> pos;
+                if (!rest)
+                    break;  // The run continues in the next word
+                pos += countTrailingZeros(rest);
+                runs.append(QRect(runStart, y, base + pos - runStart, 1));
+                inRun = false;
+            }
+        }
+    }
+
+    if (inRun) {
+        const int end = (wordRight + 1) * WordBits;
+        runs.append(QRect(runStart, y, end - runStart, 1));
+    }
+}
+
+/**
+ * Makes sure the bitmap covers the given \a rect. When growing, some extra
+ * space is reserved so that adding tiles bit by bit stays efficient.
+ */
+void TileRegion::reserve(const QRect &rect)
+{
+    if (rect.isEmpty())
+        return;
+
+    int wordLeft = wordIndex(rect.left());
+    int wordRight = wordIndex(rect.right());
+    int top = rect.top();
+    int bottom = rect.bottom();
+
+    if (mStride > 0) {
+        const int currentRight = mWordLeft + mStride - 1;
+        const int currentBottom = mTop + mRows - 1;
+
+        if (wordLeft >= mWordLeft && wordRight <= currentRight &&
+                top >= mTop && bottom <= currentBottom)
+            return;
+
+        const int slackWords = mStride / 2;
+        const int slackRows = mRows / 2;
+
+        wordLeft = wordLeft < mWordLeft ? qMin(wordLeft, mWordLeft - slackWords)
+                                        : mWordLeft;
+        wordRight = wordRight > currentRight ? qMax(wordRight, currentRight + slackWords)
+                                             : currentRight;
+        top = top < mTop ? qMin(top, mTop - slackRows) : mTop;
+        bottom = bottom > currentBottom ? qMax(bottom, currentBottom + slackRows)
+                                        : currentBottom;
+    }
+
+    const int stride = wordRight - wordLeft + 1;
+    const int rows = bottom - top + 1;
+    QVector<Word> bits(stride * rows, 0);
+
+    for (int y = mBounds.top(); y <= mBounds.bottom(); ++y) {
+        memcpy(bits.data() + (y - top) * stride + (mWordLeft - wordLeft),
+               row(y),
+               mStride * sizeof(Word));
+    }
+
+    mBits = bits;
+    mTop = top;
+    mRows = rows;
+    mWordLeft = wordLeft;
+    mStride = stride;
+}
+
+/**
+ * Sets or clears the bits for the given \a rect, which needs to be covered
+ * by the bitmap.
+ */
+void TileRegion::setBits(const QRect &rect, bool value)
+{
+    const int wordLeft = wordIndex(rect.left());
+    const int wordRight = wordIndex(rect.right());
+
+    for (int y = rect.top(); y <= rect.bottom(); ++y) {
+        Word *words = row(y) - mWordLeft;
+        for (int w = wordLeft; w <= wordRight; ++w) {
+            const int first = (w == wordLeft) ? rect.left() - w * WordBits : 0;
+            const int last = (w == wordRight) ? rect.right() - w * WordBits
+                                              : WordBits - 1;
+            if (value)
+                words[w] |= bitMask(first, last);
+            else
+                words[w] &= ~bitMask(first, last);
+        }
+    }
+}
+
+/**
+ * Shrinks the bounds to fit the tiles that are left after removing tiles.
+ */
+void TileRegion::updateBounds()
+{
+    const int wordLeft = wordIndex(mBounds.left());
+    const int wordRight = wordIndex(mBounds.right());
+
+    int top = INT_MAX;
+    int bottom = INT_MIN;
+    int left = INT_MAX;
+    int right = INT_MIN;
+
+    for (int y = mBounds.top(); y <= mBounds.bottom(); ++y) {
+        const Word *words = row(y) - mWordLeft;
+        for (int w = wordLeft; w <= wordRight; ++w) {
+            const Word word = words[w];
+            if (!word)
+                continue;
+
+            top = qMin(top, y);
+            bottom = y;
+            left = qMin(left, w * WordBits + countTrailingZeros(word));
+            right = qMax(right, w * WordBits + (WordBits - 1) -
+                         countLeadingZeros(word));
+        }
+    }
+
+    if (top > bottom)
+        clear();
+    else
+        mBounds = QRect(QPoint(left, top), QPoint(right, bottom));
+}
@@ -0,0 +1,181 @@
+/*
+ * tileregion.h
+ * Copyright 2026, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of libtiled.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef TILEREGION_H
+#define TILEREGION_H
+
+#include "tiled_global.h"
+
+#include <QRect>
+#include <QRegion>
+#include <QVector>
+
+namespace Tiled {
+
+/**
+ * A set of tile positions, stored as a bitmap covering its bounds.
+ *
+ * Unlike QRegion, which stores a list of rectangles, the cost of adding,
+ * removing and looking up tiles does not depend on how fragmented the shape
+ * is. This makes it suitable for things like fill regions and rule regions,
+ * which are often made up of many small pieces.
+ *
+ * Each row of the bitmap is stored as a range of 64-bit words, aligned to
+ * multiples of 64 tiles. This means combining two regions only requires
+ * combining their words, regardless of where each region starts.
+ *
+ * The data is implicitly shared, so copying a region is cheap. Use
+ * toRegion() to convert a region to a QRegion where it is needed for
+ * interfacing with Qt, for example when scheduling repaints.
+ */
+class TILEDSHARED_EXPORT TileRegion
+{
+public:
+    /**
+     * Constructs an empty region.
+     */
+    TileRegion();
+
+    /**
+     * Constructs a region covering the given \a rect.
+     */
+    TileRegion(const QRect &rect);
+
+    /**
+     * Constructs a region covering the same tiles as the given \a region.
+     */
+    explicit TileRegion(const QRegion &region);
+
+    bool isEmpty() const { return mBounds.isEmpty(); }
+
+    /**
+     * Returns the smallest rectangle containing all tiles in this region.
+     */
+    QRect boundingRect() const { return mBounds; }
+
+    /**
+     * Returns the number of tiles in this region.
+     */
+    int tileCount() const;
+
+    bool contains(int x, int y) const;
+    bool contains(const QPoint &pos) const { return contains(pos.x(), pos.y()); }
+
+    bool intersects(const QRect &rect) const;
+    bool intersects(const TileRegion &region) const;
+
+    /**
+     * Adds the tile at the given position to this region.
+     */
+    void add(int x, int y) { add(QRect(x, y, 1, 1)); }
+    void add(const QRect &rect);
+
+    /**
+     * Removes the tiles in the given \a rect from this region.
+     */
+    void remove(const QRect &rect);
+
+    void clear();
+
+    TileRegion united(const TileRegion &region) const;
+    TileRegion intersected(const TileRegion &region) const;
+    TileRegion subtracted(const TileRegion &region) const;
+    TileRegion translated(int dx, int dy) const;
+    TileRegion translated(const QPoint &offset) const
+    { return translated(offset.x(), offset.y()); }
+
+    TileRegion &operator|=(const TileRegion &region);
+    TileRegion &operator&=(const TileRegion &region);
+    TileRegion &operator-=(const TileRegion &region);
+
+    TileRegion operator|(const TileRegion &region) const
+    { return united(region); }
+    TileRegion operator&(const TileRegion &region) const
+    { return intersected(region); }
+    TileRegion operator-(const TileRegion &region) const
+    { return subtracted(region); }
+
+    bool operator==(const TileRegion &region) const;
+    bool operator!=(const TileRegion &region) const
+    { return !(*this == region); }
+
+    /**
+     * Returns the horizontal runs of tiles in this region, as rectangles with
+     * a height of one tile, sorted by y and then by x.
+     *
+     * This is the most efficient way to iterate over all tiles.
+     */
+    QVector<QRect> runs() const;
+
+    /**
+     * Returns the rectangles making up this region, in y-x sorted order.
+     * Consecutive rows with the same runs are merged into a single band.
+     */
+    QVector<QRect> rects() const;
+
+    /**
+     * Returns this region as a QRegion.
+     */
+    QRegion toRegion() const;
+
+    /**
+     * Returns the number of bytes allocated for the bitmap of this region.
+     */
+    qint64 memoryUsage() const
+    { return qint64(mBits.capacity()) * sizeof(Word); }
+
+private:
+    typedef quint64 Word;
+
+    enum { WordBits = 64 };
+
+    static int wordIndex(int x)
+    { return x >= 0 ? x / WordBits : -((-x + WordBits - 1) / WordBits); }
+
+    const Word *row(int y) const
+    { return mBits.constData() + (y - mTop) * mStride; }
+    Word *row(int y)
+    { return mBits.data() + (y - mTop) * mStride; }
+
+    void appendRuns(int y, QVector<QRect> &runs) const;
+
+    void reserve(const QRect &rect);
+    void setBits(const QRect &rect, bool value);
+    void updateBounds();
+
+    QRect mBounds;      // Tight bounds of the tiles in the region
+    int mTop;           // First row of the bitmap
+    int mRows;          // Number of rows in the bitmap
+    int mWordLeft;      // Index of the first word column of the bitmap
+    int mStride;        // Number of words per row
+    QVector<Word> mBits;
+};
+
+} // namespace Tiled
+
+#endif // TILEREGION_H
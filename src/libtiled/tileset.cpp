@@ -28,10 +28,11 @@
  */
 
 #include "tileset.h"
+#include "imagecache.h"
 #include "tile.h"
 #include "terrain.h"
 
-#include <QBitmap>
+#include <climits>
 
 using namespace Tiled;
 
@@ -52,45 +53,82 @@ bool Tileset::loadFromImage(const QImage &image, const QString &fileName)
     if (image.isNull())
         return false;
 
-    const int stopWidth = image.width() - mTileWidth;
-    const int stopHeight = image.height() - mTileHeight;
+    loadFromPixmap(ImageCache::loadPixmap(fileName, mTransparentColor, image),
+                   fileName);
+    return true;
+}
+
+bool Tileset::loadFromImage(const QString &fileName)
+{
+    Q_ASSERT(mTileWidth > 0 && mTileHeight > 0);
+
+    const QPixmap pixmap = ImageCache::loadPixmap(fileName, mTransparentColor);
+    if (pixmap.isNull())
+        return false;
+
+    loadFromPixmap(pixmap, fileName);
+    return true;
+}
+
+void Tileset::loadFromPixmap(const QPixmap &pixmap, const QString &fileName)
+{
+    // The tiles all refer to their area of the same pixmap
+    const int stopWidth = pixmap.width() - mTileWidth;
+    const int stopHeight = pixmap.height() - mTileHeight;
 
     int oldTilesetSize = mTiles.size();
     int tileNum = 0;
 
     for (int y = mMargin; y <= stopHeight; y += mTileHeight + mTileSpacing) {
         for (int x = mMargin; x <= stopWidth; x += mTileWidth + mTileSpacing) {
-            const QImage tileImage = image.copy(x, y, mTileWidth, mTileHeight);
-            QPixmap tilePixmap = QPixmap::fromImage(tileImage);
-
-            if (mTransparentColor.isValid()) {
-                const QImage mask =
-                        tileImage.createMaskFromColor(mTransparentColor.rgb());
-                tilePixmap.setMask(QBitmap::fromImage(mask));
-            }
+            const QRect rect(x, y, mTileWidth, mTileHeight);
 
             if (tileNum < oldTilesetSize) {
-                mTiles.at(tileNum)->setImage(tilePixmap);
+                mTiles.at(tileNum)->setImage(pixmap, rect);
             } else {
-                mTiles.append(new Tile(tilePixmap, tileNum, this));
+                Tile *tile = new Tile(pixmap, tileNum, this);
+                tile->setImage(pixmap, rect);
+                mTiles.append(tile);
+                mTerrainDistancesDirty = true;
             }
             ++tileNum;
         }
     }
 
     // Blank out any remaining tiles to avoid confusion
-    while (tileNum < oldTilesetSize) {
+    if (tileNum < oldTilesetSize) {
         QPixmap tilePixmap = QPixmap(mTileWidth, mTileHeight);
         tilePixmap.fill();
-        mTiles.at(tileNum)->setImage(tilePixmap);
-        ++tileNum;
+
+        while (tileNum < oldTilesetSize) {
+            mTiles.at(tileNum)->setImage(tilePixmap);
+            ++tileNum;
+        }
     }
 
-    mImageWidth = image.width();
-    mImageHeight = image.height();
+    mImageWidth = pixmap.width();
+    mImageHeight = pixmap.height();
+    mColumnCount = columnCountForWidth(mImageWidth);
+    mImageSource = fileName;
+}
+
+void Tileset::prepareImage(const QSize &size, const QString &fileName)
+{
+    Q_ASSERT(mTileWidth > 0 && mTileHeight > 0);
+
+    const int columns = qMax(0, columnCountForWidth(size.width()));
+    const int rows = qMax(0, (size.height() - mMargin + mTileSpacing) /
+                          (mTileHeight + mTileSpacing));
+
+    for (int tileNum = mTiles.size(); tileNum < columns * rows; ++tileNum) {
+        mTiles.append(new Tile(QPixmap(), tileNum, this));
+        mTerrainDistancesDirty = true;
+    }
+
+    mImageWidth = size.width();
+    mImageHeight = size.height();
     mColumnCount = columnCountForWidth(mImageWidth);
     mImageSource = fileName;
-    return true;
 }
 
 Tileset *Tileset::findSimilarTileset(const QList<Tileset*> &tilesets) const
@@ -169,111 +207,210 @@ Terrain *Tileset::takeTerrainAt(int index)
 
 int Tileset::terrainTransitionPenalty(int terrainType0, int terrainType1)
 {
-    if (mTerrainDistancesDirty) {
-        recalculateTerrainDistances();
-        mTerrainDistancesDirty = false;
+    updateTerrainIndex();
+
+    // No terrain may be passed as either -1 or 255
+    return cornerPenalty(terrainType0 & 0xFF, terrainType1 & 0xFF);
+}
+
+static bool lessThanId(const Tile *a, const Tile *b)
+{
+    return a->id() < b->id();
+}
+
+QList<Tile*> Tileset::findTerrainMatches(unsigned terrain,
+                                         unsigned considerationMask)
+{
+    updateTerrainIndex();
+
+    const quint64 key = quint64(considerationMask) << 32 | terrain;
+    QHash<quint64, QList<Tile*> >::const_iterator it =
+            mTerrainMatches.find(key);
+    if (it != mTerrainMatches.end())
+        return it.value();
+
+    const QVector<unsigned> candidates =
+            terrainCandidates(considerationMask).value(terrain &
+                                                       considerationMask);
+
+    QVector<unsigned> bestTerrains;
+    int penalty = INT_MAX;
+
+    foreach (unsigned candidate, candidates) {
+        // Calculate the transition penalty based on the shortest distance to
+        // the target terrain type for each corner
+        int transitionPenalty = 0;
+        for (int shift = 0; shift < 32; shift += 8) {
+            const int cornerTransition = cornerPenalty(
+                        (candidate >> shift) & 0xFF,
+                        (terrain >> shift) & 0xFF);
+
+            // If there is no path to the destination terrain, this isn't a
+            // useful transition
+            if (cornerTransition < 0) {
+                transitionPenalty = -1;
+                break;
+            }
+            transitionPenalty += cornerTransition;
+        }
+
+        if (transitionPenalty < 0 || transitionPenalty > penalty)
+            continue;
+
+        if (transitionPenalty < penalty)
+            bestTerrains.clear();
+        penalty = transitionPenalty;
+
+        bestTerrains.append(candidate);
     }
 
-    terrainType0 = terrainType0 == 255 ? -1 : terrainType0;
-    terrainType1 = terrainType1 == 255 ? -1 : terrainType1;
+    QList<Tile*> matches;
+    foreach (unsigned bestTerrain, bestTerrains)
+        matches.append(mTilesByTerrain.value(bestTerrain));
+
+    if (bestTerrains.size() > 1)
+        qSort(matches.begin(), matches.end(), lessThanId);
 
-    // Do some magic, since we don't have a transition array for no-terrain
-    if (terrainType0 == -1 && terrainType1 == -1)
-        return 0;
-    if (terrainType0 == -1)
-        return mTerrainTypes.at(terrainType1)->transitionDistance(terrainType0);
-    return mTerrainTypes.at(terrainType0)->transitionDistance(terrainType1);
+    mTerrainMatches.insert(key, matches);
+    return matches;
 }
 
-void Tileset::recalculateTerrainDistances()
+void Tileset::updateTerrainIndex()
 {
-    // some fancy macros which can search for a value in each byte of a word simultaneously
-    #define hasZeroByte(dword) (((dword) - 0x01010101UL) & ~(dword) & 0x80808080UL)
-    #define hasByteEqualTo(dword, value) (hasZeroByte((dword) ^ (~0UL/255 * (value))))
+    if (!mTerrainDistancesDirty)
+        return;
 
-    // Terrain distances are the number of transitions required before one terrain may meet another
-    // Terrains that have no transition path have a distance of -1
+    recalculateTerrainDistances();
 
-    for (int i = 0; i < terrainCount(); ++i) {
-        Terrain *type = terrain(i);
-        QVector<int> distance(terrainCount() + 1, -1);
+    // Bucket the tiles by their terrain. The other parts of the index are
+    // built as they are needed.
+    mTilesByTerrain.clear();
+    foreach (Tile *tile, mTiles)
+        mTilesByTerrain[tile->terrain()].append(tile);
 
-        // Check all tiles for transitions to other terrain types
-        for (int j = 0; j < tileCount(); ++j) {
-            Tile *t = tileAt(j);
+    mTerrainCandidates.clear();
+    mTerrainMatches.clear();
 
-            if (!hasByteEqualTo(t->terrain(), i))
-                continue;
+    mTerrainDistancesDirty = false;
+}
+
+const QHash<unsigned, QVector<unsigned> > &Tileset::terrainCandidates(
+        unsigned considerationMask)
+{
+    typedef QHash<unsigned, QVector<unsigned> > Candidates;
 
-            // This tile has transitions, add the transitions as neightbours (distance 1)
-            int tl = t->cornerTerrainId(0);
-            int tr = t->cornerTerrainId(1);
-            int bl = t->cornerTerrainId(2);
-            int br = t->cornerTerrainId(3);
+    QHash<unsigned, Candidates>::iterator it =
+            mTerrainCandidates.find(considerationMask);
 
-            // Terrain on diagonally opposite corners are not actually a neighbour
-            if (tl == i || br == i) {
-                distance[tr + 1] = 1;
-                distance[bl + 1] = 1;
-            }
-            if (tr == i || bl == i) {
-                distance[tl + 1] = 1;
-                distance[br + 1] = 1;
-            }
+    if (it == mTerrainCandidates.end()) {
+        it = mTerrainCandidates.insert(considerationMask, Candidates());
 
-            // terrain has at least one tile of its own type
-            distance[i + 1] = 0;
-        }
+        QHash<unsigned, QList<Tile*> >::const_iterator i =
+                mTilesByTerrain.constBegin();
+        QHash<unsigned, QList<Tile*> >::const_iterator i_end =
+                mTilesByTerrain.constEnd();
+
+        for (; i != i_end; ++i)
+            (*it)[i.key() & considerationMask].append(i.key());
+    }
+
+    return it.value();
+}
+
+int Tileset::cornerPenalty(unsigned corner0, unsigned corner1) const
+{
+    const int count = terrainCount() + 1;
+    const int index0 = corner0 == 0xFF ? 0 : corner0 + 1;
+    const int index1 = corner1 == 0xFF ? 0 : corner1 + 1;
+
+    if (index0 >= count || index1 >= count)
+        return -1;
+
+    return mTerrainPenalties.at(index0 * count + index1);
+}
+
+void Tileset::recalculateTerrainDistances()
+{
+    // Terrain distances are the number of transitions required before one
+    // terrain may meet another. Terrains that have no transition path have a
+    // distance of -1. Index 0 of the matrix is used for 'no terrain'.
+    const int count = terrainCount() + 1;
+    const int unreachable = INT_MAX / 2;
+
+    QVector<int> distance(count * count, unreachable);
+    distance[0] = 0;
+
+    // Any two terrains on adjacent corners of a tile are neighbours (distance
+    // 1). Terrain on diagonally opposite corners are not actually neighbours.
+    static const int adjacentCorners[4][2] = { {0, 1}, {0, 2}, {1, 3}, {2, 3} };
 
-        type->setTransitionDistances(distance);
+    foreach (Tile *tile, mTiles) {
+        int corners[4];
+        bool valid = true;
+        for (int corner = 0; corner < 4; ++corner) {
+            corners[corner] = tile->cornerTerrainId(corner) + 1;
+            valid &= corners[corner] < count;
+        }
+        if (!valid)
+            continue;
+
+        // A terrain has at least one tile of its own type
+        for (int corner = 0; corner < 4; ++corner)
+            distance[corners[corner] * count + corners[corner]] = 0;
+
+        for (int pair = 0; pair < 4; ++pair) {
+            const int a = corners[adjacentCorners[pair][0]];
+            const int b = corners[adjacentCorners[pair][1]];
+            if (a != b) {
+                distance[a * count + b] = 1;
+                distance[b * count + a] = 1;
+            }
+        }
     }
 
-    // Calculate indirect transition distances
-    bool bNewConnections;
-    do {
-        bNewConnections = false;
-
-        // For each combination of terrain types
-        for (int i = 0; i < terrainCount(); ++i) {
-            Terrain *t0 = terrain(i);
-            for (int j = 0; j < terrainCount(); ++j) {
-                if (i == j)
-                    continue;
-                Terrain *t1 = terrain(j);
-
-                // Scan through each terrain type, and see if we have any in common
-                for (int t = -1; t < terrainCount(); ++t) {
-                    int d0 = t0->transitionDistance(t);
-                    int d1 = t1->transitionDistance(t);
-                    if (d0 == -1 || d1 == -1)
-                        continue;
-
-                    // We have cound a common connection
-                    int d = t0->transitionDistance(j);
-                    Q_ASSERT(t1->transitionDistance(i) == d);
-
-                    // If the new path is shorter, record the new distance
-                    if (d == -1 || d0 + d1 < d) {
-                        d = d0 + d1;
-                        t0->setTransitionDistance(j, d);
-                        t1->setTransitionDistance(i, d);
-
-                        // We're making progress, flag for another iteration...
-                        bNewConnections = true;
-                    }
-                }
+    // Only direct transitions to and from 'no terrain' are considered
+    const QVector<int> noTerrainDistance(distance.mid(0, count));
+
+    // Calculate indirect transition distances (Floyd-Warshall)
+    for (int k = 0; k < count; ++k) {
+        const int *rowK = distance.constData() + k * count;
+
+        for (int i = 0; i < count; ++i) {
+            int *rowI = distance.data() + i * count;
+            const int ik = rowI[k];
+            if (ik == unreachable)
+                continue;
+
+            for (int j = 0; j < count; ++j) {
+                const int d = ik + rowK[j];
+                if (d < rowI[j])
+                    rowI[j] = d;
             }
         }
+    }
+
+    for (int j = 0; j < count; ++j) {
+        distance[j] = noTerrainDistance.at(j);
+        distance[j * count] = noTerrainDistance.at(j);
+    }
 
-        // Repeat while we are still making new connections (could take a
-        // number of iterations for distant terrain types to connect)
-    } while (bNewConnections);
+    for (int i = 0; i < distance.size(); ++i)
+        if (distance.at(i) >= unreachable)
+            distance[i] = -1;
+
+    // Also store the distances with each terrain type
+    for (int i = 0; i < terrainCount(); ++i)
+        terrain(i)->setTransitionDistances(distance.mid((i + 1) * count,
+                                                        count));
+
+    mTerrainPenalties = distance;
 }
 
 Tile *Tileset::addTile(const QPixmap &image, const QString &source)
 {
     Tile *newTile = new Tile(image, source, tileCount(), this);
     mTiles.append(newTile);
+    mTerrainDistancesDirty = true;
     if (mTileHeight < image.height())
         mTileHeight = image.height();
     if (mTileWidth < image.width())
@@ -291,6 +428,7 @@ void Tileset::insertTiles(int index, const QList<Tile *> &tiles)
     for (int i = index + count; i < mTiles.size(); ++i)
         mTiles.at(i)->mId += count;
 
+    mTerrainDistancesDirty = true;
     updateTileSize();
 }
 
@@ -305,6 +443,7 @@ void Tileset::removeTiles(int index, int count)
     for (; last != mTiles.end(); ++last)
         (*last)->mId -= count;
 
+    mTerrainDistancesDirty = true;
     updateTileSize();
 }
 
@@ -319,7 +458,7 @@ void Tileset::setTileImage(int id, const QPixmap &image,
     if (!tile)
         return;
 
-    const QSize previousImageSize = tile->image().size();
+    const QSize previousImageSize = tile->size();
     const QSize newImageSize = image.size();
 
     tile->setImage(image);
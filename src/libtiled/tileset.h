@@ -33,6 +33,7 @@
 #include "object.h"
 
 #include <QColor>
+#include <QHash>
 #include <QList>
 #include <QVector>
 #include <QPoint>
@@ -77,7 +78,7 @@ public:
         mImageWidth(0),
         mImageHeight(0),
         mColumnCount(0),
-        mTerrainDistancesDirty(false)
+        mTerrainDistancesDirty(true)
     {
         Q_ASSERT(tileSpacing >= 0);
         Q_ASSERT(margin >= 0);
@@ -210,6 +211,27 @@ public:
      */
     bool loadFromImage(const QImage &image, const QString &fileName);
 
+    /**
+     * Loads this tileset from the image file \a fileName. The image is
+     * looked up in the ImageCache, so that tilesets using the same image
+     * share their pixmap.
+     *
+     * @see loadFromImage(const QImage &, const QString &)
+     */
+    bool loadFromImage(const QString &fileName);
+
+    /**
+     * Creates the tiles for a tileset image of the given \a size, without
+     * giving them an image yet. This allows the tileset image to be decoded
+     * in the background, after which loadFromImage() sets the images of the
+     * tiles.
+     *
+     * @param size     the size of the tileset image
+     * @param fileName the file name of the image, which will be remembered
+     *                 as the image source of this tileset.
+     */
+    void prepareImage(const QSize &size, const QString &fileName);
+
     /**
      * This checks if there is a similar tileset in the given list.
      * It is needed for replacing this tileset by its similar copy.
@@ -277,6 +299,18 @@ public:
      */
     int terrainTransitionPenalty(int terrainType0, int terrainType1);
 
+    /**
+     * Returns the tiles that best match the given \a terrain. The corners
+     * selected by \a considerationMask have to match exactly, while for the
+     * other corners the tiles with the lowest total transition penalty are
+     * chosen. The tiles are returned in order of their ID.
+     *
+     * The matches are looked up in an index of the terrain information of
+     * the tiles, which is rebuilt when this information changes.
+     */
+    QList<Tile*> findTerrainMatches(unsigned terrain,
+                                    unsigned considerationMask);
+
     /**
      * Add a new tile to the end of the tileset
      */
@@ -292,21 +326,48 @@ public:
                       const QString &source = QString());
 
     /**
-     * Used by the Tile class when its terrain information changes.
+     * Used by the Tile class when its terrain information changes. This
+     * invalidates the terrain distances as well as the terrain index.
      */
     void markTerrainDistancesDirty() { mTerrainDistancesDirty = true; }
 
 private:
+    /**
+     * Sets the images of the tiles to the areas of the given \a pixmap.
+     */
+    void loadFromPixmap(const QPixmap &pixmap, const QString &fileName);
+
     /**
      * Sets tile size to the maximum size.
      */
     void updateTileSize();
 
     /**
-     * Calculates the transition distance matrix for all terrain types.
+     * Calculates the transition distance matrix for all terrain types. The
+     * matrix is stored in a single vector, with an additional row and column
+     * for 'no terrain'.
      */
     void recalculateTerrainDistances();
 
+    /**
+     * Recalculates the terrain distances and clears the terrain index when
+     * the terrain information is dirty.
+     */
+    void updateTerrainIndex();
+
+    /**
+     * Returns the distinct terrains of the tiles in this tileset, grouped by
+     * their terrain on the corners selected by \a considerationMask.
+     */
+    const QHash<unsigned, QVector<unsigned> > &terrainCandidates(
+            unsigned considerationMask);
+
+    /**
+     * Returns the transition penalty between two corners, given the packed
+     * terrain id stored for each of them.
+     */
+    int cornerPenalty(unsigned corner0, unsigned corner1) const;
+
     QString mName;
     QString mFileName;
     QString mImageSource;
@@ -322,6 +383,14 @@ private:
     QList<Tile*> mTiles;
     QList<Terrain*> mTerrainTypes;
     bool mTerrainDistancesDirty;
+
+    // The terrain distance matrix, see recalculateTerrainDistances()
+    QVector<int> mTerrainPenalties;
+
+    // The terrain index, see updateTerrainIndex()
+    QHash<unsigned, QList<Tile*> > mTilesByTerrain;
+    QHash<unsigned, QHash<unsigned, QVector<unsigned> > > mTerrainCandidates;
+    QHash<quint64, QList<Tile*> > mTerrainMatches;
 };
 
 } // namespace Tiled
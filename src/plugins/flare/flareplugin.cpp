@@ -119,7 +119,7 @@ Tiled::Map *FlarePlugin::read(const QString &fileName)
 
                 Tileset *tileset = new Tileset(QFileInfo(absoluteSource).fileName(),
                                                tilesetwidth, tilesetheight);
-                bool ok = tileset->loadFromImage(QImage(absoluteSource), absoluteSource);
+                bool ok = tileset->loadFromImage(absoluteSource);
 
                 if (!tileset || !ok) {
                     mError = tr("Error loading tileset %1, which expands to %2. Path not found!")
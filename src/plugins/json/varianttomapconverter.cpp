@@ -138,7 +138,7 @@ Tileset *VariantToMapConverter::toTileset(const QVariant &variant)
     if (QDir::isRelativePath(imageSource))
         imageSource = QDir::cleanPath(mMapDir.absoluteFilePath(imageSource));
 
-    if (!tileset->loadFromImage(QImage(imageSource), imageSource)) {
+    if (!tileset->loadFromImage(imageSource)) {
         mError = tr("Error loading tileset image:\n'%1'").arg(imageSource);
         return 0;
     }
@@ -387,7 +387,7 @@ ImageLayer *VariantToMapConverter::toImageLayer(const QVariantMap &variantMap)
         if (QDir::isRelativePath(imageSource))
             imageSource = QDir::cleanPath(mMapDir.absoluteFilePath(imageSource));
 
-        if (!imageLayer->loadFromImage(QImage(imageSource), imageSource)) {
+        if (!imageLayer->loadFromImage(imageSource)) {
             mError = tr("Error loading image:\n'%1'").arg(imageSource);
             return 0;
         }
@@ -323,7 +323,7 @@ QString TenginePlugin::constructArgs(Tiled::Properties props, QList<QString> pro
 QString TenginePlugin::constructAdditionalTable(Tiled::Properties props, QList<QString> propOrder) const
 {
     QString tableString;
-    QMap<QString, QString> unhandledProps = QMap<QString, QString>(props);
+    Properties unhandledProps = props;
     // Remove handled properties
     for (int i = 0; i < propOrder.size(); i++) {
         unhandledProps.remove(propOrder[i]);
@@ -331,9 +331,9 @@ QString TenginePlugin::constructAdditionalTable(Tiled::Properties props, QList<Q
     // Construct the Lua string
     if (unhandledProps.size() > 0) {
         tableString = "{";
-        QMapIterator<QString, QString> i(unhandledProps);
-        while (i.hasNext()) {
-            i.next();
+        Properties::const_iterator i = unhandledProps.constBegin();
+        Properties::const_iterator i_end = unhandledProps.constEnd();
+        for (; i != i_end; ++i) {
             tableString = QString("%1%2=%3,").arg(tableString, i.key(), i.value());
         }
         tableString = QString("%1}").arg(tableString);
@@ -30,19 +30,47 @@ namespace Internal {
 AddRemoveLayer::AddRemoveLayer(MapDocument *mapDocument,
                                int index,
                                Layer *layer)
-    : mMapDocument(mapDocument)
+    : CommandMemoryUsage(mapDocument->undoStorage())
+    , mMapDocument(mapDocument)
     , mLayer(layer)
     , mIndex(index)
+    , mSwapOffset(-1)
+    , mLoadFailed(false)
 {
 }
 
 AddRemoveLayer::~AddRemoveLayer()
 {
+    if (mSwapOffset != -1)
+        undoStorage()->release(mSwapOffset);
+
     delete mLayer;
 }
 
+qint64 AddRemoveLayer::memoryUsage() const
+{
+    if (mSwapOffset != -1)
+        return sizeof(AddRemoveLayer);
+
+    return sizeof(AddRemoveLayer) + UndoStorage::layerMemoryUsage(mLayer);
+}
+
+void AddRemoveLayer::swapOut()
+{
+    if (mLayer && mSwapOffset == -1)
+        mSwapOffset = undoStorage()->storeLayer(mLayer);
+}
+
 void AddRemoveLayer::addLayer()
 {
+    // A layer whose cells could not be loaded is not added back, and from
+    // then on the command does nothing, so that it never removes another
+    // layer that ended up at its index
+    if (mLoadFailed || !swapIn()) {
+        mLoadFailed = true;
+        return;
+    }
+
     const int currentLayer = mMapDocument->currentLayerIndex();
 
     mMapDocument->layerModel()->insertLayer(mIndex, mLayer);
@@ -53,8 +81,29 @@ void AddRemoveLayer::addLayer()
         mMapDocument->setCurrentLayerIndex(currentLayer + 1);
 }
 
+/**
+ * Loads the cells of the layer when they were swapped out. Returns whether
+ * the layer is complete.
+ */
+bool AddRemoveLayer::swapIn()
+{
+    markUsed();
+
+    if (mSwapOffset == -1)
+        return true;
+
+    const bool loaded = undoStorage()->loadLayer(mLayer, mSwapOffset);
+    undoStorage()->release(mSwapOffset);
+    mSwapOffset = -1;
+
+    return loaded;
+}
+
 void AddRemoveLayer::removeLayer()
 {
+    if (mLoadFailed)
+        return;
+
     const int currentLayer = mMapDocument->currentLayerIndex();
 
     mLayer = mMapDocument->layerModel()->takeLayerAt(mIndex);
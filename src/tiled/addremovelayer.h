@@ -21,6 +21,8 @@
 #ifndef ADDREMOVELAYER_H
 #define ADDREMOVELAYER_H
 
+#include "undostorage.h"
+
 #include <QCoreApplication>
 #include <QUndoCommand>
 
@@ -35,21 +37,29 @@ class MapDocument;
 /**
  * Abstract base class for AddLayer and RemoveLayer.
  */
-class AddRemoveLayer : public QUndoCommand
+class AddRemoveLayer : public QUndoCommand, public CommandMemoryUsage
 {
 public:
     AddRemoveLayer(MapDocument *mapDocument, int index, Layer *layer);
 
     ~AddRemoveLayer();
 
+    qint64 memoryUsage() const;
+    void swapOut();
+    bool isSwappedOut() const { return mSwapOffset != -1; }
+
 protected:
     void addLayer();
     void removeLayer();
 
 private:
+    bool swapIn();
+
     MapDocument *mMapDocument;
     Layer *mLayer;
     int mIndex;
+    qint64 mSwapOffset;
+    bool mLoadFailed;
 };
 
 /**
@@ -38,6 +38,8 @@
 #include "tilesetmanager.h"
 
 #include <QDebug>
+#include <QThread>
+#include <QtConcurrentMap>
 
 using namespace Tiled;
 using namespace Tiled::Internal;
@@ -296,15 +298,13 @@ bool AutoMapper::setupRuleList()
     QList<QRegion> rulesOutput = coherentRegions(
             mLayerOutputRegions->region());
 
-    for (int i = 0; i < combinedRegions.size(); ++i) {
-        mRulesInput.append(QRegion());
-        mRulesOutput.append(QRegion());
-    }
+    QVector<QRegion> ruleInputRegions(combinedRegions.size());
+    QVector<QRegion> ruleOutputRegions(combinedRegions.size());
 
     foreach(QRegion reg, rulesInput)
         for (int i = 0; i < combinedRegions.size(); ++i) {
             if (reg.intersects(combinedRegions[i])) {
-                mRulesInput[i] += reg;
+                ruleInputRegions[i] += reg;
                 break;
             }
         }
@@ -312,15 +312,19 @@ bool AutoMapper::setupRuleList()
     foreach(QRegion reg, rulesOutput)
         for (int i = 0; i < combinedRegions.size(); ++i) {
             if (reg.intersects(combinedRegions[i])) {
-                mRulesOutput[i] += reg;
+                ruleOutputRegions[i] += reg;
                 break;
             }
         }
 
-    Q_ASSERT(mRulesInput.size() == mRulesOutput.size());
-    for (int i = 0; i < mRulesInput.size(); ++i) {
-        const QRegion checkCoherent = mRulesInput.at(i).united(mRulesOutput.at(i));
+    for (int i = 0; i < combinedRegions.size(); ++i) {
+        const QRegion checkCoherent =
+                ruleInputRegions.at(i).united(ruleOutputRegions.at(i));
         Q_ASSERT(coherentRegions(checkCoherent).length() == 1);
+        Q_UNUSED(checkCoherent)
+
+        mRulesInput.append(TileRegion(ruleInputRegions.at(i)));
+        mRulesOutput.append(TileRegion(ruleOutputRegions.at(i)));
     }
 
     return true;
@@ -340,6 +344,11 @@ bool AutoMapper::prepareAutoMap()
     if (!setupTilesets(mMapRules, mMapWork))
         return false;
 
+    // The compiled rules are kept between automapping operations, since the
+    // rule map does not change
+    if (mCompiledRules.size() != mRulesInput.size())
+        compileRules();
+
     return true;
 }
 
@@ -435,25 +444,36 @@ bool AutoMapper::setupTilesets(Map *src, Map *dst)
         }
         src->replaceTileset(tileset, replacement);
 
+        // The compiled rules refer to the tiles of the replaced tileset
+        mCompiledRules.clear();
+
         tilesetManager->addReference(replacement);
         tilesetManager->removeReference(tileset);
     }
     return true;
 }
 
-void AutoMapper::autoMap(QRegion *where)
+static bool containsAny(const QSet<QString> &set, const QSet<QString> &values)
+{
+    foreach (const QString &value, values)
+        if (set.contains(value))
+            return true;
+    return false;
+}
+
+void AutoMapper::autoMap(QRegion *where, QSet<QString> *changedLayers)
 {
     Q_ASSERT(mRulesInput.size() == mRulesOutput.size());
     // first resize the active area
     if (mAutoMappingRadius) {
-        QRegion region;
+        TileRegion region(*where);
         foreach (const QRect &r, where->rects()) {
-            region += r.adjusted(- mAutoMappingRadius,
-                                 - mAutoMappingRadius,
-                                 + mAutoMappingRadius,
-                                 + mAutoMappingRadius);
+            region.add(r.adjusted(- mAutoMappingRadius,
+                                  - mAutoMappingRadius,
+                                  + mAutoMappingRadius,
+                                  + mAutoMappingRadius));
         }
-        *where += region;
+        *where = region.toRegion();
     }
 
     // delete all the relevant area, if the property "DeleteTiles" is set
@@ -474,20 +494,46 @@ void AutoMapper::autoMap(QRegion *where)
                                            region);
             }
         }
+
+        // Rules in later rule files may read from the erased layers
+        if (changedLayers)
+            *changedLayers |= mTouchedTileLayers;
     }
 
+    // When only some layers have changed, the rules that neither read from
+    // nor write to any of them would give the same result as before, so they
+    // are skipped.
+    // This can't be done when the tiles were deleted first, since then all
+    // rules are needed to fill in the deleted area again.
+    const bool skipUnaffectedRules = changedLayers && !mDeleteTiles;
+
     // Increase the given region where the next automapper should work.
-    // This needs to be done, so you can rely on the order of the rules at all
-    // locations
-    QRegion ret;
-    foreach (const QRect &rect, where->rects())
-        for (int i = 0; i < mRulesInput.size(); ++i) {
-            // at the moment the parallel execution does not work yet
-            // TODO: make multithreading available!
-            // either by dividing the rules or the region to multiple threads
-            ret = ret.united(applyRule(i, rect));
-        }
-    *where = where->united(ret);
+    // Each rule is applied to the whole region before the next one, so you
+    // can rely on the order of the rules at all locations.
+    //
+    // A rule that is skipped would also have written its output again. When
+    // its output layers were changed, by the edit or by an earlier rule, the
+    // skipped rule might no longer have the last word there. Such rules are
+    // therefore applied as well.
+    const TileRegion region(*where);
+    TileRegion ret(region);
+    for (int i = 0; i < mRulesInput.size(); ++i) {
+        if (skipUnaffectedRules &&
+                !containsAny(*changedLayers, mRuleInputLayers.at(i)) &&
+                !containsAny(*changedLayers, mRuleOutputLayers.at(i)))
+            continue;
+
+        const QRect applied = applyRule(i, region);
+        if (applied.isEmpty())
+            continue;
+
+        ret.add(applied);
+
+        // The rules that follow may read from the layers this rule wrote to
+        if (changedLayers)
+            *changedLayers |= mRuleOutputLayers.at(i);
+    }
+    *where = ret.toRegion();
 }
 
 const QRegion AutoMapper::getSetLayersRegion()
@@ -503,136 +549,170 @@ const QRegion AutoMapper::getSetLayersRegion()
     return result;
 }
 
-static bool compareLayerTo(const TileLayer *setLayer,
-                           const QVector<TileLayer*> &listYes,
-                           const QVector<TileLayer*> &listNo,
-                           const QRegion &ruleRegion, const QPoint &offset);
+static bool matchesRule(const CompiledRule &rule,
+                        const SetLayers &setLayers,
+                        int x, int y);
 
-QRect AutoMapper::applyRule(const int ruleIndex, const QRect &where)
+static QVector<QPoint> findMatches(const CompiledRule &rule,
+                                   const SetLayers &setLayers,
+                                   const QVector<QRect> &runs);
+
+/**
+ * The minimum amount of positions a rule needs to be tried at before the
+ * matching is spread over multiple threads.
+ */
+static const int minimumParallelMatchArea = 64 * 64;
+
+QRect AutoMapper::applyRule(const int ruleIndex, const TileRegion &where)
 {
     QRect ret;
 
     if (mLayerList.isEmpty())
         return ret;
 
-    const QRegion ruleInput = mRulesInput.at(ruleIndex);
-    const QRegion ruleOutput = mRulesOutput.at(ruleIndex);
+    const TileRegion ruleInput = mRulesInput.at(ruleIndex);
+    const TileRegion ruleOutput = mRulesOutput.at(ruleIndex);
+    const CompiledRule &rule = mCompiledRules.at(ruleIndex);
     QRect rbr = ruleInput.boundingRect();
 
+    // The layers of the working map are not added or removed while applying
+    // the rule, so they only need to be looked up once
+    SetLayers setLayers(rule.size());
+    for (int i = 0; i < rule.size(); ++i) {
+        foreach (const CompiledInputLayer &layer, rule.at(i)) {
+            const int index = mMapWork->indexOfLayer(layer.name,
+                                                     Layer::TileLayerType);
+            const TileLayer *setLayer = 0;
+            if (index != -1)
+                setLayer = mMapWork->layerAt(index)->asTileLayer();
+            setLayers[i].append(setLayer);
+        }
+    }
+
     // Since the rule itself is translated, we need to adjust the borders of the
     // loops. Decrease the size at all sides by one: There must be at least one
-    // tile overlap to the rule.
-    const int minX = where.left() - rbr.left() - rbr.width() + 1;
-    const int minY = where.top() - rbr.top() - rbr.height() + 1;
+    // tile overlap to the rule. Positions that overlap with multiple parts of
+    // the region are only tried once.
+    TileRegion positions;
+    foreach (const QRect &rect, where.rects()) {
+        const int minX = rect.left() - rbr.left() - rbr.width() + 1;
+        const int minY = rect.top() - rbr.top() - rbr.height() + 1;
 
-    const int maxX = where.right() - rbr.left() + rbr.width() - 1;
-    const int maxY = where.bottom() - rbr.top() + rbr.height() - 1;
+        const int maxX = rect.right() - rbr.left() + rbr.width() - 1;
+        const int maxY = rect.bottom() - rbr.top() + rbr.height() - 1;
+
+        positions.add(QRect(QPoint(minX, minY), QPoint(maxX, maxY)));
+    }
+    const QVector<QRect> runs = positions.runs();
 
     // In this list of regions it is stored which parts or the map have already
     // been altered by exactly this rule. We store all the altered parts to
     // make sure there are no overlaps of the same rule applied to
     // (neighbouring) places
-    QList<QRegion> appliedRegions;
+    QVector<TileRegion> appliedRegions;
     if (mNoOverlappingRules)
-        for (int i = 0; i < mMapWork->layerCount(); i++)
-            appliedRegions.append(QRegion());
-
-    for (int y = minY; y <= maxY; ++y)
-    for (int x = minX; x <= maxX; ++x) {
-        bool anymatch = false;
-        foreach (const QString &index, mInputRules.indexes) {
-            const InputIndex &ii = mInputRules[index];
-
-            bool allLayerNamesMatch = true;
-            foreach (const QString &name, ii.names) {
-                const int i = mMapWork->indexOfLayer(name, Layer::TileLayerType);
-                if (i == -1) {
-                    allLayerNamesMatch = false;
-                } else {
-                    const TileLayer *setLayer = mMapWork->layerAt(i)->asTileLayer();
-                    allLayerNamesMatch &= compareLayerTo(setLayer,
-                                                         ii[name].listYes,
-                                                         ii[name].listNo,
-                                                         ruleInput,
-                                                         QPoint(x, y));
-                }
-            }
-            if (allLayerNamesMatch) {
-                anymatch = true;
-                break;
-            }
+        appliedRegions.resize(mMapWork->layerCount());
+
+    if (canMatchInParallel(setLayers) &&
+            positions.tileCount() >= minimumParallelMatchArea) {
+        // Find all matches up front, then apply them in the same order as
+        // they would have been applied when matching one by one
+        foreach (const QPoint &pos, findMatches(rule, setLayers, runs)) {
+            if (applyRuleAt(ruleOutput, pos, appliedRegions))
+                ret = ret.united(rbr.translated(pos));
         }
-
-        if (anymatch) {
-            int r = 0;
-            // choose by chance which group of rule_layers should be used:
-            if (mLayerList.size() > 1)
-                r = qrand() % mLayerList.size();
-
-            if (!mNoOverlappingRules) {
-                copyMapRegion(ruleOutput, QPoint(x, y), mLayerList.at(r));
-                ret = ret.united(rbr.translated(QPoint(x, y)));
-                continue;
+    } else {
+        foreach (const QRect &run, runs) {
+            const int y = run.y();
+            for (int x = run.left(); x <= run.right(); ++x) {
+                if (!matchesRule(rule, setLayers, x, y))
+                    continue;
+                if (applyRuleAt(ruleOutput, QPoint(x, y), appliedRegions))
+                    ret = ret.united(rbr.translated(QPoint(x, y)));
             }
+        }
+    }
 
-            bool missmatch = false;
-            RuleOutput *translationTable = mLayerList.at(r);
-            QList<Layer*> layers = translationTable->keys();
-
-            // check if there are no overlaps within this rule.
-            QVector<QRegion> ruleRegionInLayer;
-            for (int i = 0; i < layers.size(); ++i) {
-                Layer *layer = layers.at(i);
-
-                QRegion appliedPlace;
-                TileLayer *tileLayer = layer->asTileLayer();
-                if (tileLayer)
-                    appliedPlace = tileLayer->region();
-                else
-                    appliedPlace = tileRegionOfObjectGroup(layer->asObjectGroup());
+    return ret;
+}
 
-                ruleRegionInLayer.append(appliedPlace.intersected(ruleOutput));
-                if (appliedRegions.at(i).intersects(
-                            ruleRegionInLayer[i].translated(x, y))) {
-                    missmatch = true;
-                    break;
-                }
-            }
-            if (missmatch)
-                continue;
+/**
+ * Returns whether matching a rule against the given set layers can be done
+ * before applying any of the matches. This is not the case when the rule
+ * writes to any of the layers it reads from, since then applying a match
+ * can affect whether the rule matches at the next position.
+ */
+bool AutoMapper::canMatchInParallel(const SetLayers &setLayers) const
+{
+    if (QThread::idealThreadCount() < 2)
+        return false;
 
-            copyMapRegion(ruleOutput, QPoint(x, y), mLayerList.at(r));
-            ret = ret.united(rbr.translated(QPoint(x, y)));
-            for (int i = 0; i < translationTable->size(); ++i) {
-                appliedRegions[i] +=
-                        ruleRegionInLayer[i].translated(x, y);
-            }
+    foreach (const RuleOutput *translationTable, mLayerList) {
+        foreach (int index, translationTable->values()) {
+            const Layer *outputLayer = mMapWork->layerAt(index);
+            foreach (const QVector<const TileLayer*> &layers, setLayers)
+                foreach (const TileLayer *setLayer, layers)
+                    if (setLayer == outputLayer)
+                        return false;
         }
     }
 
-    return ret;
+    return true;
 }
 
 /**
- * Returns a list of all cells which can be found within all tile layers
- * within the given region.
+ * Applies a rule with the given output at \a pos, where the input of the
+ * rule was found to match. Returns whether the rule was applied, which is not
+ * the case when it would overlap with itself while this is not allowed.
  */
-static QVector<Cell> cellsInRegion(const QVector<TileLayer*> &list,
-                                   const QRegion &r)
-{
-    QVector<Cell> cells;
-    foreach (const TileLayer *tilelayer, list) {
-        foreach (const QRect &rect, r.rects()) {
-            for (int x = rect.left(); x <= rect.right(); ++x) {
-                for (int y = rect.top(); y <= rect.bottom(); ++y) {
-                    const Cell &cell = tilelayer->cellAt(x, y);
-                    if (!cells.contains(cell))
-                        cells.append(cell);
-                }
-            }
-        }
+bool AutoMapper::applyRuleAt(const TileRegion &ruleOutput, const QPoint &pos,
+                             QVector<TileRegion> &appliedRegions)
+{
+    int r = 0;
+    // choose by chance which group of rule_layers should be used:
+    if (mLayerList.size() > 1)
+        r = qrand() % mLayerList.size();
+
+    if (!mNoOverlappingRules) {
+        copyMapRegion(ruleOutput, pos, mLayerList.at(r));
+        return true;
+    }
+
+    RuleOutput *translationTable = mLayerList.at(r);
+    QList<Layer*> layers = translationTable->keys();
+
+    // check if there are no overlaps within this rule.
+    QVector<TileRegion> ruleRegionInLayer;
+    for (int i = 0; i < layers.size(); ++i) {
+        Layer *layer = layers.at(i);
+
+        TileRegion appliedPlace;
+        TileLayer *tileLayer = layer->asTileLayer();
+        if (tileLayer)
+            appliedPlace = TileRegion(tileLayer->region());
+        else
+            appliedPlace = TileRegion(tileRegionOfObjectGroup(layer->asObjectGroup()));
+
+        ruleRegionInLayer.append(appliedPlace.intersected(ruleOutput));
+        if (appliedRegions.at(i).intersects(
+                    ruleRegionInLayer[i].translated(pos.x(), pos.y())))
+            return false;
+    }
+
+    copyMapRegion(ruleOutput, pos, mLayerList.at(r));
+    for (int i = 0; i < translationTable->size(); ++i) {
+        appliedRegions[i] +=
+                ruleRegionInLayer[i].translated(pos.x(), pos.y());
     }
-    return cells;
+    return true;
+}
+
+static bool containsCell(const Cell *begin, const Cell *end, const Cell &cell)
+{
+    for (; begin != end; ++begin)
+        if (*begin == cell)
+            return true;
+    return false;
 }
 
 /**
@@ -642,18 +722,22 @@ static QVector<Cell> cellsInRegion(const QVector<TileLayer*> &list,
  * several other layers (ruleSet and ruleNotSet).
  * This comparision will determine if a rule of automapping matches,
  * so if this rule is applied at this region given
- * by a QRegion and Offset given by a QPoint.
+ * by a TileRegion and Offset given by a QPoint.
+ *
+ * To avoid looking at the rule layers for every position in the working
+ * map, the comparison is compiled into a condition for each position within
+ * the TileRegion ruleRegion, which is checked by matchesInputLayer().
+ * Returns false when the rule can never match.
  *
- * This compares the tile layer setLayer to several others given
- * in the QList listYes (ruleSet) and OList listNo (ruleNotSet).
- * The tile layer setLayer is examined at QRegion ruleRegion + offset
- * The tile layers within listYes and listNo are examined at QRegion ruleRegion.
+ * The tile layers within listYes (ruleSet) and listNo (ruleNotSet) are
+ * examined at TileRegion ruleRegion. The set layer will be examined at
+ * TileRegion ruleRegion + offset.
  *
  * Basically all matches between setLayer and a layer of listYes are considered
  * good, while all matches between setLayer and listNo are considered bad and
  * lead to canceling the comparison, returning false.
  *
- * The comparison is done for each position within the QRegion ruleRegion.
+ * The comparison is done for each position within the TileRegion ruleRegion.
  * If all positions of the region are considered "good" return true.
  *
  * Now there are several cases to distinguish:
@@ -691,103 +775,303 @@ static QVector<Cell> cellsInRegion(const QVector<TileLayer*> &list,
  *      (need of less layers.)
  *      It was not added to the case, when having only listNo layers to
  *      avoid total symmetrie between those lists.
- *
- * If all positions are considered good, return true.
- * return false otherwise.
- *
- * @return bool, if the tile layer matches the given list of layers.
  */
-static bool compareLayerTo(const TileLayer *setLayer,
-                           const QVector<TileLayer*> &listYes,
-                           const QVector<TileLayer*> &listNo,
-                           const QRegion &ruleRegion, const QPoint &offset)
+static bool compileInputLayer(const QVector<TileLayer*> &listYes,
+                              const QVector<TileLayer*> &listNo,
+                              const TileRegion &ruleRegion,
+                              CompiledInputLayer &compiled)
 {
     if (listYes.isEmpty() && listNo.isEmpty())
         return false;
 
-    QVector<Cell> cells;
-    if (listYes.isEmpty())
-        cells = cellsInRegion(listNo, ruleRegion);
-    if (listNo.isEmpty())
-        cells = cellsInRegion(listYes, ruleRegion);
+    const QVector<QRect> runs = ruleRegion.runs();
+
+    // The conditions that accept only specific cells are the most likely to
+    // fail, so they are checked first. Conditions that accept any cell are
+    // only there to check that the position is inside the set layer.
+    QVector<CellCondition> specific;
+    QVector<CellCondition> other;
+    QVector<CellCondition> any;
 
-    foreach (const QRect &rect, ruleRegion.rects()) {
-        for (int x = rect.left(); x <= rect.right(); ++x) {
-            for (int y = rect.top(); y <= rect.bottom(); ++y) {
-                // this is only used in the case where only one list has layers
-                // it is needed for the exception mentioned above
-                bool ruleDefinedListYes = false;
+    foreach (const QRect &run, runs) {
+        const int y = run.y();
 
-                bool matchListYes = false;
-                bool matchListNo  = false;
+        for (int x = run.left(); x <= run.right(); ++x) {
+            CellCondition condition;
+            condition.x = x;
+            condition.y = y;
+            condition.acceptBegin = compiled.cells.size();
 
-                if (!setLayer->contains(x + offset.x(), y + offset.y()))
+            foreach (const TileLayer *tileLayer, listYes) {
+                if (!tileLayer->contains(x, y))
                     return false;
 
-                const Cell &c1 = setLayer->cellAt(x + offset.x(),
-                                                  y + offset.y());
+                const Cell &cell = tileLayer->cellAt(x, y);
+                if (!cell.isEmpty() &&
+                        !containsCell(compiled.cells.constData() + condition.acceptBegin,
+                                      compiled.cells.constData() + compiled.cells.size(),
+                                      cell))
+                    compiled.cells.append(cell);
+            }
 
-                // ruleDefined will be set when there is a tile in at least
-                // one layer. if there is a tile in at least one layer, only
-                // the given tiles in the different listYes layers are valid.
-                // if there is given no tile at all in the listYes layers,
-                // consider all tiles valid.
+            condition.acceptEnd = compiled.cells.size();
 
-                foreach (const TileLayer *comparedTileLayer, listYes) {
+            foreach (const TileLayer *tileLayer, listNo) {
+                if (!tileLayer->contains(x, y))
+                    return false;
 
-                    if (!comparedTileLayer->contains(x, y))
-                        return false;
+                const Cell &cell = tileLayer->cellAt(x, y);
+                if (!cell.isEmpty() &&
+                        !containsCell(compiled.cells.constData() + condition.acceptEnd,
+                                      compiled.cells.constData() + compiled.cells.size(),
+                                      cell))
+                    compiled.cells.append(cell);
+            }
 
-                    const Cell &c2 = comparedTileLayer->cellAt(x, y);
-                    if (!c2.isEmpty())
-                        ruleDefinedListYes = true;
+            condition.rejectEnd = compiled.cells.size();
+            condition.useExcluded = listNo.isEmpty() &&
+                    condition.acceptBegin == condition.acceptEnd;
 
-                    if (!c2.isEmpty() && c1 == c2)
-                        matchListYes = true;
-                }
-                foreach (const TileLayer *comparedTileLayer, listNo) {
+            if (condition.acceptBegin != condition.acceptEnd)
+                specific.append(condition);
+            else if (condition.useExcluded ||
+                     condition.acceptEnd != condition.rejectEnd)
+                other.append(condition);
+            else
+                any.append(condition);
+        }
+    }
 
-                    if (!comparedTileLayer->contains(x, y))
-                        return false;
+    // For the exception when having only the listYes, collect all cells
+    // used by these layers within the rule region
+    if (listNo.isEmpty() && !other.isEmpty()) {
+        foreach (const TileLayer *tileLayer, listYes)
+            foreach (const QRect &run, runs)
+                for (int x = run.left(); x <= run.right(); ++x)
+                    compiled.excluded.insert(tileLayer->cellAt(x, run.y()));
+    }
+
+    compiled.conditions = specific + other + any;
+    return true;
+}
+
+/**
+ * Returns whether the set layer matches the compiled input layer, when the
+ * rule is placed at the given offset. See compileInputLayer() for how the
+ * conditions are derived from the rule map.
+ */
+static bool matchesInputLayer(const CompiledInputLayer &layer,
+                              const TileLayer *setLayer,
+                              int offsetX, int offsetY)
+{
+    if (!setLayer)
+        return false;
 
-                    const Cell &c2 = comparedTileLayer->cellAt(x, y);
+    const Cell *cells = layer.cells.constData();
+    const CellCondition *condition = layer.conditions.constData();
+    const CellCondition *end = condition + layer.conditions.size();
 
-                    if (!c2.isEmpty() && c1 == c2)
-                        matchListNo = true;
-                }
+    for (; condition != end; ++condition) {
+        const int x = condition->x + offsetX;
+        const int y = condition->y + offsetY;
 
-                // when there are only layers in the listNo
-                // check only if these layers are unmatched
-                // no need to check explicitly the exception in this case.
-                if (listYes.isEmpty()) {
-                    if (matchListNo)
-                        return false;
-                    else
-                        continue;
+        if (!setLayer->contains(x, y))
+            return false;
+
+        const Cell &cell = setLayer->cellAt(x, y);
+
+        if (condition->acceptBegin != condition->acceptEnd) {
+            if (!containsCell(cells + condition->acceptBegin,
+                              cells + condition->acceptEnd, cell))
+                return false;
+        } else if (condition->useExcluded && layer.excluded.contains(cell)) {
+            return false;
+        }
+
+        if (containsCell(cells + condition->acceptEnd,
+                         cells + condition->rejectEnd, cell))
+            return false;
+    }
+
+    return true;
+}
+
+/**
+ * Returns whether any of the input indexes of the rule matches, when the rule
+ * is placed at the given position. All input layers of an index need to
+ * match for the index to match.
+ */
+static bool matchesRule(const CompiledRule &rule,
+                        const SetLayers &setLayers,
+                        int x, int y)
+{
+    for (int i = 0; i < rule.size(); ++i) {
+        const QVector<CompiledInputLayer> &layers = rule.at(i);
+        const QVector<const TileLayer*> &indexSetLayers = setLayers.at(i);
+
+        bool allLayerNamesMatch = true;
+        for (int j = 0; j < layers.size() && allLayerNamesMatch; ++j) {
+            allLayerNamesMatch = matchesInputLayer(layers.at(j),
+                                                   indexSetLayers.at(j),
+                                                   x, y);
+        }
+
+        if (allLayerNamesMatch)
+            return true;
+    }
+
+    return false;
+}
+
+namespace {
+
+/**
+ * A range of consecutive runs in which a rule is matched by one thread.
+ */
+struct MatchBand
+{
+    int begin;
+    int end;
+    QVector<QPoint> matches;
+};
+
+/**
+ * Finds the positions in a band where a rule matches. Only reads from the
+ * set layers, so it can run on multiple bands at the same time.
+ */
+class MatchBandFunctor
+{
+public:
+    typedef void result_type;
+
+    MatchBandFunctor(const CompiledRule &rule,
+                     const SetLayers &setLayers,
+                     const QVector<QRect> &runs)
+        : mRule(rule)
+        , mSetLayers(setLayers)
+        , mRuns(runs)
+    {}
+
+    void operator() (MatchBand &band) const
+    {
+        for (int i = band.begin; i < band.end; ++i) {
+            const QRect &run = mRuns.at(i);
+            const int y = run.y();
+            for (int x = run.left(); x <= run.right(); ++x)
+                if (matchesRule(mRule, mSetLayers, x, y))
+                    band.matches.append(QPoint(x, y));
+        }
+    }
+
+private:
+    const CompiledRule &mRule;
+    const SetLayers &mSetLayers;
+    const QVector<QRect> &mRuns;
+};
+
+} // anonymous namespace
+
+/**
+ * Returns all positions within the given \a runs at which the rule matches,
+ * ordered by row and then by column. The runs are divided in bands that are
+ * matched by multiple threads.
+ */
+static QVector<QPoint> findMatches(const CompiledRule &rule,
+                                   const SetLayers &setLayers,
+                                   const QVector<QRect> &runs)
+{
+    // Use more bands than threads, since matching is not equally expensive
+    // in all parts of the map
+    const int bandCount = qMin(runs.size(),
+                               QThread::idealThreadCount() * 4);
+    const int runsPerBand = (runs.size() + bandCount - 1) / bandCount;
+
+    QVector<MatchBand> bands;
+    for (int begin = 0; begin < runs.size(); begin += runsPerBand) {
+        MatchBand band;
+        band.begin = begin;
+        band.end = qMin(begin + runsPerBand, runs.size());
+        bands.append(band);
+    }
+
+    QtConcurrent::blockingMap(bands, MatchBandFunctor(rule, setLayers, runs));
+
+    QVector<QPoint> matches;
+    foreach (const MatchBand &band, bands)
+        matches += band.matches;
+    return matches;
+}
+
+void AutoMapper::compileRules()
+{
+    mCompiledRules.clear();
+    mCompiledRules.reserve(mRulesInput.size());
+    mRuleInputLayers.clear();
+    mRuleInputLayers.reserve(mRulesInput.size());
+    mRuleOutputLayers.clear();
+    mRuleOutputLayers.reserve(mRulesInput.size());
+
+    for (int i = 0; i < mRulesInput.size(); ++i) {
+        const TileRegion &ruleInput = mRulesInput.at(i);
+        CompiledRule rule;
+
+        foreach (const QString &index, mInputRules.indexes) {
+            const InputIndex &ii = mInputRules[index];
+
+            QVector<CompiledInputLayer> layers;
+            bool canMatch = true;
+
+            foreach (const QString &name, ii.names) {
+                CompiledInputLayer layer;
+                layer.name = name;
+                if (!compileInputLayer(ii[name].listYes, ii[name].listNo,
+                                       ruleInput, layer)) {
+                    canMatch = false;
+                    break;
                 }
-                // when there are only layers in the listYes
-                // check if these layers are matched, or if the exception works
-                if (listNo.isEmpty()) {
-                    if (matchListYes)
-                        continue;
-                    if (!ruleDefinedListYes && !cells.contains(c1))
-                        continue;
-                    return false;
+                layers.append(layer);
+            }
+
+            if (canMatch)
+                rule.append(layers);
+        }
+
+        // A rule only depends on the layers for which it has conditions that
+        // do not accept any cell
+        QSet<QString> inputLayers;
+        foreach (const QVector<CompiledInputLayer> &layers, rule) {
+            foreach (const CompiledInputLayer &layer, layers) {
+                foreach (const CellCondition &condition, layer.conditions) {
+                    if (condition.useExcluded ||
+                            condition.acceptBegin != condition.rejectEnd) {
+                        inputLayers.insert(layer.name);
+                        break;
+                    }
                 }
+            }
+        }
 
-                // there are layers in both lists:
-                // no need to consider ruleDefinedListXXX
-                if ((matchListYes || !ruleDefinedListYes) && !matchListNo)
-                    continue;
-                else
-                    return false;
+        // Only empty cells are skipped when copying the output, so a rule
+        // writes to the layers that have tiles within its output region
+        QSet<QString> outputLayers;
+        foreach (const RuleOutput *translationTable, mLayerList) {
+            RuleOutput::const_iterator it = translationTable->constBegin();
+            for (; it != translationTable->constEnd(); ++it) {
+                const TileLayer *tileLayer = it.key()->asTileLayer();
+                if (tileLayer && TileRegion(tileLayer->region())
+                        .intersects(mRulesOutput.at(i))) {
+                    outputLayers.insert(mMapWork->layerAt(it.value())->name());
+                }
             }
         }
+
+        mCompiledRules.append(rule);
+        mRuleInputLayers.append(inputLayers);
+        mRuleOutputLayers.append(outputLayers);
     }
-    return true;
 }
 
-void AutoMapper::copyMapRegion(const QRegion &region, QPoint offset,
+void AutoMapper::copyMapRegion(const TileRegion &region, QPoint offset,
                                const RuleOutput *layerTranslation)
 {
     for (int i = 0; i < layerTranslation->keys().size(); ++i) {
@@ -916,6 +1200,9 @@ void AutoMapper::cleanUpRulesMap()
     cleanUpRuleMapLayers();
     mRulesInput.clear();
     mRulesOutput.clear();
+    mCompiledRules.clear();
+    mRuleInputLayers.clear();
+    mRuleOutputLayers.clear();
 }
 
 void AutoMapper::cleanUpRuleMapLayers()
@@ -21,6 +21,9 @@
 #ifndef AUTOMAPPER_H
 #define AUTOMAPPER_H
 
+#include "tilelayer.h"
+#include "tileregion.h"
+
 #include <QMap>
 #include <QList>
 
@@ -36,7 +39,6 @@ class Layer;
 class Map;
 class MapObject;
 class ObjectGroup;
-class TileLayer;
 class Tileset;
 
 namespace Internal {
@@ -69,6 +71,50 @@ public:
     QString index;
 };
 
+/**
+ * The condition the input layers of a rule put on a single cell of the
+ * working map. The accepted cells are stored at [acceptBegin, acceptEnd) and
+ * the rejected cells at [acceptEnd, rejectEnd) in CompiledInputLayer::cells.
+ *
+ * When no cells are accepted, any cell is accepted unless \a useExcluded is
+ * set, in which case any cell that is not in CompiledInputLayer::excluded
+ * is accepted.
+ */
+struct CellCondition
+{
+    int x;
+    int y;
+    int acceptBegin;
+    int acceptEnd;
+    int rejectEnd;
+    bool useExcluded;
+};
+
+/**
+ * The conditions the input layers of a rule put on one layer of the working
+ * map, compiled from the listYes and listNo layers of an InputIndexName.
+ */
+class CompiledInputLayer
+{
+public:
+    QString name;
+    QVector<CellCondition> conditions;
+    QVector<Cell> cells;
+    QSet<Cell> excluded;
+};
+
+/**
+ * The compiled input of a rule, for each of the input indexes. A rule matches
+ * when all layers of any of its indexes match.
+ */
+typedef QVector<QVector<CompiledInputLayer> > CompiledRule;
+
+/**
+ * The layers of the working map matched against a CompiledRule, for each
+ * input layer of each input index. Layers that do not exist are 0.
+ */
+typedef QVector<QVector<const TileLayer*> > SetLayers;
+
 
 /**
  * This class does all the work for the automapping feature.
@@ -119,8 +165,13 @@ public:
 
     /**
      * Here is done all the automapping.
+     *
+     * When \a changedLayers is given, only the rules that read from any of
+     * these layers are applied, since the other rules would not give a
+     * different result than the last time. The layers written to by the
+     * applied rules are added to \a changedLayers.
      */
-    void autoMap(QRegion *where);
+    void autoMap(QRegion *where, QSet<QString> *changedLayers = 0);
 
     /**
      * This cleans all datastructures, which are setup via prepareAutoMap,
@@ -224,7 +275,7 @@ private:
      * The parameter \a LayerTranslation is a map of which layers of the rulesmap
      * should get copied into which layers of the working map.
      */
-    void copyMapRegion(const QRegion &region, QPoint Offset,
+    void copyMapRegion(const TileRegion &region, QPoint Offset,
                        const RuleOutput *LayerTranslation);
 
     /**
@@ -233,9 +284,24 @@ private:
      * if there is a match all Layers are copied to mMapWork.
      * @param ruleIndex: the region which should be compared to all positions
      *              of mMapWork will be looked up in mRulesInput and mRulesOutput
+     * @param where: the rule is tried at all positions where it overlaps with
+     *              this region
      * @return where: an rectangle where the rule actually got applied
      */
-    QRect applyRule(const int ruleIndex, const QRect &where);
+    QRect applyRule(const int ruleIndex, const TileRegion &where);
+
+    bool canMatchInParallel(const SetLayers &setLayers) const;
+
+    bool applyRuleAt(const TileRegion &ruleOutput, const QPoint &pos,
+                     QVector<TileRegion> &appliedRegions);
+
+    /**
+     * Compiles the input regions of the rules into the conditions they put
+     * on each cell, so that matching a rule does not need to look at the
+     * rule map. Needs to be done after setupTilesets(), since that may
+     * replace the tiles used by the rule map.
+     */
+    void compileRules();
 
     /**
      * Cleans up the data structes filled by setupRuleMapLayers(),
@@ -303,7 +369,7 @@ private:
     /**
      * List of Regions in mMapRules to know where the input rules are
      */
-    QList<QRegion> mRulesInput;
+    QList<TileRegion> mRulesInput;
     
     /**
      * List of regions in mMapRules to know where the output of a 
@@ -312,7 +378,23 @@ private:
      * which has the input at mRulesInput[i], meaning that mRulesInput
      * and mRulesOutput must match with the indexes.
      */
-    QList<QRegion> mRulesOutput;
+    QList<TileRegion> mRulesOutput;
+
+    /**
+     * The compiled input of each rule, see compileRules().
+     */
+    QVector<CompiledRule> mCompiledRules;
+
+    /**
+     * The names of the layers in the working map that each rule reads from.
+     */
+    QVector<QSet<QString> > mRuleInputLayers;
+
+    /**
+     * The names of the tile layers in the working map that each rule writes
+     * to.
+     */
+    QVector<QSet<QString> > mRuleOutputLayers;
 
     /**
      * The inner set with layers to indexes is needed for translating
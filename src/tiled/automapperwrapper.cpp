@@ -30,7 +30,9 @@ using namespace Tiled::Internal;
 
 AutoMapperWrapper::AutoMapperWrapper(MapDocument *mapDocument,
                                      QVector<AutoMapper*> autoMapper,
-                                     QRegion *where)
+                                     QRegion *where,
+                                     QSet<QString> *changedLayers)
+    : CommandMemoryUsage(mapDocument->undoStorage())
 {
     mMapDocument = mapDocument;
     Map *map = mMapDocument->map();
@@ -53,7 +55,7 @@ AutoMapperWrapper::AutoMapperWrapper(MapDocument *mapDocument,
     }
 
     foreach (AutoMapper *a, autoMapper) {
-        a->autoMap(where);
+        a->autoMap(where, changedLayers);
     }
 
     foreach (const QString &layerName, touchedLayers) {
@@ -90,6 +92,10 @@ AutoMapperWrapper::AutoMapperWrapper(MapDocument *mapDocument,
 
 AutoMapperWrapper::~AutoMapperWrapper()
 {
+    foreach (qint64 offset, mSwapOffsets)
+        if (offset != -1)
+            undoStorage()->release(offset);
+
     QVector<TileLayer*>::iterator i;
     for (i = mLayersAfter.begin(); i != mLayersAfter.end(); ++i)
         delete *i;
@@ -99,6 +105,9 @@ AutoMapperWrapper::~AutoMapperWrapper()
 
 void AutoMapperWrapper::undo()
 {
+    if (!swapIn())
+        return;
+
     Map *map = mMapDocument->map();
     QVector<TileLayer*>::iterator i;
     for (i = mLayersBefore.begin(); i != mLayersBefore.end(); ++i) {
@@ -110,6 +119,9 @@ void AutoMapperWrapper::undo()
 
 void AutoMapperWrapper::redo()
 {
+    if (!swapIn())
+        return;
+
     Map *map = mMapDocument->map();
     QVector<TileLayer*>::iterator i;
     for (i = mLayersAfter.begin(); i != mLayersAfter.end(); ++i) {
@@ -117,7 +129,64 @@ void AutoMapperWrapper::redo()
         if (layerindex != -1)
             patchLayer(layerindex, *i);
     }
+}
+
+qint64 AutoMapperWrapper::memoryUsage() const
+{
+    qint64 usage = sizeof(AutoMapperWrapper);
+    foreach (const TileLayer *layer, mLayersBefore)
+        usage += UndoStorage::layerMemoryUsage(layer);
+    foreach (const TileLayer *layer, mLayersAfter)
+        usage += UndoStorage::layerMemoryUsage(layer);
+    return usage;
+}
+
+void AutoMapperWrapper::swapOut()
+{
+    if (!mSwapOffsets.isEmpty())
+        return;
+
+    // Layers keep their position and name, only their cells are stored
+    const QVector<TileLayer*> layers = mLayersBefore + mLayersAfter;
+    foreach (TileLayer *layer, layers)
+        mSwapOffsets.append(undoStorage()->storeLayer(layer));
+}
+
+/**
+ * Loads the cells of the layers before and after when they were swapped out.
+ * Returns false when they could not all be loaded, in which case the
+ * command no longer changes anything when undone or redone.
+ */
+bool AutoMapperWrapper::swapIn()
+{
+    markUsed();
+
+    if (mSwapOffsets.isEmpty())
+        return true;
+
+    const QVector<TileLayer*> layers = mLayersBefore + mLayersAfter;
+    bool loaded = true;
+
+    for (int i = 0; i < mSwapOffsets.size(); ++i) {
+        const qint64 offset = mSwapOffsets.at(i);
+        if (offset == -1)
+            continue;
+
+        if (loaded)
+            loaded = undoStorage()->loadLayer(layers.at(i), offset);
+        undoStorage()->release(offset);
+    }
+
+    mSwapOffsets.clear();
+
+    if (!loaded) {
+        qDeleteAll(mLayersBefore);
+        qDeleteAll(mLayersAfter);
+        mLayersBefore.clear();
+        mLayersAfter.clear();
+    }
 
+    return loaded;
 }
 
 void AutoMapperWrapper::patchLayer(int layerIndex, TileLayer *layer)
@@ -130,5 +199,5 @@ void AutoMapperWrapper::patchLayer(int layerIndex, TileLayer *layer)
 
     t->setCells(b.left() - t->x(), b.top() - t->y(), layer,
                 b.translated(-t->position()));
-    mMapDocument->emitRegionChanged(b);
+    mMapDocument->emitRegionChanged(TileRegion(b));
 }
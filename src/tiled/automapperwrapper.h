@@ -22,6 +22,7 @@
 #define AUTOMAPPERWRAPPER_H
 
 #include "automapper.h"
+#include "undostorage.h"
 
 #include <QUndoCommand>
 #include <QVector>
@@ -39,22 +40,38 @@ class MapDocument;
  * This class will take a snapshot of the layers before and after the
  * automapping is done. In between instances of AutoMapper are doing the work.
  */
-class AutoMapperWrapper : public QUndoCommand
+class AutoMapperWrapper : public QUndoCommand, public CommandMemoryUsage
 {
 public:
+    /**
+     * Applies the given auto mappers to the region \a where. When
+     * \a changedLayers is given, only the rules reading from these layers
+     * are applied (see AutoMapper::autoMap).
+     */
     AutoMapperWrapper(MapDocument *mapDocument, QVector<AutoMapper*> autoMapper,
-                      QRegion *where);
+                      QRegion *where, QSet<QString> *changedLayers = 0);
     ~AutoMapperWrapper();
 
     void undo();
     void redo();
 
+    qint64 memoryUsage() const;
+    void swapOut();
+    bool isSwappedOut() const { return !mSwapOffsets.isEmpty(); }
+
 private:
+    bool swapIn();
     void patchLayer(int layerIndex, TileLayer *layer);
 
     MapDocument *mMapDocument;
     QVector<TileLayer*> mLayersAfter;
     QVector<TileLayer*> mLayersBefore;
+
+    /**
+     * The offsets at which the cells of the layers before and after are
+     * stored, in that order. Empty when the cells are in memory.
+     */
+    QVector<qint64> mSwapOffsets;
 };
 
 } // namespace Internal
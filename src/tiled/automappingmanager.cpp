@@ -18,9 +18,11 @@
  * this program. If not, see <http://www.gnu.org/licenses/>.
  */
 
+
 #include "automappingmanager.h"
 
 #include "automapperwrapper.h"
+#include "filesystemwatcher.h"
 #include "map.h"
 #include "mapdocument.h"
 #include "tilelayer.h"
@@ -28,25 +30,176 @@
 #include "tmxmapreader.h"
 #include "preferences.h"
 
+#include <QDir>
 #include <QFileInfo>
-#include <QFileSystemWatcher>
 #include <QTextStream>
+#include <QXmlStreamReader>
+#include <QtConcurrentRun>
 
 using namespace Tiled;
 using namespace Tiled::Internal;
 
+/**
+ * Decodes the external images referred to by the rule map \a data, so that
+ * they don't need to be loaded when the map is parsed. The paths are
+ * resolved the same way as the TmxMapReader does it.
+ *
+ * External tilesets are recorded as well, so that changes to them cause the
+ * rules to be reloaded. The images they refer to are decoded too.
+ */
+static void readRuleMapImages(const QByteArray &data,
+                              const QString &ruleMapPath,
+                              RuleFiles &files)
+{
+    const QString mapPath = QFileInfo(ruleMapPath).absolutePath();
+    QXmlStreamReader xml(data);
+
+    while (!xml.atEnd()) {
+        if (xml.readNext() != QXmlStreamReader::StartElement)
+            continue;
+        if (xml.name() == QLatin1String("tileset")) {
+            QString source = xml.attributes().value(QLatin1String("source"))
+                    .toString();
+            if (source.isEmpty())
+                continue;
+
+            if (QDir::isRelativePath(source))
+                source = mapPath + QLatin1Char('/') + source;
+            source = QDir::cleanPath(source);
+
+            if (files.modified.contains(source))
+                continue;
+
+            files.modified.insert(source, QFileInfo(source).lastModified());
+
+            QFile tilesetFile(source);
+            if (tilesetFile.open(QIODevice::ReadOnly))
+                readRuleMapImages(tilesetFile.readAll(), source, files);
+        } else if (xml.name() == QLatin1String("image")) {
+            QString source = xml.attributes().value(QLatin1String("source"))
+                    .toString();
+            if (source.isEmpty())
+                continue;
+
+            if (QDir::isRelativePath(source))
+                source = mapPath + QLatin1Char('/') + source;
+            source = QDir::cleanPath(source);
+
+            if (!files.images.contains(source)) {
+                files.images.insert(source, QImage(source));
+                files.modified.insert(source,
+                                      QFileInfo(source).lastModified());
+            }
+        }
+    }
+}
+
+/**
+ * Reads the rules file \a filePath. For each path which is a rule (the file
+ * extension is tmx) the rule map is read. If a file extension is txt, this
+ * file will be opened and searched for rules again.
+ *
+ * @return if the reading was successful
+ */
+static bool readRulesFile(const QString &filePath, RuleFiles &files)
+{
+    bool ret = true;
+    const QString absPath = QFileInfo(filePath).path();
+    QFile rulesFile(filePath);
+
+    if (!rulesFile.exists()) {
+        files.error += AutomappingManager::tr("No rules file found at:\n%1")
+                .arg(filePath) + QLatin1Char('\n');
+        return false;
+    }
+    if (!rulesFile.open(QIODevice::ReadOnly)) {
+        files.error += AutomappingManager::tr("Error opening rules file:\n%1")
+                .arg(filePath) + QLatin1Char('\n');
+        return false;
+    }
+
+    files.modified.insert(filePath, QFileInfo(filePath).lastModified());
+
+    QTextStream in(&rulesFile);
+    QString line = in.readLine();
+
+    for (; !line.isNull(); line = in.readLine()) {
+        QString rulePath = line.trimmed();
+        if (rulePath.isEmpty()
+                || rulePath.startsWith(QLatin1Char('#'))
+                || rulePath.startsWith(QLatin1String("//")))
+            continue;
+
+        if (QFileInfo(rulePath).isRelative())
+            rulePath = absPath + QLatin1Char('/') + rulePath;
+
+        if (!QFileInfo(rulePath).exists()) {
+            files.error += AutomappingManager::tr("File not found:\n%1")
+                    .arg(rulePath) + QLatin1Char('\n');
+            ret = false;
+            continue;
+        }
+        if (rulePath.endsWith(QLatin1String(".tmx"), Qt::CaseInsensitive)) {
+            QFile ruleMapFile(rulePath);
+            if (!ruleMapFile.open(QIODevice::ReadOnly)) {
+                files.error += AutomappingManager::tr(
+                            "Opening rules map failed:\n%1").arg(
+                            ruleMapFile.errorString()) + QLatin1Char('\n');
+                ret = false;
+                continue;
+            }
+
+            const QByteArray data = ruleMapFile.readAll();
+            files.modified.insert(rulePath,
+                                  QFileInfo(rulePath).lastModified());
+            files.ruleMapPaths.append(rulePath);
+            files.ruleMaps.append(data);
+            readRuleMapImages(data, rulePath, files);
+        }
+        if (rulePath.endsWith(QLatin1String(".txt"), Qt::CaseInsensitive)) {
+            if (!readRulesFile(rulePath, files))
+                ret = false;
+        }
+    }
+    return ret;
+}
+
+/**
+ * Reads the rules file \a rulesFileName along with everything it refers to.
+ * Does not touch any GUI resources, so it can run on a worker thread.
+ */
+static RuleFiles readRuleFiles(const QString &rulesFileName)
+{
+    RuleFiles files;
+    files.rulesFileName = rulesFileName;
+    files.success = readRulesFile(rulesFileName, files);
+    return files;
+}
+
 AutomappingManager *AutomappingManager::mInstance = 0;
 
 AutomappingManager::AutomappingManager(QObject *parent)
     : QObject(parent)
     , mMapDocument(0)
-    , mLoaded(false)
+    , mWatcher(new FileSystemWatcher(this))
 {
+    connect(mWatcher, SIGNAL(fileChanged(QString)),
+            this, SLOT(fileChanged(QString)));
+
+    mChangedFilesTimer.setInterval(500);
+    mChangedFilesTimer.setSingleShot(true);
+
+    connect(&mChangedFilesTimer, SIGNAL(timeout()),
+            this, SLOT(fileChangedTimeout()));
 }
 
 AutomappingManager::~AutomappingManager()
 {
-    cleanUp();
+    qDeleteAll(mPreloads);
+    mPreloads.clear();
+
+    foreach (MapDocument *mapDocument, mRuleSets.keys())
+        removeRuleSet(mapDocument);
 }
 
 AutomappingManager *AutomappingManager::instance()
@@ -91,38 +244,71 @@ void AutomappingManager::autoMapInternal(QRegion where, Layer *touchedLayer)
         return;
     }
 
-    if (!mLoaded) {
-        const QString mapPath = QFileInfo(mMapDocument->fileName()).path();
-        const QString rulesFileName = mapPath + QLatin1String("/rules.txt");
-        if (loadFile(rulesFileName)) {
-            mLoaded = true;
-        } else {
+    if (mPreloads.contains(mMapDocument))
+        finishPreload(mMapDocument);
+
+    RuleSet *ruleSet = mRuleSets.value(mMapDocument);
+    if (!ruleSet || !isUpToDate(ruleSet, mMapDocument)) {
+        removeRuleSet(mMapDocument);
+
+        const RuleFiles files = readRuleFiles(rulesFileName(mMapDocument));
+        ruleSet = loadRuleSet(mMapDocument, files);
+        if (!ruleSet->complete) {
+            mError += ruleSet->error;
+            qDeleteAll(ruleSet->autoMappers);
+            delete ruleSet;
             emit errorsOccurred();
             return;
         }
+        addRuleSet(mMapDocument, ruleSet);
     }
 
+    mError += ruleSet->error;
+    mWarning += ruleSet->warning;
+    ruleSet->error.clear();
+    ruleSet->warning.clear();
+
+    const QVector<AutoMapper*> &autoMappers = ruleSet->autoMappers;
+
     // use a pointer to the region, so each automapper can manipulate it and the
     // following automappers do see the impact
     QRegion *passedRegion = new QRegion(where);
 
+    // When only one layer was touched, only the automappers reading from or
+    // writing to it are used, as well as the automappers reading from or
+    // writing to the layers written by those automappers.
     QVector<AutoMapper*> passedAutoMappers;
+    QSet<QString> changedLayers;
     if (touchedLayer) {
-        foreach (AutoMapper *a, mAutoMappers) {
-            if (a->ruleLayerNameUsed(touchedLayer->name()))
-                passedAutoMappers.append(a);
+        QSet<QString> affectedLayers;
+        affectedLayers.insert(touchedLayer->name());
+
+        foreach (AutoMapper *a, autoMappers) {
+            foreach (const QString &layerName, affectedLayers) {
+                if (a->ruleLayerNameUsed(layerName) ||
+                        a->getTouchedTileLayers().contains(layerName)) {
+                    passedAutoMappers.append(a);
+                    affectedLayers |= a->getTouchedTileLayers();
+                    break;
+                }
+            }
         }
+
+        changedLayers.insert(touchedLayer->name());
     } else {
-        passedAutoMappers = mAutoMappers;
+        passedAutoMappers = autoMappers;
     }
     if (!passedAutoMappers.isEmpty()) {
         QUndoStack *undoStack = mMapDocument->undoStack();
         undoStack->beginMacro(tr("Apply AutoMap rules"));
-        AutoMapperWrapper *aw = new AutoMapperWrapper(mMapDocument, passedAutoMappers, passedRegion);
+        AutoMapperWrapper *aw =
+                new AutoMapperWrapper(mMapDocument, passedAutoMappers,
+                                      passedRegion,
+                                      touchedLayer ? &changedLayers : 0);
         undoStack->push(aw);
         undoStack->endMacro();
     }
-    foreach (AutoMapper *automapper, mAutoMappers) {
+    foreach (AutoMapper *automapper, autoMappers) {
         mWarning += automapper->warningString();
         mError += automapper->errorString();
     }
@@ -137,92 +323,204 @@ void AutomappingManager::autoMapInternal(QRegion where, Layer *touchedLayer)
         emit errorsOccurred();
 }
 
-bool AutomappingManager::loadFile(const QString &filePath)
+QString AutomappingManager::rulesFileName(MapDocument *mapDocument)
 {
-    bool ret = true;
-    const QString absPath = QFileInfo(filePath).path();
-    QFile rulesFile(filePath);
+    const QString mapPath = QFileInfo(mapDocument->fileName()).path();
+    return mapPath + QLatin1String("/rules.txt");
+}
 
-    if (!rulesFile.exists()) {
-        mError += tr("No rules file found at:\n%1").arg(filePath)
-                  + QLatin1Char('\n');
-        return false;
-    }
-    if (!rulesFile.open(QIODevice::ReadOnly)) {
-        mError += tr("Error opening rules file:\n%1").arg(filePath)
-                  + QLatin1Char('\n');
-        return false;
+void AutomappingManager::preloadRules(MapDocument *mapDocument)
+{
+    if (mapDocument->fileName().isEmpty() || mPreloads.contains(mapDocument))
+        return;
+
+    const RuleSet *ruleSet = mRuleSets.value(mapDocument);
+    if (ruleSet && isUpToDate(ruleSet, mapDocument))
+        return;
+
+    const QString fileName = rulesFileName(mapDocument);
+    if (!QFileInfo(fileName).exists())
+        return;
+
+    QFutureWatcher<RuleFiles> *watcher = new QFutureWatcher<RuleFiles>(this);
+    connect(watcher, SIGNAL(finished()), this, SLOT(preloadFinished()));
+    connect(mapDocument, SIGNAL(destroyed(QObject*)),
+            this, SLOT(mapDocumentDestroyed(QObject*)),
+            Qt::UniqueConnection);
+
+    mPreloads.insert(mapDocument, watcher);
+    watcher->setFuture(QtConcurrent::run(readRuleFiles, fileName));
+}
+
+void AutomappingManager::preloadFinished()
+{
+    QFutureWatcher<RuleFiles> *watcher =
+            static_cast<QFutureWatcher<RuleFiles>*>(sender());
+
+    if (MapDocument *mapDocument = mPreloads.key(watcher))
+        finishPreload(mapDocument);
+}
+
+void AutomappingManager::finishPreload(MapDocument *mapDocument)
+{
+    QFutureWatcher<RuleFiles> *watcher = mPreloads.take(mapDocument);
+    const RuleFiles files = watcher->result();
+    watcher->deleteLater();
+
+    // The map may have been saved elsewhere in the meantime
+    if (files.rulesFileName != rulesFileName(mapDocument))
+        return;
+
+    RuleSet *ruleSet = loadRuleSet(mapDocument, files);
+
+    // Incomplete rules are not kept, so that their errors get reported when
+    // they are loaded again by autoMapInternal
+    if (!ruleSet->complete) {
+        qDeleteAll(ruleSet->autoMappers);
+        delete ruleSet;
+        return;
     }
 
-    QTextStream in(&rulesFile);
-    QString line = in.readLine();
+    removeRuleSet(mapDocument);
+    addRuleSet(mapDocument, ruleSet);
+}
 
-    for (; !line.isNull(); line = in.readLine()) {
-        QString rulePath = line.trimmed();
-        if (rulePath.isEmpty()
-                || rulePath.startsWith(QLatin1Char('#'))
-                || rulePath.startsWith(QLatin1String("//")))
-            continue;
+AutomappingManager::RuleSet *AutomappingManager::loadRuleSet(
+        MapDocument *mapDocument, const RuleFiles &files)
+{
+    RuleSet *ruleSet = new RuleSet;
+    ruleSet->rulesFileName = files.rulesFileName;
+    ruleSet->modified = files.modified;
+    ruleSet->error = files.error;
+    ruleSet->complete = files.success;
 
-        if (QFileInfo(rulePath).isRelative())
-            rulePath = absPath + QLatin1Char('/') + rulePath;
+    TilesetManager *tilesetManager = TilesetManager::instance();
 
-        if (!QFileInfo(rulePath).exists()) {
-            mError += tr("File not found:\n%1").arg(rulePath) + QLatin1Char('\n');
-            ret = false;
+    for (int i = 0; i < files.ruleMapPaths.size(); ++i) {
+        const QString &rulePath = files.ruleMapPaths.at(i);
+        TmxMapReader mapReader;
+
+        Map *rules = mapReader.fromByteArray(files.ruleMaps.at(i), rulePath,
+                                             files.images);
+
+        if (!rules) {
+            ruleSet->error += tr("Opening rules map failed:\n%1").arg(
+                    mapReader.errorString()) + QLatin1Char('\n');
+            ruleSet->complete = false;
             continue;
         }
-        if (rulePath.endsWith(QLatin1String(".tmx"), Qt::CaseInsensitive)) {
-            TmxMapReader mapReader;
 
-            Map *rules = mapReader.read(rulePath);
+        tilesetManager->addReferences(rules->tilesets());
 
-            if (!rules) {
-                mError += tr("Opening rules map failed:\n%1").arg(
-                        mapReader.errorString()) + QLatin1Char('\n');
-                ret = false;
-                continue;
-            }
+        AutoMapper *autoMapper;
+        autoMapper = new AutoMapper(mapDocument, rules, rulePath);
 
-            TilesetManager *tilesetManager = TilesetManager::instance();
-            tilesetManager->addReferences(rules->tilesets());
+        ruleSet->warning += autoMapper->warningString();
+        const QString error = autoMapper->errorString();
+        if (error.isEmpty()) {
+            ruleSet->autoMappers.append(autoMapper);
+        } else {
+            ruleSet->error += error;
+            delete autoMapper;
+        }
+    }
+
+    return ruleSet;
+}
+
+bool AutomappingManager::isUpToDate(const RuleSet *ruleSet,
+                                    MapDocument *mapDocument) const
+{
+    if (ruleSet->rulesFileName != rulesFileName(mapDocument))
+        return false;
+
+    // Checked in addition to the file system watcher, since it stops watching
+    // files that are replaced rather than modified
+    QMap<QString, QDateTime>::const_iterator it = ruleSet->modified.begin();
+    QMap<QString, QDateTime>::const_iterator it_end = ruleSet->modified.end();
+    for (; it != it_end; ++it)
+        if (QFileInfo(it.key()).lastModified() != it.value())
+            return false;
+
+    return true;
+}
+
+void AutomappingManager::addRuleSet(MapDocument *mapDocument,
+                                    RuleSet *ruleSet)
+{
+    Q_ASSERT(!mRuleSets.contains(mapDocument));
+
+    mRuleSets.insert(mapDocument, ruleSet);
+    foreach (const QString &fileName, ruleSet->modified.keys())
+        mWatcher->addPath(fileName);
+
+    connect(mapDocument, SIGNAL(destroyed(QObject*)),
+            this, SLOT(mapDocumentDestroyed(QObject*)),
+            Qt::UniqueConnection);
+}
+
+void AutomappingManager::removeRuleSet(MapDocument *mapDocument)
+{
+    RuleSet *ruleSet = mRuleSets.take(mapDocument);
+    if (!ruleSet)
+        return;
+
+    foreach (const QString &fileName, ruleSet->modified.keys())
+        mWatcher->removePath(fileName);
+
+    qDeleteAll(ruleSet->autoMappers);
+    delete ruleSet;
+}
 
-            AutoMapper *autoMapper;
-            autoMapper = new AutoMapper(mMapDocument, rules, rulePath);
+void AutomappingManager::mapDocumentDestroyed(QObject *object)
+{
+    // Only used as a key, the map document is already gone
+    MapDocument *mapDocument = static_cast<MapDocument*>(object);
+
+    // A preload that is still running is left to finish on its own
+    delete mPreloads.take(mapDocument);
+
+    removeRuleSet(mapDocument);
+}
 
-            mWarning += autoMapper->warningString();
-            const QString error = autoMapper->errorString(); 
-            if (error.isEmpty()) {
-                mAutoMappers.append(autoMapper);
-            } else {
-                mError += error;
-                delete autoMapper;
+void AutomappingManager::fileChanged(const QString &path)
+{
+    mChangedFiles.insert(path);
+    mChangedFilesTimer.start();
+}
+
+void AutomappingManager::fileChangedTimeout()
+{
+    foreach (MapDocument *mapDocument, mRuleSets.keys()) {
+        const RuleSet *ruleSet = mRuleSets.value(mapDocument);
+
+        foreach (const QString &fileName, mChangedFiles) {
+            if (ruleSet->modified.contains(fileName)) {
+                removeRuleSet(mapDocument);
+                break;
             }
         }
-        if (rulePath.endsWith(QLatin1String(".txt"), Qt::CaseInsensitive)) {
-            if (!loadFile(rulePath))
-                ret = false;
-        }
     }
-    return ret;
+
+    mChangedFiles.clear();
+
+    if (mMapDocument)
+        preloadRules(mMapDocument);
 }
 
 void AutomappingManager::setMapDocument(MapDocument *mapDocument)
 {
-    cleanUp();
+    // Not disconnecting everything, since rules for the previous map document
+    // remain loaded until it is destroyed
     if (mMapDocument)
-        mMapDocument->disconnect(this);
+        disconnect(mMapDocument, SIGNAL(regionEdited(QRegion,Layer*)),
+                   this, SLOT(autoMap(QRegion,Layer*)));
 
     mMapDocument = mapDocument;
 
-    if (mMapDocument)
+    if (mMapDocument) {
         connect(mMapDocument, SIGNAL(regionEdited(QRegion,Layer*)),
                 this, SLOT(autoMap(QRegion,Layer*)));
-    mLoaded = false;
-}
-
-void AutomappingManager::cleanUp()
-{
-    qDeleteAll(mAutoMappers);
-    mAutoMappers.clear();
+        preloadRules(mMapDocument);
+    }
 }
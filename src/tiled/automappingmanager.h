@@ -21,13 +21,18 @@
 #ifndef AUTOMAPPINGMANAGER_H
 #define AUTOMAPPINGMANAGER_H
 
+#include <QDateTime>
+#include <QFutureWatcher>
+#include <QHash>
+#include <QImage>
+#include <QMap>
 #include <QRegion>
 #include <QSet>
 #include <QString>
+#include <QStringList>
 #include <QTimer>
 #include <QVector>
 
-class QFileSystemWatcher;
 class QObject;
 
 namespace Tiled {
@@ -40,8 +45,32 @@ class Tileset;
 namespace Internal {
 
 class AutoMapper;
+class FileSystemWatcher;
 class MapDocument;
 
+/**
+ * The contents of a rules file and of the rule maps it refers to, as read
+ * from disk. Reading these files and decoding the images used by the rule
+ * maps doesn't need the GUI thread, so it can be done in the background.
+ */
+struct RuleFiles
+{
+    RuleFiles() : success(true) {}
+
+    QString rulesFileName;
+    QStringList ruleMapPaths;
+    QList<QByteArray> ruleMaps;
+    QHash<QString, QImage> images;
+
+    /**
+     * The modification times of all the files that were read.
+     */
+    QMap<QString, QDateTime> modified;
+
+    QString error;
+    bool success;
+};
+
 /**
  * This class is a superior class to the AutoMapper and AutoMapperWrapper class.
  * It uses these classes to do the whole automapping process.
@@ -87,9 +116,40 @@ signals:
 public slots:
     void autoMap(QRegion where, Layer *touchedLayer);
 
+private slots:
+    void preloadFinished();
+    void mapDocumentDestroyed(QObject *object);
+    void fileChanged(const QString &path);
+    void fileChangedTimeout();
+
 private:
     Q_DISABLE_COPY(AutomappingManager)
 
+    /**
+     * The AutoMappers set up for a map document, along with the modification
+     * times of the files they were loaded from.
+     */
+    struct RuleSet
+    {
+        RuleSet() : complete(true) {}
+
+        QString rulesFileName;
+        QMap<QString, QDateTime> modified;
+        QVector<AutoMapper*> autoMappers;
+
+        /**
+         * Errors and warnings which occurred while loading the rules and
+         * haven't been reported yet.
+         */
+        QString error;
+        QString warning;
+
+        /**
+         * Whether all of the rules could be loaded.
+         */
+        bool complete;
+    };
+
     /**
      * Constructor. Only used by the AutomappingManager itself.
      */
@@ -100,16 +160,37 @@ private:
     static AutomappingManager *mInstance;
 
     /**
-     * This function parses a rules file.
-     * For each path which is a rule, (fileextension is tmx) an AutoMapper
-     * object is setup.
-     *
-     * If a fileextension is txt, this file will be opened and searched for
-     * rules again.
-     *
-     * @return if the loading was successful: return true if it suceeded.
+     * Returns the path of the rules file used for \a mapDocument.
+     */
+    static QString rulesFileName(MapDocument *mapDocument);
+
+    /**
+     * Starts reading the rules for \a mapDocument in the background, unless
+     * they are already loaded and up to date.
+     */
+    void preloadRules(MapDocument *mapDocument);
+
+    /**
+     * Waits for the rules of \a mapDocument to be read in the background and
+     * sets up the AutoMappers for them.
      */
-    bool loadFile(const QString &filePath);
+    void finishPreload(MapDocument *mapDocument);
+
+    /**
+     * Sets up an AutoMapper for each of the rule maps in \a files, which
+     * were read for \a mapDocument. This needs to happen on the GUI thread,
+     * since the tilesets of the rule maps use pixmaps.
+     */
+    RuleSet *loadRuleSet(MapDocument *mapDocument, const RuleFiles &files);
+
+    /**
+     * Returns whether none of the files the \a ruleSet was loaded from have
+     * changed and it is still the one to use for \a mapDocument.
+     */
+    bool isUpToDate(const RuleSet *ruleSet, MapDocument *mapDocument) const;
+
+    void addRuleSet(MapDocument *mapDocument, RuleSet *ruleSet);
+    void removeRuleSet(MapDocument *mapDocument);
 
     /**
      * Applies automapping to the Region \a where, considering only layer
@@ -120,27 +201,28 @@ private:
      */
     void autoMapInternal(QRegion where, Layer *touchedLayer);
 
-    /**
-     * deletes all its data structures
-     */
-    void cleanUp();
-
     /**
      * The current map document.
      */
     MapDocument *mMapDocument;
 
     /**
-     * For each new file of rules a new AutoMapper is setup. In this vector we
-     * can store all of the AutoMappers in order.
+     * The rules loaded for each map document. For each file of rules an
+     * AutoMapper is set up, these are stored in order.
+     *
+     * The rules are kept around until one of their files changes, so that
+     * they don't need to be loaded again when switching between maps.
      */
-    QVector<AutoMapper*> mAutoMappers;
+    QHash<MapDocument*, RuleSet*> mRuleSets;
 
     /**
-     * This tells you if the rules for the current map document were already
-     * loaded.
+     * The rules that are currently being read in the background.
      */
-    bool mLoaded;
+    QHash<MapDocument*, QFutureWatcher<RuleFiles>*> mPreloads;
+
+    FileSystemWatcher *mWatcher;
+    QSet<QString> mChangedFiles;
+    QTimer mChangedFilesTimer;
 
     /**
      * Contains all errors which occurred until canceling.
@@ -31,17 +31,25 @@
 #include <QPainter>
 #include <QStyleOptionGraphicsItem>
 #include <QUndoStack>
+#include <qmath.h>
 
 using namespace Tiled;
 using namespace Tiled::Internal;
 
 BrushItem::BrushItem():
     mMapDocument(0),
-    mTileLayer(0)
+    mTileLayer(0),
+    mFillStamp(0)
 {
     setFlag(QGraphicsItem::ItemUsesExtendedStyleOption);
 }
 
+BrushItem::~BrushItem()
+{
+    delete mTileLayer;
+    delete mFillStamp;
+}
+
 void BrushItem::setMapDocument(MapDocument *mapDocument)
 {
     if (mMapDocument == mapDocument)
@@ -57,6 +65,9 @@ void BrushItem::setMapDocument(MapDocument *mapDocument)
 void BrushItem::setTileLayer(const TileLayer *tileLayer)
 {
     delete mTileLayer;
+    delete mFillStamp;
+    mFillStamp = 0;
+    mFillRegion.clear();
 
     if (tileLayer) {
         mTileLayer = static_cast<TileLayer*>(tileLayer->clone());
@@ -69,6 +80,19 @@ void BrushItem::setTileLayer(const TileLayer *tileLayer)
     update();
 }
 
+void BrushItem::setFill(const TileLayer *stamp, const TileRegion &region)
+{
+    delete mTileLayer;
+    mTileLayer = 0;
+    delete mFillStamp;
+    mFillStamp = static_cast<TileLayer*>(stamp->clone());
+    mFillRegion = region;
+    mRegion = region.toRegion();
+
+    updateBoundingRect();
+    update();
+}
+
 void BrushItem::setTileLayerPosition(const QPoint &pos)
 {
     if (!mTileLayer)
@@ -118,6 +142,11 @@ void BrushItem::paint(QPainter *painter,
         painter->setOpacity(0.75);
         renderer->drawTileLayer(painter, mTileLayer, option->exposedRect);
         painter->setOpacity(opacity);
+    } else if (mFillStamp) {
+        const qreal opacity = painter->opacity();
+        painter->setOpacity(0.75);
+        paintFill(painter, option->exposedRect);
+        painter->setOpacity(opacity);
     }
 
     renderer->drawTileSelection(painter, insideMapRegion,
@@ -141,10 +170,10 @@ void BrushItem::updateBoundingRect()
     mBoundingRect = mMapDocument->renderer()->boundingRect(bounds);
 
     // Adjust for amount of pixels tiles extend at the top and to the right
-    if (mTileLayer) {
+    if (const TileLayer *tileLayer = mTileLayer ? mTileLayer : mFillStamp) {
         const Map *map = mMapDocument->map();
 
-        QMargins drawMargins = mTileLayer->drawMargins();
+        QMargins drawMargins = tileLayer->drawMargins();
         drawMargins.setTop(drawMargins.top() - map->tileHeight());
         drawMargins.setRight(drawMargins.right() - map->tileWidth());
 
@@ -154,3 +183,69 @@ void BrushItem::updateBoundingRect()
                              drawMargins.bottom());
     }
 }
+
+/**
+ * Paints the part of the fill that may be visible within \a exposedRect, by
+ * repeating the fill stamp over a temporary layer covering just that part.
+ */
+void BrushItem::paintFill(QPainter *painter, const QRectF &exposedRect) const
+{
+    const MapRenderer *renderer = mMapDocument->renderer();
+    const Map *map = mMapDocument->map();
+    const QRect fillBounds = mFillRegion.boundingRect();
+
+    QRect tileRect = fillBounds;
+
+    if (!exposedRect.isNull()) {
+        // Include the cells whose tiles extend into the exposed rect
+        QMargins drawMargins = mFillStamp->drawMargins();
+        drawMargins.setTop(drawMargins.top() - map->tileHeight());
+        drawMargins.setRight(drawMargins.right() - map->tileWidth());
+
+        const QRectF rect = exposedRect.adjusted(-drawMargins.right(),
+                                                 -drawMargins.bottom(),
+                                                 drawMargins.left(),
+                                                 drawMargins.top());
+
+        const QPointF corners[4] = {
+            renderer->pixelToTileCoords(rect.topLeft()),
+            renderer->pixelToTileCoords(rect.topRight()),
+            renderer->pixelToTileCoords(rect.bottomLeft()),
+            renderer->pixelToTileCoords(rect.bottomRight())
+        };
+
+        qreal left = corners[0].x(), right = left;
+        qreal top = corners[0].y(), bottom = top;
+        for (int i = 1; i < 4; ++i) {
+            left = qMin(left, corners[i].x());
+            right = qMax(right, corners[i].x());
+            top = qMin(top, corners[i].y());
+            bottom = qMax(bottom, corners[i].y());
+        }
+
+        tileRect &= QRect(QPoint(qFloor(left) - 1, qFloor(top) - 1),
+                          QPoint(qCeil(right) + 1, qCeil(bottom) + 1));
+        if (tileRect.isEmpty())
+            return;
+    }
+
+    TileLayer layer(QString(),
+                    tileRect.x(), tileRect.y(),
+                    tileRect.width(), tileRect.height());
+
+    const int w = mFillStamp->width();
+    const int h = mFillStamp->height();
+
+    foreach (const QRect &run, mFillRegion.intersected(tileRect).runs()) {
+        const int stampY = (run.y() - fillBounds.top()) % h;
+
+        for (int x = run.left(); x <= run.right(); ++x) {
+            const int stampX = (x - fillBounds.left()) % w;
+            layer.setCell(x - tileRect.x(),
+                          run.y() - tileRect.y(),
+                          mFillStamp->cellAt(stampX, stampY));
+        }
+    }
+
+    renderer->drawTileLayer(painter, &layer, exposedRect);
+}
@@ -22,6 +22,8 @@
 #ifndef BRUSHITEM_H
 #define BRUSHITEM_H
 
+#include "tileregion.h"
+
 #include <QGraphicsItem>
 
 namespace Tiled {
@@ -44,6 +46,11 @@ public:
      */
     BrushItem();
 
+    /**
+     * Destructor.
+     */
+    ~BrushItem();
+
     /**
      * Sets the map document this brush is operating on.
      */
@@ -58,6 +65,16 @@ public:
      */
     void setTileLayer(const TileLayer *tileLayer);
 
+    /**
+     * Sets a \a stamp that is repeated over the given \a region, starting at
+     * the top-left of the region. This is used to preview a fill.
+     *
+     * The cells are only looked up for the exposed part of the region when
+     * painting, which keeps this cheap for large regions. Like with
+     * setTileLayer, a personal copy of the stamp is made.
+     */
+    void setFill(const TileLayer *stamp, const TileRegion &region);
+
     /**
      * Returns the current tile layer.
      */
@@ -87,9 +104,12 @@ public:
 
 private:
     void updateBoundingRect();
+    void paintFill(QPainter *painter, const QRectF &exposedRect) const;
 
     MapDocument *mMapDocument;
     TileLayer *mTileLayer;
+    TileLayer *mFillStamp;
+    TileRegion mFillRegion;
     QRegion mRegion;
     QRectF mBoundingRect;
 };
@@ -42,17 +42,18 @@ BucketFillTool::BucketFillTool(QObject *parent)
                        QKeySequence(tr("F")),
                        parent)
     , mStamp(0)
-    , mFillOverlay(0)
+    , mRandomStamp(0)
     , mIsActive(false)
     , mLastShiftStatus(false)
     , mIsRandom(false)
+    , mLastRandomStatus(false)
 {
 }
 
 BucketFillTool::~BucketFillTool()
 {
     delete mStamp;
-    delete mFillOverlay;
+    delete mRandomStamp;
 }
 
 void BucketFillTool::activate(MapScene *scene)
@@ -67,7 +68,7 @@ void BucketFillTool::deactivate(MapScene *scene)
 {
     AbstractTileTool::deactivate(scene);
 
-    mFillRegion = QRegion();
+    mFillRegion.clear();
     mIsActive = false;
 }
 
@@ -92,27 +93,27 @@ void BucketFillTool::tilePositionChanged(const QPoint &tilePos)
                                                            tilePos.y()))
         return;
 
-    // This clears the connections so we don't get callbacks
-    clearConnections(mapDocument());
-
     // Optimization: we don't need to recalculate the fill area
     // if the new mouse position is still over the filled region
     // and the shift modifier hasn't changed.
-    if (!mFillRegion.contains(tilePos) || shiftPressed != mLastShiftStatus || mIsRandom) {
-
-        // Clear overlay to make way for a new one
-        clearOverlay();
+    if (!mFillRegion.contains(tilePos) || shiftPressed != mLastShiftStatus) {
 
         // Cache information about how the fill region was created
         mLastShiftStatus = shiftPressed;
 
         // Get the new fill region
         if (!shiftPressed) {
-            // If not holding shift, a region is generated from the current pos
-            mFillRegion = regionComputer.computeFillRegion(tilePos);
+            // If not holding shift, a region is generated from the current
+            // pos, unless it was already computed since the last change
+            mFillRegion = cachedFillRegion(tilePos);
+
+            if (mFillRegion.isEmpty()) {
+                mFillRegion = regionComputer.computeFillRegion(tilePos);
+                addCachedFillRegion(mFillRegion);
+            }
         } else {
             // If holding shift, the region is the selection bounds
-            mFillRegion = mapDocument()->tileSelection();
+            mFillRegion = TileRegion(mapDocument()->tileSelection());
 
             // Fill region is the whole map if there is no selection
             if (mFillRegion.isEmpty())
@@ -120,47 +121,22 @@ void BucketFillTool::tilePositionChanged(const QPoint &tilePos)
 
             // The mouse needs to be in the region
             if (!mFillRegion.contains(tilePos))
-                mFillRegion = QRegion();
+                mFillRegion.clear();
         }
         fillRegionChanged = true;
     }
 
-    // Ensure that a fill region was created before making an overlay layer
-    if (mFillRegion.isEmpty())
+    // Ensure that a fill region was created before showing a preview
+    if (mFillRegion.isEmpty()) {
+        clearPreview();
         return;
-
-    if (mLastRandomStatus != mIsRandom)
-        fillRegionChanged = true;
-
-    if (!mFillOverlay) {
-        // Create a new overlay region
-        const QRect fillBounds = mFillRegion.boundingRect();
-        mFillOverlay = new TileLayer(QString(),
-                                     fillBounds.x(),
-                                     fillBounds.y(),
-                                     fillBounds.width(),
-                                     fillBounds.height());
     }
 
-    // Paint the new overlay
-    TilePainter tilePainter(mapDocument(), mFillOverlay);
-    if (!mIsRandom) {
-        if (fillRegionChanged)
-            tilePainter.drawStamp(mStamp, mFillRegion);
-    } else {
-        TileLayer *stamp = getRandomTileLayer(mFillRegion);
-        tilePainter.drawStamp(stamp, mFillRegion);
-        delete stamp;
+    if (mLastRandomStatus != mIsRandom)
         fillRegionChanged = true;
-    }
 
-    if (fillRegionChanged) {
-        // Update the brush item to draw the overlay
-        brushItem()->setTileLayer(mFillOverlay);
-        mLastRandomStatus = mIsRandom;
-    }
-    // Create connections to know when the overlay should be cleared
-    makeConnections();
+    if (fillRegionChanged)
+        updatePreview();
 }
 
 void BucketFillTool::mousePressed(QGraphicsSceneMouseEvent *event)
@@ -170,12 +146,17 @@ void BucketFillTool::mousePressed(QGraphicsSceneMouseEvent *event)
     if (!brushItem()->isVisible())
         return;
 
+    const TileLayer *fillStamp = mIsRandom ? mRandomStamp : mStamp;
+    if (!fillStamp)
+        return;
+
     FillTiles *fillTiles = new FillTiles(mapDocument(),
                                          currentTileLayer(),
                                          mFillRegion,
-                                         brushItem()->tileLayer());
+                                         fillStamp);
 
-    QRegion fillRegion(mFillRegion);
+    // The fill changes the map, which clears the preview and the fill region
+    const QRegion fillRegion = mFillRegion.toRegion();
     mapDocument()->undoStack()->push(fillTiles);
     mapDocument()->emitRegionEdited(fillRegion, currentTileLayer());
 }
@@ -187,7 +168,7 @@ void BucketFillTool::mouseReleased(QGraphicsSceneMouseEvent *)
 void BucketFillTool::modifiersChanged(Qt::KeyboardModifiers)
 {
     // Don't need to recalculate fill region if there was no fill region
-    if (!mFillOverlay)
+    if (mFillRegion.isEmpty())
         return;
 
     tilePositionChanged(tilePosition());
@@ -205,6 +186,7 @@ void BucketFillTool::mapDocumentChanged(MapDocument *oldDocument,
     AbstractTileTool::mapDocumentChanged(oldDocument, newDocument);
 
     clearConnections(oldDocument);
+    makeConnections();
 
     // Reset things that are probably invalid now
     setStamp(0);
@@ -214,7 +196,7 @@ void BucketFillTool::mapDocumentChanged(MapDocument *oldDocument,
 void BucketFillTool::setStamp(TileLayer *stamp)
 {
     // Clear any overlay that we presently have with an old stamp
-    clearOverlay();
+    clearPreview();
 
     delete mStamp;
     mStamp = stamp;
@@ -226,20 +208,73 @@ void BucketFillTool::setStamp(TileLayer *stamp)
         tilePositionChanged(tilePosition());
 }
 
+/**
+ * Clears the preview as well as the cached fill regions, which may no longer
+ * be valid.
+ */
 void BucketFillTool::clearOverlay()
 {
-    // Clear connections before clearing overlay so there is no
-    // risk of getting a callback and causing an infinite loop
-    clearConnections(mapDocument());
+    clearPreview();
+    mFillRegionCache.clear();
+}
 
+void BucketFillTool::clearPreview()
+{
     brushItem()->setTileLayer(0);
-    delete mFillOverlay;
-    mFillOverlay = 0;
+    delete mRandomStamp;
+    mRandomStamp = 0;
 
-    mFillRegion = QRegion();
+    mFillRegion.clear();
     brushItem()->setTileRegion(QRegion());
 }
 
+/**
+ * Shows the stamp repeated over the fill region. In random mode, a new
+ * random stamp is generated for the fill region.
+ */
+void BucketFillTool::updatePreview()
+{
+    delete mRandomStamp;
+    mRandomStamp = 0;
+
+    if (mIsRandom) {
+        mRandomStamp = getRandomTileLayer(mFillRegion);
+        brushItem()->setFill(mRandomStamp, mFillRegion);
+    } else {
+        brushItem()->setFill(mStamp, mFillRegion);
+    }
+
+    mLastRandomStatus = mIsRandom;
+}
+
+/**
+ * Returns the cached fill region containing \a tilePos, or an empty region
+ * when there is none. Since fill regions are connected components, the
+ * position can only be part of a single one.
+ */
+TileRegion BucketFillTool::cachedFillRegion(const QPoint &tilePos)
+{
+    for (int i = 0; i < mFillRegionCache.size(); ++i) {
+        if (mFillRegionCache.at(i).contains(tilePos)) {
+            // Move the region to the front, so it is dropped last
+            mFillRegionCache.move(i, 0);
+            return mFillRegionCache.first();
+        }
+    }
+
+    return TileRegion();
+}
+
+void BucketFillTool::addCachedFillRegion(const TileRegion &region)
+{
+    if (region.isEmpty())
+        return;
+
+    mFillRegionCache.prepend(region);
+    while (mFillRegionCache.size() > MaxCachedFillRegions)
+        mFillRegionCache.removeLast();
+}
+
 void BucketFillTool::makeConnections()
 {
     if (!mapDocument())
@@ -257,6 +292,13 @@ void BucketFillTool::makeConnections()
     // the overlay may be bound or may need to be bound to the selection
     connect(mapDocument(), SIGNAL(tileSelectionChanged(QRegion,QRegion)),
             this, SLOT(clearOverlay()));
+
+    // The cached fill regions are no longer valid when the position or size
+    // of a layer or the map changes
+    connect(mapDocument(), SIGNAL(layerChanged(int)),
+            this, SLOT(clearOverlay()));
+    connect(mapDocument(), SIGNAL(mapChanged()),
+            this, SLOT(clearOverlay()));
 }
 
 void BucketFillTool::clearConnections(MapDocument *mapDocument)
@@ -272,6 +314,11 @@ void BucketFillTool::clearConnections(MapDocument *mapDocument)
 
     disconnect(mapDocument, SIGNAL(tileSelectionChanged(QRegion,QRegion)),
                this, SLOT(clearOverlay()));
+
+    disconnect(mapDocument, SIGNAL(layerChanged(int)),
+               this, SLOT(clearOverlay()));
+    disconnect(mapDocument, SIGNAL(mapChanged()),
+               this, SLOT(clearOverlay()));
 }
 
 void BucketFillTool::setRandom(bool value)
@@ -287,13 +334,13 @@ void BucketFillTool::setRandom(bool value)
         mRandomList.clear();
 
     // Don't need to recalculate fill region if there was no fill region
-    if (!mFillOverlay)
+    if (mFillRegion.isEmpty())
         return;
 
-    tilePositionChanged(tilePosition());
+    updatePreview();
 }
 
-TileLayer *BucketFillTool::getRandomTileLayer(const QRegion &region) const
+TileLayer *BucketFillTool::getRandomTileLayer(const TileRegion &region) const
 {
     QRect bb = region.boundingRect();
     TileLayer *result = new TileLayer(QString(), bb.x(), bb.y(),
@@ -302,14 +349,11 @@ TileLayer *BucketFillTool::getRandomTileLayer(const QRegion &region) const
     if (region.isEmpty() || mRandomList.empty())
         return result;
 
-    foreach (const QRect &rect, region.rects()) {
-        for (int _x = rect.left(); _x <= rect.right(); ++_x) {
-            for (int _y = rect.top(); _y <= rect.bottom(); ++_y) {
-
-                result->setCell(_x - bb.x(),
-                                _y - bb.y(),
-                                mRandomList.at(rand() % mRandomList.size()));
-            }
+    foreach (const QRect &run, region.runs()) {
+        for (int _x = run.left(); _x <= run.right(); ++_x) {
+            result->setCell(_x - bb.x(),
+                            run.y() - bb.y(),
+                            mRandomList.at(rand() % mRandomList.size()));
         }
     }
     return result;
@@ -26,6 +26,7 @@
 #include "abstracttiletool.h"
 
 #include "tilelayer.h"
+#include "tileregion.h"
 
 namespace Tiled {
 namespace Internal {
@@ -79,12 +80,31 @@ private slots:
     void clearOverlay();
 
 private:
+    enum { MaxCachedFillRegions = 16 };
+
     void makeConnections();
     void clearConnections(MapDocument *mapDocument);
 
+    void clearPreview();
+    void updatePreview();
+
+    TileRegion cachedFillRegion(const QPoint &tilePos);
+    void addCachedFillRegion(const TileRegion &region);
+
     TileLayer *mStamp;
-    TileLayer *mFillOverlay;
-    QRegion mFillRegion;
+    TileRegion mFillRegion;
+
+    /**
+     * The random stamp covering the fill region in random mode. It is only
+     * generated again when the fill region changes, which includes filling.
+     */
+    TileLayer *mRandomStamp;
+
+    /**
+     * Recently computed fill regions, most recently used first. These are
+     * reused when hovering the same area again, until the map changes.
+     */
+    QList<TileRegion> mFillRegionCache;
 
     bool mIsActive;
     bool mLastShiftStatus;
@@ -97,8 +117,8 @@ private:
     /**
      * Contains the value of mIsRandom at that time, when the latest call of
      * tilePositionChanged() took place.
-     * This variable is needed to detect if the random mode was changed during
-     * mFillOverlay being brushed at an area.
+     * This variable is needed to detect if the random mode was changed while
+     * the fill preview was shown.
      */
     bool mLastRandomStatus;
 
@@ -119,7 +139,7 @@ private:
      * Returns a tile layer having random tiles placed at \a region.The
      * caller is responsible for the returned tile layer.
      */
-    TileLayer *getRandomTileLayer(const QRegion &region) const;
+    TileLayer *getRandomTileLayer(const TileRegion &region) const;
 };
 
 } // namespace Internal
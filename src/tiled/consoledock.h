@@ -37,6 +37,9 @@ protected slots:
     void appendInfo(QString str);
     void appendError(QString str);
 
+private slots:
+    void pluginLoaded(QObject *instance);
+
 private:
     QPlainTextEdit *plainTextEdit;
 };
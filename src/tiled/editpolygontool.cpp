@@ -226,9 +226,10 @@ void EditPolygonTool::mousePressed(QGraphicsSceneMouseEvent *event)
         mMousePressed = true;
         mStart = event->scenePos();
 
-        const QList<QGraphicsItem *> items = mapScene()->items(mStart);
-        mClickedObjectItem = first<MapObjectItem>(items);
-        mClickedHandle = first<PointHandle>(items);
+        // Objects in lightweight object groups have no item in the scene,
+        // so only the handles are looked up through the scene
+        mClickedObjectItem = topMostObjectItemAt(mStart);
+        mClickedHandle = first<PointHandle>(mapScene()->items(mStart));
         break;
     }
     case Qt::RightButton: {
@@ -416,14 +417,11 @@ void EditPolygonTool::updateSelection(const QPointF &pos,
 
     if (oldSelection.isEmpty()) {
         // Allow selecting some map objects only when there aren't any selected
-        QSet<MapObjectItem*> selectedItems;
-
-        foreach (QGraphicsItem *item, mapScene()->items(rect)) {
-            MapObjectItem *mapObjectItem = dynamic_cast<MapObjectItem*>(item);
-            if (mapObjectItem)
-                selectedItems.insert(mapObjectItem);
-        }
+        QPainterPath path;
+        path.addRect(rect);
 
+        const QSet<MapObjectItem*> selectedItems =
+                mapScene()->objectItemsIntersecting(path).toSet();
 
         QSet<MapObjectItem*> newSelection;
 
@@ -31,13 +31,13 @@ using namespace Tiled::Internal;
 
 FillTiles::FillTiles(MapDocument *mapDocument,
                      TileLayer *tileLayer,
-                     const QRegion &fillRegion,
+                     const TileRegion &fillRegion,
                      const TileLayer *fillStamp)
     : QUndoCommand(QCoreApplication::translate("Undo Commands", "Fill Area"))
     , mMapDocument(mapDocument)
     , mTileLayer(tileLayer)
     , mFillRegion(fillRegion)
-    , mOriginalCells(tileLayer->copy(mFillRegion))
+    , mOriginalCells(tileLayer->copy(mFillRegion.toRegion()))
     , mFillStamp(static_cast<TileLayer*>(fillStamp->clone()))
 {
 }
@@ -55,7 +55,7 @@ void FillTiles::undo()
     painter.setCells(boundingRect.x(),
                      boundingRect.y(),
                      mOriginalCells,
-                     mFillRegion);
+                     mFillRegion.toRegion());
 }
 
 void FillTiles::redo()
@@ -21,9 +21,9 @@
 #ifndef FILLTILES_H
 #define FILLTILES_H
 
+#include "tileregion.h"
 #include "undocommands.h"
 
-#include <QRegion>
 #include <QUndoCommand>
 
 namespace Tiled {
@@ -45,7 +45,7 @@ public:
      */
     FillTiles(MapDocument *mapDocument,
               TileLayer *tileLayer,
-              const QRegion &fillRegion,
+              const TileRegion &fillRegion,
               const TileLayer *fillStamp);
     ~FillTiles();
 
@@ -55,7 +55,7 @@ public:
 private:
     MapDocument *mMapDocument;
     TileLayer *mTileLayer;
-    QRegion mFillRegion;
+    TileRegion mFillRegion;
     TileLayer *mOriginalCells;
     TileLayer *mFillStamp;
 };
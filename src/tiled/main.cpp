@@ -28,6 +28,7 @@
 #include "tiledapplication.h"
 
 #include <QDebug>
+#include <QElapsedTimer>
 #include <QtPlugin>
 #include <QStyle>
 #include <QStyleFactory>
@@ -53,11 +54,13 @@ public:
     bool quit;
     bool showedVersion;
     bool disableOpenGL;
+    bool startupProfile;
 
 private:
     void showVersion();
     void justQuit();
     void setDisableOpenGL();
+    void setStartupProfile();
 
     // Convenience wrapper around registerOption
     template <void (CommandLineHandler::*memberFunction)()>
@@ -72,6 +75,44 @@ private:
     }
 };
 
+/**
+ * Measures the time spent in each phase of the startup, so that it can be
+ * reported when requested.
+ */
+class StartupProfile
+{
+public:
+    StartupProfile()
+        : mLastElapsed(0)
+    {
+        mTimer.start();
+    }
+
+    /**
+     * Ends the current phase, attributing the time since the end of the
+     * previous phase to the phase with the given \a name.
+     */
+    void endPhase(const char *name)
+    {
+        const qint64 elapsed = mTimer.elapsed();
+        mPhases.append(qMakePair(name, elapsed - mLastElapsed));
+        mLastElapsed = elapsed;
+    }
+
+    void report() const
+    {
+        typedef QPair<const char *, qint64> Phase;
+        foreach (const Phase &phase, mPhases)
+            qWarning("%-24s %6lld ms", phase.first, phase.second);
+        qWarning("%-24s %6lld ms", "Total", mLastElapsed);
+    }
+
+private:
+    QElapsedTimer mTimer;
+    qint64 mLastElapsed;
+    QList<QPair<const char *, qint64> > mPhases;
+};
+
 } // anonymous namespace
 
 
@@ -79,6 +120,7 @@ CommandLineHandler::CommandLineHandler()
     : quit(false)
     , showedVersion(false)
     , disableOpenGL(false)
+    , startupProfile(false)
 {
     option<&CommandLineHandler::showVersion>(
                 QLatin1Char('v'),
@@ -94,6 +136,11 @@ CommandLineHandler::CommandLineHandler()
                 QChar(),
                 QLatin1String("--disable-opengl"),
                 QLatin1String("Disable hardware accelerated rendering"));
+
+    option<&CommandLineHandler::setStartupProfile>(
+                QChar(),
+                QLatin1String("--startup-profile"),
+                QLatin1String("Report the time spent in each startup phase"));
 }
 
 void CommandLineHandler::showVersion()
@@ -116,9 +163,16 @@ void CommandLineHandler::setDisableOpenGL()
     disableOpenGL = true;
 }
 
+void CommandLineHandler::setStartupProfile()
+{
+    startupProfile = true;
+}
+
 
 int main(int argc, char *argv[])
 {
+    StartupProfile profile;
+
     /*
      * On X11, Tiled uses the 'raster' graphics system by default, because the
      * X11 native graphics system has performance problems with drawing the
@@ -165,9 +219,13 @@ int main(int argc, char *argv[])
     }
 #endif
 
+    profile.endPhase("Application");
+
     LanguageManager *languageManager = LanguageManager::instance();
     languageManager->installTranslators();
 
+    profile.endPhase("Translations");
+
     CommandLineHandler commandLine;
 
     if (!commandLine.parse(QCoreApplication::arguments()))
@@ -177,11 +235,17 @@ int main(int argc, char *argv[])
     if (commandLine.disableOpenGL)
         Preferences::instance()->setUseOpenGL(false);
 
+    profile.endPhase("Preferences");
+
     PluginManager::instance()->loadPlugins();
 
+    profile.endPhase("Plugin discovery");
+
     MainWindow w;
     w.show();
 
+    profile.endPhase("Main window");
+
     QObject::connect(&a, SIGNAL(fileOpenRequest(QString)),
                      &w, SLOT(openFile(QString)));
 
@@ -192,5 +256,10 @@ int main(int argc, char *argv[])
         w.openLastFiles();
     }
 
+    profile.endPhase("Opening files");
+
+    if (commandLine.startupProfile)
+        profile.report();
+
     return a.exec();
 }
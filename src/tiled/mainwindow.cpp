@@ -167,11 +167,11 @@ MainWindow::MainWindow(QWidget *parent, Qt::WindowFlags flags)
     undoAction->setIconText(tr("Undo"));
     connect(undoGroup, SIGNAL(cleanChanged(bool)), SLOT(updateWindowTitle()));
 
-    UndoDock *undoDock = new UndoDock(undoGroup, this);
+    mUndoDock = new UndoDock(undoGroup, this);
     PropertiesDock *propertiesDock = new PropertiesDock(this);
 
     addDockWidget(Qt::RightDockWidgetArea, mLayerDock);
-    addDockWidget(Qt::LeftDockWidgetArea, undoDock);
+    addDockWidget(Qt::LeftDockWidgetArea, mUndoDock);
     addDockWidget(Qt::LeftDockWidgetArea, mMapsDock);
     addDockWidget(Qt::RightDockWidgetArea, mObjectsDock);
     addDockWidget(Qt::RightDockWidgetArea, mMiniMapDock);
@@ -183,11 +183,11 @@ MainWindow::MainWindow(QWidget *parent, Qt::WindowFlags flags)
     tabifyDockWidget(mMiniMapDock, mObjectsDock);
     tabifyDockWidget(mObjectsDock, mLayerDock);
     tabifyDockWidget(mTerrainDock, mTilesetDock);
-    tabifyDockWidget(undoDock, mMapsDock);
+    tabifyDockWidget(mUndoDock, mMapsDock);
 
     // These dock widgets may not be immediately useful to many people, so
     // they are hidden by default.
-    undoDock->setVisible(false);
+    mUndoDock->setVisible(false);
     mMapsDock->setVisible(false);
     mConsoleDock->setVisible(false);
 
@@ -554,18 +554,10 @@ bool MainWindow::openFile(const QString &fileName,
 
     TmxMapReader tmxMapReader;
 
-    const PluginManager *pm = PluginManager::instance();
+    PluginManager *pm = PluginManager::instance();
     if (!mapReader && !tmxMapReader.supportsFile(fileName)) {
         // Try to find a plugin that implements support for this format
-        QList<MapReaderInterface*> readers =
-                pm->interfaces<MapReaderInterface>();
-
-        foreach (MapReaderInterface *reader, readers) {
-            if (reader->supportsFile(fileName)) {
-                mapReader = reader;
-                break;
-            }
-        }
+        mapReader = pm->readerForFile(fileName);
     }
 
     // check if we can save in that format as well
@@ -674,14 +666,11 @@ void MainWindow::openFile()
     selectedFilter = mSettings.value(QLatin1String("lastUsedOpenFilter"),
                                      selectedFilter).toString();
 
-    const PluginManager *pm = PluginManager::instance();
-    QList<MapReaderInterface*> readers = pm->interfaces<MapReaderInterface>();
-    foreach (const MapReaderInterface *reader, readers) {
-        foreach (const QString &str, reader->nameFilters()) {
-            if (!str.isEmpty()) {
-                filter += QLatin1String(";;");
-                filter += str;
-            }
+    PluginManager *pm = PluginManager::instance();
+    foreach (const QString &str, pm->nameFilters<MapReaderInterface>()) {
+        if (!str.isEmpty()) {
+            filter += QLatin1String(";;");
+            filter += str;
         }
     }
 
@@ -692,11 +681,8 @@ void MainWindow::openFile()
         return;
 
     // When a particular filter was selected, use the associated reader
-    MapReaderInterface *mapReader = 0;
-    foreach (MapReaderInterface *reader, readers) {
-        if (reader->nameFilters().contains(selectedFilter))
-            mapReader = reader;
-    }
+    MapReaderInterface *mapReader =
+            pm->interfaceForNameFilter<MapReaderInterface>(selectedFilter);
 
     mSettings.setValue(QLatin1String("lastUsedOpenFilter"), selectedFilter);
     foreach (const QString &fileName, fileNames)
@@ -739,13 +725,12 @@ bool MainWindow::saveFileAs()
     const QString tmxfilter = tr("Tiled map files (*.tmx)");
     QString filter = QString(tmxfilter);
     PluginManager *pm = PluginManager::instance();
+    const char *writerIid = qobject_interface_iid<MapWriterInterface*>();
+    const char *readerIid = qobject_interface_iid<MapReaderInterface*>();
     foreach (const Plugin &plugin, pm->plugins()) {
-        const MapWriterInterface *writer = qobject_cast<MapWriterInterface*>
-                (plugin.instance);
-        const MapReaderInterface *reader = qobject_cast<MapReaderInterface*>
-                (plugin.instance);
-        if (writer && reader) {
-            foreach (const QString &str, writer->nameFilters()) {
+        if (plugin.implements(writerIid) && plugin.implements(readerIid)) {
+            foreach (const QString &str,
+                     pm->nameFilters<MapWriterInterface>(plugin)) {
                 if (!str.isEmpty()) {
                     filter += QLatin1String(";;");
                     filter += str;
@@ -1236,6 +1221,15 @@ void MainWindow::autoMappingError()
     }
 }
 
+void MainWindow::undoHistoryLost()
+{
+    QMessageBox::warning(this, tr("Undo History Lost"),
+                         tr("Part of the undo history could not be read "
+                            "back from disk. The undo history has been "
+                            "cleared, but your changes to the map are "
+                            "kept."));
+}
+
 void MainWindow::openRecentFile()
 {
     QAction *action = qobject_cast<QAction *>(sender());
@@ -1535,12 +1529,15 @@ void MainWindow::mapDocumentChanged(MapDocument *mapDocument)
     mTilesetDock->setMapDocument(mMapDocument);
     mTerrainDock->setMapDocument(mMapDocument);
     mMiniMapDock->setMapDocument(mMapDocument);
+    mUndoDock->setMapDocument(mMapDocument);
     AutomappingManager::instance()->setMapDocument(mMapDocument);
     QuickStampManager::instance()->setMapDocument(mMapDocument);
 
     if (mMapDocument) {
         connect(mMapDocument, SIGNAL(fileNameChanged()),
                 SLOT(updateWindowTitle()));
+        connect(mMapDocument, SIGNAL(undoHistoryLost()),
+                SLOT(undoHistoryLost()));
         connect(mapDocument, SIGNAL(currentLayerIndexChanged(int)),
                 SLOT(updateActions()));
         connect(mapDocument, SIGNAL(tileSelectionChanged(QRegion,QRegion)),
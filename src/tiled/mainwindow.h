@@ -63,6 +63,7 @@ class StampBrush;
 class TerrainBrush;
 class TerrainDock;
 class TilesetDock;
+class UndoDock;
 class Zoomable;
 
 /**
@@ -165,6 +166,8 @@ public slots:
     void autoMappingError();
     void autoMappingWarning();
 
+    void undoHistoryLost();
+
 private:
     /**
       * Asks the user whether the given \a mapDocument should be saved, when
@@ -221,6 +224,7 @@ private:
     TilesetDock *mTilesetDock;
     TerrainDock *mTerrainDock;
     MiniMapDock* mMiniMapDock;
+    UndoDock *mUndoDock;
     ConsoleDock *mConsoleDock;
     QLabel *mCurrentLayerLabel;
     Zoomable *mZoomable;
@@ -40,6 +40,7 @@
 #include "orthogonalrenderer.h"
 #include "painttilelayer.h"
 #include "pluginmanager.h"
+#include "preferences.h"
 #include "resizelayer.h"
 #include "resizemap.h"
 #include "rotatemapobject.h"
@@ -51,14 +52,22 @@
 #include "tilesetmanager.h"
 #include "tileset.h"
 #include "tmxmapwriter.h"
+#include "undostorage.h"
 
 #include <QFileInfo>
 #include <QRect>
+#include <QSet>
 #include <QUndoStack>
 
 using namespace Tiled;
 using namespace Tiled::Internal;
 
+/**
+ * The minimum amount of milliseconds between two regionChanged signals, which
+ * limits the repaints caused by continuous changes to about 60 per second.
+ */
+static const int regionChangedInterval = 16;
+
 MapDocument::MapDocument(Map *map, const QString &fileName):
     mFileName(fileName),
     mMap(map),
@@ -66,7 +75,10 @@ MapDocument::MapDocument(Map *map, const QString &fileName):
     mCurrentObject(map),
     mMapObjectModel(new MapObjectModel(this)),
     mTerrainModel(new TerrainModel(this, this)),
-    mUndoStack(new QUndoStack(this))
+    mUndoStack(new QUndoStack(this)),
+    // Created after the undo stack, so that it is deleted after the commands
+    mUndoStorage(new UndoStorage(this)),
+    mUndoHistoryLost(false)
 {
     switch (map->orientation()) {
     case Map::Isometric:
@@ -111,9 +123,27 @@ MapDocument::MapDocument(Map *map, const QString &fileName):
 
     connect(mUndoStack, SIGNAL(cleanChanged(bool)), SIGNAL(modifiedChanged()));
 
+    // Report changed regions at the end of each command or macro, as well as
+    // periodically for changes made outside of the undo stack
+    connect(mUndoStack, SIGNAL(indexChanged(int)), SLOT(flushRegionChanged()));
+    connect(mUndoStack, SIGNAL(indexChanged(int)),
+            SLOT(applyUndoMemoryBudget()));
+
+    // Queued, since the undo stack can't be cleared while undoing
+    connect(mUndoStorage, SIGNAL(loadFailed()),
+            SLOT(onUndoStorageLoadFailed()), Qt::QueuedConnection);
+
+    mRegionChangedTimer.setSingleShot(true);
+    mRegionChangedTimer.setInterval(regionChangedInterval);
+    connect(&mRegionChangedTimer, SIGNAL(timeout()),
+            SLOT(flushRegionChanged()));
+
     // Register tileset references
     TilesetManager *tilesetManager = TilesetManager::instance();
     tilesetManager->addReferences(mMap->tilesets());
+
+    connect(tilesetManager, SIGNAL(tileImagesChanged(Tileset*,QList<Tile*>)),
+            SLOT(onTileImagesChanged(Tileset*,QList<Tile*>)));
 }
 
 MapDocument::~MapDocument()
@@ -152,6 +182,11 @@ bool MapDocument::save(const QString &fileName, QString *error)
     undoStack()->setClean();
     setFileName(fileName);
 
+    if (mUndoHistoryLost) {
+        mUndoHistoryLost = false;
+        emit modifiedChanged();
+    }
+
     return true;
 }
 
@@ -182,7 +217,7 @@ QString MapDocument::displayName() const
  */
 bool MapDocument::isModified() const
 {
-    return !mUndoStack->isClean();
+    return mUndoHistoryLost || !mUndoStack->isClean();
 }
 
 void MapDocument::setCurrentLayerIndex(int index)
@@ -611,6 +646,36 @@ void MapDocument::emitTilesetChanged(Tileset *tileset)
     emit tilesetChanged(tileset);
 }
 
+/**
+ * Adds the given \a region to the changed region, which is reported by the
+ * regionChanged signal once the current undo command has been applied or
+ * the next frame is due.
+ */
+void MapDocument::emitRegionChanged(const TileRegion &region)
+{
+    if (region.isEmpty())
+        return;
+
+    mChangedRegion |= region;
+
+    if (!mRegionChangedTimer.isActive())
+        mRegionChangedTimer.start();
+}
+
+void MapDocument::flushRegionChanged()
+{
+    mRegionChangedTimer.stop();
+
+    if (mChangedRegion.isEmpty())
+        return;
+
+    // Cleared first, since receivers may cause further changes
+    const QRegion region = mChangedRegion.toRegion();
+    mChangedRegion.clear();
+
+    emit regionChanged(region);
+}
+
 /**
  * Before forwarding the signal, the objects are removed from the list of
  * selected objects, triggering a selectedObjectsChanged signal when
@@ -705,6 +770,45 @@ void MapDocument::onTerrainRemoved(Terrain *terrain)
         setCurrentObject(0);
 }
 
+/**
+ * Reports the cells and tile objects using any of the given \a tiles as
+ * changed, so that only those get repainted.
+ */
+void MapDocument::onTileImagesChanged(Tileset *tileset,
+                                      const QList<Tile*> &tiles)
+{
+    if (!mMap->isTilesetUsed(tileset))
+        return;
+
+    const QSet<Tile*> changedTiles = tiles.toSet();
+    TileRegion region;
+    QList<MapObject*> changedObjects;
+
+    foreach (Layer *layer, mMap->layers()) {
+        if (!layer->referencesTileset(tileset))
+            continue;
+
+        if (TileLayer *tileLayer = layer->asTileLayer()) {
+            for (int y = 0; y < tileLayer->height(); ++y) {
+                for (int x = 0; x < tileLayer->width(); ++x) {
+                    Tile *tile = tileLayer->cellAt(x, y).tile;
+                    if (tile && changedTiles.contains(tile))
+                        region.add(x + tileLayer->x(), y + tileLayer->y());
+                }
+            }
+        } else if (ObjectGroup *objectGroup = layer->asObjectGroup()) {
+            foreach (MapObject *object, objectGroup->objects())
+                if (changedTiles.contains(object->cell().tile))
+                    changedObjects.append(object);
+        }
+    }
+
+    emitRegionChanged(region);
+
+    if (!changedObjects.isEmpty())
+        mMapObjectModel->emitObjectsChanged(changedObjects);
+}
+
 void MapDocument::deselectObjects(const QList<MapObject *> &objects)
 {
     // Unset the current object when it was part of this list of objects
@@ -816,3 +920,31 @@ void MapDocument::removeProperty(Object *object, const QString &name)
     object->removeProperty(name);
     emit propertyRemoved(object, name);
 }
+
+/**
+ * Moves the data of the least recently used undo commands to disk while the
+ * undo history uses more memory than allowed by the preferences.
+ */
+void MapDocument::applyUndoMemoryBudget()
+{
+    const int budget = Preferences::instance()->undoMemoryBudget();
+    if (budget > 0)
+        mUndoStorage->applyBudget(qint64(budget) * 1024 * 1024);
+}
+
+/**
+ * Clears the undo history when an undo command could not load its data back
+ * from disk, since undoing past that command would corrupt the map. The map
+ * is still considered modified until it is saved.
+ */
+void MapDocument::onUndoStorageLoadFailed()
+{
+    if (mUndoStack->count() == 0)
+        return;
+
+    mUndoHistoryLost = true;
+    mUndoStack->clear();
+
+    emit modifiedChanged();
+    emit undoHistoryLost();
+}
@@ -25,11 +25,13 @@
 
 #include "layer.h"
 #include "tiled.h"
+#include "tileregion.h"
 
 #include <QList>
 #include <QObject>
 #include <QRegion>
 #include <QString>
+#include <QTimer>
 
 class QModelIndex;
 class QPoint;
@@ -52,6 +54,7 @@ class LayerModel;
 class MapObjectModel;
 class TerrainModel;
 class TileSelectionModel;
+class UndoStorage;
 
 /**
  * Represents an editable map. The purpose of this class is to make sure that
@@ -193,6 +196,11 @@ public:
      */
     QUndoStack *undoStack() const { return mUndoStack; }
 
+    /**
+     * Returns the storage used by the undo commands of this map document.
+     */
+    UndoStorage *undoStorage() const { return mUndoStorage; }
+
     /**
      * Returns the selected area of tiles.
      */
@@ -233,6 +241,7 @@ public:
 
     void emitMapChanged();
     void emitRegionChanged(const QRegion &region);
+    void emitRegionChanged(const TileRegion &region);
     void emitRegionEdited(const QRegion &region, Layer *layer);
     void emitTilesetChanged(Tileset *tileset);
     void emitTileTerrainChanged(const QList<Tile*> &tiles);
@@ -245,6 +254,12 @@ signals:
     void fileNameChanged();
     void modifiedChanged();
 
+    /**
+     * Emitted when the undo history had to be cleared, because part of it
+     * could not be loaded back from disk.
+     */
+    void undoHistoryLost();
+
     /**
      * Emitted when the selected tile region changes. Sends the currently
      * selected region and the previously selected region.
@@ -286,6 +301,9 @@ signals:
     /**
      * Emitted when a certain region of the map changes. The region is given in
      * tile coordinates.
+     *
+     * Changes are collected and this signal is emitted at most once per frame,
+     * or when an undo command or macro has been pushed, undone or redone.
      */
     void regionChanged(const QRegion &region);
 
@@ -334,6 +352,13 @@ signals:
     void propertyChanged(Object *object, const QString &name);
     void propertiesChanged(Object *object);
 
+public slots:
+    /**
+     * Immediately emits the regionChanged signal for any changes that have
+     * not been reported yet.
+     */
+    void flushRegionChanged();
+
 private slots:
     void onObjectsRemoved(const QList<MapObject*> &objects);
 
@@ -347,6 +372,10 @@ private slots:
     void onLayerRemoved(int index);
 
     void onTerrainRemoved(Terrain *terrain);
+    void onTileImagesChanged(Tileset *tileset, const QList<Tile*> &tiles);
+
+    void applyUndoMemoryBudget();
+    void onUndoStorageLoadFailed();
 
 private:
     void setFileName(const QString &fileName);
@@ -372,6 +401,11 @@ private:
     MapObjectModel *mMapObjectModel;
     TerrainModel *mTerrainModel;
     QUndoStack *mUndoStack;
+    UndoStorage *mUndoStorage;
+    bool mUndoHistoryLost;
+
+    TileRegion mChangedRegion;
+    QTimer mRegionChangedTimer;
 };
 
 /**
@@ -384,12 +418,12 @@ inline void MapDocument::emitMapChanged()
 }
 
 /**
- * Emits the region changed signal for the specified region. The region
+ * Schedules the region changed signal for the specified region. The region
  * should be in tile coordinates. This method is used by the TilePainter.
  */
 inline void MapDocument::emitRegionChanged(const QRegion &region)
 {
-    emit regionChanged(region);
+    emitRegionChanged(TileRegion(region));
 }
 
 /**
@@ -339,3 +339,35 @@ QColor MapObjectItem::objectColor(const MapObject *object)
     // Fallback color
     return Qt::gray;
 }
+
+QRectF MapObjectItem::objectBoundingRect(const MapObject *object,
+                                         const MapRenderer *renderer)
+{
+    const QRectF bounds = renderer->boundingRect(object);
+    if (object->rotation() == 0)
+        return bounds;
+
+    const QPointF pixelPos = renderer->tileToPixelCoords(object->position());
+
+    QTransform transform;
+    transform.translate(pixelPos.x(), pixelPos.y());
+    transform.rotate(object->rotation());
+    transform.translate(-pixelPos.x(), -pixelPos.y());
+    return transform.mapRect(bounds);
+}
+
+QPainterPath MapObjectItem::objectShape(const MapObject *object,
+                                        const MapRenderer *renderer)
+{
+    const QPainterPath shape = renderer->shape(object);
+    if (object->rotation() == 0)
+        return shape;
+
+    const QPointF pixelPos = renderer->tileToPixelCoords(object->position());
+
+    QTransform transform;
+    transform.translate(pixelPos.x(), pixelPos.y());
+    transform.rotate(object->rotation());
+    transform.translate(-pixelPos.x(), -pixelPos.y());
+    return transform.map(shape);
+}
@@ -28,6 +28,7 @@
 namespace Tiled {
 
 class MapObject;
+class MapRenderer;
 
 namespace Internal {
 
@@ -102,6 +103,20 @@ public:
      */
     static QColor objectColor(const MapObject *object);
 
+    /**
+     * Returns the bounding rect in pixels of the given \a object as it would
+     * be painted by a MapObjectItem, taking into account its rotation.
+     */
+    static QRectF objectBoundingRect(const MapObject *object,
+                                     const MapRenderer *renderer);
+
+    /**
+     * Returns the shape in pixels of the given \a object as it would be
+     * used by a MapObjectItem, taking into account its rotation.
+     */
+    static QPainterPath objectShape(const MapObject *object,
+                                    const MapRenderer *renderer);
+
 private:
     MapDocument *mapDocument() const { return mMapDocument; }
     QColor color() const { return mColor; }
@@ -54,6 +54,13 @@ using namespace Tiled::Internal;
 static const qreal darkeningFactor = 0.6;
 static const qreal opacityFactor = 0.4;
 
+/**
+ * Object groups with at least this amount of objects are displayed by a
+ * lightweight ObjectGroupItem, which paints the objects itself instead of
+ * creating a MapObjectItem for each of them.
+ */
+static const int lightweightObjectCount = 1000;
+
 MapScene::MapScene(QObject *parent):
     QGraphicsScene(parent),
     mMapDocument(0),
@@ -62,7 +69,8 @@ MapScene::MapScene(QObject *parent):
     mUnderMouse(false),
     mCurrentModifiers(Qt::NoModifier),
     mDarkRectangle(new QGraphicsRectItem),
-    mDefaultBackgroundColor(Qt::darkGray)
+    mDefaultBackgroundColor(Qt::darkGray),
+    mHoveredObjectItem(0)
 {
     setBackgroundBrush(mDefaultBackgroundColor);
 
@@ -167,6 +175,8 @@ void MapScene::refreshScene()
 {
     mLayerItems.clear();
     mObjectItems.clear();
+    mTransientObjectItems.clear();
+    mHoveredObjectItem = 0;
 
     removeItem(mDarkRectangle);
     clear();
@@ -212,6 +222,12 @@ QGraphicsItem *MapScene::createLayerItem(Layer *layer)
     if (TileLayer *tl = layer->asTileLayer()) {
         layerItem = new TileLayerItem(tl, mMapDocument->renderer());
     } else if (ObjectGroup *og = layer->asObjectGroup()) {
+        if (og->objectCount() >= lightweightObjectCount) {
+            layerItem = new ObjectGroupItem(og, mMapDocument->renderer());
+            layerItem->setVisible(layer->isVisible());
+            return layerItem;
+        }
+
         const ObjectGroup::DrawOrder drawOrder = og->drawOrder();
         ObjectGroupItem *ogItem = new ObjectGroupItem(og);
         int objectIndex = 0;
@@ -273,7 +289,13 @@ void MapScene::repaintRegion(const QRegion &region)
     const MapRenderer *renderer = mMapDocument->renderer();
     const QMargins margins = mMapDocument->map()->drawMargins();
 
-    foreach (const QRect &r, region.rects()) {
+    // For fragmented regions, a single update of the bounding rect is cheaper
+    // than scheduling many small updates
+    const QVector<QRect> rects = region.rectCount() > 64
+            ? QVector<QRect>() << region.boundingRect()
+            : region.rects();
+
+    foreach (const QRect &r, rects) {
         update(renderer->boundingRect(r).adjusted(-margins.left(),
                                                   -margins.top(),
                                                   margins.right(),
@@ -281,6 +303,268 @@ void MapScene::repaintRegion(const QRegion &region)
     }
 }
 
+MapObjectItem *MapScene::itemForObject(MapObject *object)
+{
+    if (MapObjectItem *item = mObjectItems.value(object))
+        return item;
+
+    ObjectGroup *objectGroup = object->objectGroup();
+    ObjectGroupItem *ogItem = objectGroup ? objectGroupItem(objectGroup) : 0;
+    if (!ogItem || !ogItem->isLightweight())
+        return 0;
+
+    MapObjectItem *item = new MapObjectItem(object, mMapDocument, ogItem);
+    if (objectGroup->drawOrder() == ObjectGroup::TopDownOrder)
+        item->setZValue(item->y());
+    else
+        item->setZValue(objectGroup->objects().indexOf(object));
+
+    ogItem->setHasObjectItem(object, true);
+    mObjectItems.insert(object, item);
+    mTransientObjectItems.insert(item);
+    return item;
+}
+
+QList<MapObjectItem*> MapScene::objectItemsAt(const QPointF &pos)
+{
+    QList<MapObjectItem*> items;
+
+    foreach (MapObject *object, objectsAt(pos))
+        if (MapObjectItem *item = itemForObject(object))
+            items.append(item);
+
+    return items;
+}
+
+QList<MapObjectItem*> MapScene::objectItemsIntersecting(const QPainterPath &path)
+{
+    QList<MapObjectItem*> items;
+
+    foreach (MapObject *object, objectCandidates(path.boundingRect())) {
+        if (objectShape(object).intersects(path))
+            if (MapObjectItem *item = itemForObject(object))
+                items.append(item);
+    }
+
+    return items;
+}
+
+namespace {
+
+struct StackedObject
+{
+    qreal z;
+    MapObject *object;
+
+    bool operator<(const StackedObject &other) const
+    { return z > other.z; }
+};
+
+} // anonymous namespace
+
+/**
+ * Looks up the visible objects that may be found within the given
+ * \a sceneRect, using the spatial index of each visible object group. The
+ * objects are returned in stacking order, with the top-most object first.
+ *
+ * No items are created for the objects of lightweight object groups.
+ */
+QList<MapObject*> MapScene::objectCandidates(const QRectF &sceneRect) const
+{
+    QList<MapObject*> candidates;
+    if (!mMapDocument)
+        return candidates;
+
+    const MapRenderer *renderer = mMapDocument->renderer();
+    const QList<Layer*> &layers = mMapDocument->map()->layers();
+
+    for (int i = layers.size() - 1; i >= 0; --i) {
+        ObjectGroup *objectGroup = dynamic_cast<ObjectGroup*>(layers.at(i));
+        if (!objectGroup || !objectGroup->isVisible())
+            continue;
+
+        const ObjectGroupItem *ogItem =
+                static_cast<ObjectGroupItem*>(mLayerItems.at(i));
+        const QRectF rect = sceneRect.translated(-ogItem->pos());
+        const QRectF queryRect = renderer->objectQueryRect(rect);
+        const bool topDown = objectGroup->drawOrder() == ObjectGroup::TopDownOrder;
+
+        // The objects are returned in index order, matching the Z value of
+        // their items unless they are drawn in top-down order
+        const QList<MapObject*> objects = objectGroup->objectsIntersecting(queryRect);
+        QVector<StackedObject> stacked;
+        stacked.reserve(objects.size());
+
+        // Later objects are on top when their Z value is the same
+        for (int j = objects.size() - 1; j >= 0; --j) {
+            MapObject *object = objects.at(j);
+
+            if (const MapObjectItem *item = mObjectItems.value(object)) {
+                if (!item->isVisible())
+                    continue;
+            } else if (!ogItem->isLightweight() || !object->isVisible()) {
+                continue;
+            }
+
+            const StackedObject stackedObject = {
+                topDown ? renderer->tileToPixelCoords(object->position()).y() : 0,
+                object
+            };
+            stacked.append(stackedObject);
+        }
+
+        if (topDown)
+            qStableSort(stacked);
+
+        foreach (const StackedObject &stackedObject, stacked)
+            candidates.append(stackedObject.object);
+    }
+
+    return candidates;
+}
+
+/**
+ * Returns the visible objects whose shape contains the scene position
+ * \a pos, with the top-most object first. Unlike objectItemsAt(), this does
+ * not create any items.
+ */
+QList<MapObject*> MapScene::objectsAt(const QPointF &pos) const
+{
+    QList<MapObject*> objects;
+
+    foreach (MapObject *object, objectCandidates(QRectF(pos, QSizeF(0, 0))))
+        if (objectShape(object).contains(pos))
+            objects.append(object);
+
+    return objects;
+}
+
+/**
+ * Returns the shape of the given \a object in scene coordinates, without
+ * creating an item for it.
+ */
+QPainterPath MapScene::objectShape(MapObject *object) const
+{
+    if (const MapObjectItem *item = mObjectItems.value(object))
+        return item->mapToScene(item->shape());
+
+    const ObjectGroupItem *ogItem = objectGroupItem(object->objectGroup());
+    const QPainterPath shape =
+            MapObjectItem::objectShape(object, mMapDocument->renderer());
+    return shape.translated(ogItem->pos());
+}
+
+ObjectGroupItem *MapScene::objectGroupItem(ObjectGroup *objectGroup) const
+{
+    const int index = mMapDocument->map()->layers().indexOf(objectGroup);
+    if (index == -1 || index >= mLayerItems.size())
+        return 0;
+
+    return static_cast<ObjectGroupItem*>(mLayerItems.at(index));
+}
+
+/**
+ * Makes sure the top-most object at \a pos has an item, so that it shows its
+ * tool tip even when it is part of a lightweight object group.
+ */
+void MapScene::updateHoveredObjectItem(const QPointF &pos)
+{
+    const QList<MapObject*> objects = objectsAt(pos);
+    MapObjectItem *item = objects.isEmpty() ? 0 : itemForObject(objects.first());
+    if (item == mHoveredObjectItem)
+        return;
+
+    mHoveredObjectItem = item;
+    releaseObjectItems();
+}
+
+/**
+ * Switches the item of the given object group to lightweight mode once the
+ * group has many objects, and back once most of them have been removed.
+ */
+void MapScene::updateObjectGroupMode(ObjectGroupItem *ogItem)
+{
+    ObjectGroup *objectGroup = ogItem->objectGroup();
+    const int objectCount = objectGroup->objectCount();
+
+    if (!ogItem->isLightweight() && objectCount >= lightweightObjectCount) {
+        ogItem->setRenderer(mMapDocument->renderer());
+
+        // Only keep the items that are being interacted with
+        foreach (MapObject *object, objectGroup->objects()) {
+            MapObjectItem *item = mObjectItems.value(object);
+            if (!item)
+                continue;
+
+            if (item == mHoveredObjectItem || mSelectedObjectItems.contains(item)) {
+                ogItem->setHasObjectItem(object, true);
+                mTransientObjectItems.insert(item);
+            } else {
+                mObjectItems.remove(object);
+                delete item;
+            }
+        }
+    } else if (ogItem->isLightweight() &&
+               objectCount < lightweightObjectCount / 2) {
+        const ObjectGroup::DrawOrder drawOrder = objectGroup->drawOrder();
+
+        for (int i = 0; i < objectCount; ++i) {
+            MapObject *object = objectGroup->objectAt(i);
+
+            if (MapObjectItem *item = mObjectItems.value(object)) {
+                mTransientObjectItems.remove(item);
+                continue;
+            }
+
+            MapObjectItem *item = new MapObjectItem(object, mMapDocument,
+                                                    ogItem);
+            if (drawOrder == ObjectGroup::TopDownOrder)
+                item->setZValue(item->y());
+            else
+                item->setZValue(i);
+
+            mObjectItems.insert(object, item);
+        }
+
+        ogItem->setRenderer(0);
+    }
+}
+
+bool MapScene::hasLightweightObjectGroups() const
+{
+    foreach (QGraphicsItem *item, mLayerItems) {
+        ObjectGroupItem *ogItem = dynamic_cast<ObjectGroupItem*>(item);
+        if (ogItem && ogItem->isLightweight())
+            return true;
+    }
+    return false;
+}
+
+/**
+ * Deletes the items that were created on demand for objects in lightweight
+ * object groups, when they are no longer selected or hovered. The objects
+ * are painted by their object group item again.
+ */
+void MapScene::releaseObjectItems()
+{
+    QSet<MapObjectItem*>::iterator it = mTransientObjectItems.begin();
+    while (it != mTransientObjectItems.end()) {
+        MapObjectItem *item = *it;
+        if (item == mHoveredObjectItem || mSelectedObjectItems.contains(item)) {
+            ++it;
+            continue;
+        }
+
+        MapObject *object = item->mapObject();
+        ObjectGroupItem *ogItem = static_cast<ObjectGroupItem*>(item->parentItem());
+        mObjectItems.remove(object);
+        delete item;
+        ogItem->setHasObjectItem(object, false);
+
+        it = mTransientObjectItems.erase(it);
+    }
+}
+
 void MapScene::enableSelectedTool()
 {
     if (!mSelectedTool || !mMapDocument)
@@ -359,6 +643,20 @@ void MapScene::layerAdded(int index)
 
 void MapScene::layerRemoved(int index)
 {
+    ObjectGroupItem *ogItem = dynamic_cast<ObjectGroupItem*>(mLayerItems.at(index));
+    if (ogItem && ogItem->isLightweight()) {
+        // Forget about the items created on demand, since their objects are
+        // not recreated when the layer is added back
+        foreach (MapObject *object, ogItem->objectGroup()->objects()) {
+            if (MapObjectItem *item = mObjectItems.take(object)) {
+                mTransientObjectItems.remove(item);
+                mSelectedObjectItems.remove(item);
+                if (item == mHoveredObjectItem)
+                    mHoveredObjectItem = 0;
+            }
+        }
+    }
+
     delete mLayerItems.at(index);
     mLayerItems.remove(index);
 }
@@ -421,26 +719,41 @@ void MapScene::tilesetTileOffsetChanged(Tileset *tileset)
         if (!cell.isEmpty() && cell.tile->tileset() == tileset)
             item->syncWithMapObject();
     }
+
+    foreach (QGraphicsItem *item, mLayerItems) {
+        ObjectGroupItem *ogItem = dynamic_cast<ObjectGroupItem*>(item);
+        if (!ogItem || !ogItem->isLightweight())
+            continue;
+
+        foreach (const MapObject *object, ogItem->objectGroup()->objects()) {
+            const Cell &cell = object->cell();
+            if (!cell.isEmpty() && cell.tile->tileset() == tileset)
+                ogItem->syncWithObject(object);
+        }
+    }
 }
 
 /**
- * Inserts map object items for the given objects.
+ * Inserts map object items for the given objects. For lightweight object
+ * groups, the object group item is updated instead.
  */
 void MapScene::objectsInserted(ObjectGroup *objectGroup, int first, int last)
 {
-    ObjectGroupItem *ogItem = 0;
+    ObjectGroupItem *ogItem = objectGroupItem(objectGroup);
+    Q_ASSERT(ogItem);
 
-    // Find the object group item for the object group
-    foreach (QGraphicsItem *item, mLayerItems) {
-        if (ObjectGroupItem *ogi = dynamic_cast<ObjectGroupItem*>(item)) {
-            if (ogi->objectGroup() == objectGroup) {
-                ogItem = ogi;
-                break;
-            }
-        }
+    if (ogItem->isLightweight()) {
+        for (int i = first; i <= last; ++i)
+            ogItem->syncWithObject(objectGroup->objectAt(i));
+        return;
     }
 
-    Q_ASSERT(ogItem);
+    // Inserting many objects at once is handled by switching to lightweight
+    // mode instead of creating an item for each of them
+    if (objectGroup->objectCount() >= lightweightObjectCount) {
+        updateObjectGroupMode(ogItem);
+        return;
+    }
 
     const ObjectGroup::DrawOrder drawOrder = objectGroup->drawOrder();
 
@@ -464,11 +777,31 @@ void MapScene::objectsRemoved(const QList<MapObject*> &objects)
 {
     foreach (MapObject *o, objects) {
         ObjectItems::iterator i = mObjectItems.find(o);
-        Q_ASSERT(i != mObjectItems.end());
+        if (i == mObjectItems.end())
+            continue;   // Painted by a lightweight object group item
+
+        MapObjectItem *item = i.value();
+        if (item == mHoveredObjectItem)
+            mHoveredObjectItem = 0;
 
-        mSelectedObjectItems.remove(i.value());
-        delete i.value();
+        ObjectGroupItem *ogItem = static_cast<ObjectGroupItem*>(item->parentItem());
+
+        mSelectedObjectItems.remove(item);
+        mTransientObjectItems.remove(item);
+        delete item;
         mObjectItems.erase(i);
+
+        // Otherwise the object is not painted when its removal is undone
+        ogItem->setHasObjectItem(o, false);
+    }
+
+    // The removed objects may have been painted by object group items
+    foreach (QGraphicsItem *item, mLayerItems) {
+        ObjectGroupItem *ogItem = dynamic_cast<ObjectGroupItem*>(item);
+        if (ogItem && ogItem->isLightweight()) {
+            ogItem->update();
+            updateObjectGroupMode(ogItem);
+        }
     }
 }
 
@@ -478,10 +811,14 @@ void MapScene::objectsRemoved(const QList<MapObject*> &objects)
 void MapScene::objectsChanged(const QList<MapObject*> &objects)
 {
     foreach (MapObject *object, objects) {
-        MapObjectItem *item = itemForObject(object);
-        Q_ASSERT(item);
+        if (MapObjectItem *item = mObjectItems.value(object)) {
+            item->syncWithMapObject();
+        } else {
+            ObjectGroupItem *ogItem = objectGroupItem(object->objectGroup());
+            Q_ASSERT(ogItem && ogItem->isLightweight());
 
-        item->syncWithMapObject();
+            ogItem->syncWithObject(object);
+        }
     }
 }
 
@@ -494,11 +831,16 @@ void MapScene::objectsIndexChanged(ObjectGroup *objectGroup,
     if (objectGroup->drawOrder() != ObjectGroup::IndexOrder)
         return;
 
+    ObjectGroupItem *ogItem = objectGroupItem(objectGroup);
+    if (ogItem && ogItem->isLightweight())
+        ogItem->update();
+
     for (int i = first; i <= last; ++i) {
-        MapObjectItem *item = itemForObject(objectGroup->objectAt(i));
-        Q_ASSERT(item);
+        MapObjectItem *item = mObjectItems.value(objectGroup->objectAt(i));
+        Q_ASSERT(item || ogItem->isLightweight());
 
-        item->setZValue(i);
+        if (item)
+            item->setZValue(i);
     }
 }
 
@@ -522,12 +864,20 @@ void MapScene::updateSelectedObjectItems()
 
     mSelectedObjectItems = items;
     emit selectedObjectItemsChanged();
+
+    releaseObjectItems();
 }
 
 void MapScene::syncAllObjectItems()
 {
     foreach (MapObjectItem *item, mObjectItems)
         item->syncWithMapObject();
+
+    foreach (QGraphicsItem *item, mLayerItems) {
+        ObjectGroupItem *ogItem = dynamic_cast<ObjectGroupItem*>(item);
+        if (ogItem && ogItem->isLightweight())
+            ogItem->update();
+    }
 }
 
 /**
@@ -553,12 +903,19 @@ void MapScene::setObjectLineWidth(qreal lineWidth)
         mMapDocument->renderer()->setObjectLineWidth(lineWidth);
 
         // Changing the line width can change the size of the object items
-        if (!mObjectItems.isEmpty()) {
-            foreach (MapObjectItem *item, mObjectItems)
-                item->syncWithMapObject();
+        foreach (MapObjectItem *item, mObjectItems)
+            item->syncWithMapObject();
+
+        foreach (QGraphicsItem *item, mLayerItems) {
+            ObjectGroupItem *ogItem = dynamic_cast<ObjectGroupItem*>(item);
+            if (!ogItem || !ogItem->isLightweight())
+                continue;
 
-            update();
+            foreach (const MapObject *object, ogItem->objectGroup()->objects())
+                ogItem->syncWithObject(object);
         }
+
+        update();
     }
 }
 
@@ -571,8 +928,7 @@ void MapScene::setShowTileObjectOutlines(bool enabled)
 
     if (mMapDocument) {
         mMapDocument->renderer()->setFlag(ShowTileObjectOutlines, enabled);
-        if (!mObjectItems.isEmpty())
-            update();
+        update();
     }
 }
 
@@ -630,6 +986,10 @@ void MapScene::mouseMoveEvent(QGraphicsSceneMouseEvent *mouseEvent)
     if (!mMapDocument)
         return;
 
+    // While a button is held, the tools may refer to the hovered item
+    if (mouseEvent->buttons() == Qt::NoButton && hasLightweightObjectGroups())
+        updateHoveredObjectItem(mouseEvent->scenePos());
+
     QGraphicsScene::mouseMoveEvent(mouseEvent);
     if (mouseEvent->isAccepted())
         return;
@@ -92,9 +92,27 @@ public:
 
     /**
      * Returns the MapObjectItem associated with the given \a mapObject.
+     *
+     * Objects in lightweight object groups are painted by their
+     * ObjectGroupItem, in which case the item is created on demand. Such an
+     * item is released again when it is no longer selected or hovered.
      */
-    MapObjectItem *itemForObject(MapObject *object) const
-    { return mObjectItems.value(object); }
+    MapObjectItem *itemForObject(MapObject *object);
+
+    /**
+     * Returns the map object items at the given scene position \a pos, with
+     * the top-most item first. Only visible objects are considered.
+     *
+     * This uses the spatial index of the object groups rather than the
+     * scene index, so it remains fast for large amounts of objects.
+     */
+    QList<MapObjectItem*> objectItemsAt(const QPointF &pos);
+
+    /**
+     * Returns the map object items whose shape intersects with the given
+     * \a path in scene coordinates, with the top-most item first.
+     */
+    QList<MapObjectItem*> objectItemsIntersecting(const QPainterPath &path);
 
     /**
      * Enables the selected tool at this map scene.
@@ -174,6 +192,16 @@ private slots:
 private:
     QGraphicsItem *createLayerItem(Layer *layer);
 
+    QList<MapObject*> objectCandidates(const QRectF &sceneRect) const;
+    QList<MapObject*> objectsAt(const QPointF &pos) const;
+    QPainterPath objectShape(MapObject *object) const;
+
+    ObjectGroupItem *objectGroupItem(ObjectGroup *objectGroup) const;
+    void updateHoveredObjectItem(const QPointF &pos);
+    void updateObjectGroupMode(ObjectGroupItem *ogItem);
+    bool hasLightweightObjectGroups() const;
+    void releaseObjectItems();
+
     void updateCurrentLayerHighlight();
 
     bool eventFilter(QObject *object, QEvent *event);
@@ -195,6 +223,8 @@ private:
     typedef QMap<MapObject*, MapObjectItem*> ObjectItems;
     ObjectItems mObjectItems;
     QSet<MapObjectItem*> mSelectedObjectItems;
+    QSet<MapObjectItem*> mTransientObjectItems;
+    MapObjectItem *mHoveredObjectItem;
 };
 
 } // namespace Internal
@@ -141,23 +141,13 @@ MapsView::MapsView(MainWindow *mainWindow, QWidget *parent)
     mFSModel = new QFileSystemModel(this);
     mFSModel->setRootPath(mapsDir.absolutePath());
 
-    PluginManager *pm = PluginManager::instance();
-    QStringList nameFilters(QLatin1String("*.tmx"));
-
-    // The file system model name filters are plain, whereas the plugins expose
-    // a filter as part of the file description
-    QRegExp filterFinder(QLatin1String("\\((\\*\\.[^\\)\\s]*)"));
-
-    foreach (MapReaderInterface *reader, pm->interfaces<MapReaderInterface>()) {
-        foreach (const QString &filter, reader->nameFilters()) {
-            if (filterFinder.indexIn(filter) != -1)
-                nameFilters.append(filterFinder.cap(1));
-        }
-    }
-
     mFSModel->setFilter(QDir::AllDirs | QDir::Files | QDir::NoDot);
-    mFSModel->setNameFilters(nameFilters);
     mFSModel->setNameFilterDisables(false); // hide filtered files
+    updateNameFilters();
+
+    // Plugins loaded later on may support additional formats
+    connect(PluginManager::instance(), SIGNAL(pluginLoaded(QObject*)),
+            SLOT(updateNameFilters()));
 
     setModel(mFSModel);
 
@@ -179,6 +169,28 @@ MapsView::MapsView(MainWindow *mainWindow, QWidget *parent)
             SLOT(onActivated(QModelIndex)));
 }
 
+/**
+ * Sets up the name filters of the file system model, based on the name
+ * filters known without loading any further plugins.
+ */
+void MapsView::updateNameFilters()
+{
+    const PluginManager *pm = PluginManager::instance();
+    QStringList nameFilters(QLatin1String("*.tmx"));
+
+    // The file system model name filters are plain, whereas the plugins expose
+    // a filter as part of the file description
+    QRegExp filterFinder(QLatin1String("\\((\\*\\.[^\\)\\s]*)"));
+
+    foreach (const QString &filter,
+             pm->availableNameFilters<MapReaderInterface>()) {
+        if (filterFinder.indexIn(filter) != -1)
+            nameFilters.append(filterFinder.cap(1));
+    }
+
+    mFSModel->setNameFilters(nameFilters);
+}
+
 QSize MapsView::sizeHint() const
 {
     return QSize(130, 100);
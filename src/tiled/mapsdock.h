@@ -80,6 +80,7 @@ public:
 private slots:
     void onMapsDirectoryChanged();
     void onActivated(const QModelIndex &index);
+    void updateNameFilters();
 
 private:
     MainWindow *mMainWindow;
@@ -32,9 +32,12 @@
 #include "objectgroup.h"
 #include "preferences.h"
 #include "tilelayer.h"
+#include "tileset.h"
+#include "tilesetmanager.h"
 #include "zoomable.h"
 
 #include <QCursor>
+#include <QElapsedTimer>
 #include <QPainter>
 #include <QResizeEvent>
 #include <QScrollBar>
@@ -43,11 +46,34 @@
 using namespace Tiled;
 using namespace Tiled::Internal;
 
+/**
+ * The amount of time in milliseconds that may be spent on rendering the
+ * minimap image before control is returned to the event loop. The rest of
+ * the image is rendered on the next iterations.
+ */
+static const int RenderTimeBudget = 20;
+
+/**
+ * The maximum height in pixels of a single band of the minimap image that
+ * is rendered in one go.
+ */
+static const int RenderBandHeight = 32;
+
+/**
+ * When a tile would be displayed smaller than this amount of pixels, tiles
+ * are represented by their average color instead of their scaled image.
+ */
+static const qreal TileColorThreshold = 2;
+
 MiniMap::MiniMap(QWidget *parent)
     : QFrame(parent)
     , mMapDocument(0)
+    , mImageScale(1)
     , mDragging(false)
     , mMouseMoveCursorState(false)
+    , mRedrawMapImage(false)
+    , mFullRedrawPending(false)
+    , mChangeNotified(false)
     , mRenderFlags(DrawTiles | DrawObjects | DrawImages | IgnoreInvisibleLayer)
 {
     setFrameStyle(QFrame::StyledPanel | QFrame::Sunken);
@@ -59,6 +85,12 @@ MiniMap::MiniMap(QWidget *parent)
     mMapImageUpdateTimer.setSingleShot(true);
     connect(&mMapImageUpdateTimer, SIGNAL(timeout()),
             SLOT(redrawTimeout()));
+
+    connect(TilesetManager::instance(), SIGNAL(tilesetChanged(Tileset*)),
+            SLOT(tilesetChanged(Tileset*)));
+    connect(TilesetManager::instance(),
+            SIGNAL(tileImagesChanged(Tileset*,QList<Tile*>)),
+            SLOT(tileImagesChanged(Tileset*,QList<Tile*>)));
 }
 
 void MiniMap::setMapDocument(MapDocument *map)
@@ -67,6 +99,7 @@ void MiniMap::setMapDocument(MapDocument *map)
 
     if (mMapDocument) {
         mMapDocument->disconnect(this);
+        mMapDocument->undoStack()->disconnect(this);
 
         if (MapView *mapView = dm->viewForDocument(mMapDocument)) {
             mapView->zoomable()->disconnect(this);
@@ -76,10 +109,40 @@ void MiniMap::setMapDocument(MapDocument *map)
     }
 
     mMapDocument = map;
+    mObjectImageRects.clear();
+    mTileColors.clear();
 
     if (mMapDocument) {
+        // Changes that can be localized are tracked through these signals,
+        // any other change to the map causes the whole image to be redrawn.
         connect(mMapDocument->undoStack(), SIGNAL(indexChanged(int)),
-                this, SLOT(scheduleMapImageUpdate()));
+                this, SLOT(undoIndexChanged()));
+        connect(mMapDocument, SIGNAL(regionChanged(QRegion)),
+                this, SLOT(scheduleRegionUpdate(QRegion)));
+        connect(mMapDocument, SIGNAL(mapChanged()),
+                this, SLOT(mapChanged()));
+        connect(mMapDocument, SIGNAL(layerAdded(int)),
+                this, SLOT(mapChanged()));
+        connect(mMapDocument, SIGNAL(layerRemoved(int)),
+                this, SLOT(mapChanged()));
+        connect(mMapDocument, SIGNAL(layerChanged(int)),
+                this, SLOT(mapChanged()));
+        connect(mMapDocument, SIGNAL(objectGroupChanged(ObjectGroup*)),
+                this, SLOT(mapChanged()));
+        connect(mMapDocument, SIGNAL(imageLayerChanged(ImageLayer*)),
+                this, SLOT(mapChanged()));
+        connect(mMapDocument, SIGNAL(tilesetTileOffsetChanged(Tileset*)),
+                this, SLOT(mapChanged()));
+        connect(mMapDocument, SIGNAL(tilesetRemoved(Tileset*)),
+                this, SLOT(tilesetRemoved(Tileset*)));
+        connect(mMapDocument, SIGNAL(objectsInserted(ObjectGroup*,int,int)),
+                this, SLOT(objectsInserted(ObjectGroup*,int,int)));
+        connect(mMapDocument, SIGNAL(objectsRemoved(QList<MapObject*>)),
+                this, SLOT(objectsRemoved(QList<MapObject*>)));
+        connect(mMapDocument, SIGNAL(objectsChanged(QList<MapObject*>)),
+                this, SLOT(objectsChanged(QList<MapObject*>)));
+        connect(mMapDocument, SIGNAL(objectsIndexChanged(ObjectGroup*,int,int)),
+                this, SLOT(objectsIndexChanged(ObjectGroup*,int,int)));
 
         if (MapView *mapView = dm->viewForDocument(mMapDocument)) {
             connect(mapView->horizontalScrollBar(), SIGNAL(valueChanged(int)), SLOT(update()));
@@ -98,16 +161,41 @@ QSize MiniMap::sizeHint() const
 
 void MiniMap::scheduleMapImageUpdate()
 {
+    mFullRedrawPending = true;
     mMapImageUpdateTimer.start(100);
 }
 
+void MiniMap::scheduleRegionUpdate(const QRegion &region)
+{
+    mChangeNotified = true;
+
+    if (!mMapDocument || mFullRedrawPending || mMapImage.isNull())
+        return;
+
+    const MapRenderer *renderer = mMapDocument->renderer();
+    const QMargins margins = mMapDocument->map()->drawMargins();
+
+    foreach (const QRect &r, region.rects()) {
+        const QRectF bounds = renderer->boundingRect(r).adjusted(-margins.left(),
+                                                                 -margins.top(),
+                                                                 margins.right(),
+                                                                 margins.bottom());
+        const QRectF scaled(bounds.topLeft() * mImageScale,
+                            bounds.size() * mImageScale);
+        mDirtyImageRegion += scaled.toAlignedRect().adjusted(-1, -1, 1, 1);
+    }
+
+    if (!mMapImageUpdateTimer.isActive())
+        mMapImageUpdateTimer.start(100);
+}
+
 void MiniMap::paintEvent(QPaintEvent *pe)
 {
     QFrame::paintEvent(pe);
 
     if (mRedrawMapImage) {
-        renderMapToImage();
         mRedrawMapImage = false;
+        renderMapToImage();
     }
 
     if (mMapImage.isNull() || mImageRect.isEmpty())
@@ -168,8 +256,17 @@ static bool objectLessThan(const MapObject *a, const MapObject *b)
     return a->y() < b->y();
 }
 
-void MiniMap::renderMapToImage()
+/**
+ * Determines the scale and size of the minimap image and marks the whole
+ * image as dirty. When the size changed, the previous image is scaled to the
+ * new size, to have something to show while the new one is being rendered.
+ */
+void MiniMap::setupMapImage()
 {
+    mFullRedrawPending = false;
+    mDirtyImageRegion = QRegion();
+    mObjectImageRects.clear();
+
     if (!mMapDocument) {
         mMapImage = QImage();
         return;
@@ -185,36 +282,111 @@ void MiniMap::renderMapToImage()
     }
 
     // Determine the largest possible scale
-    qreal scale = qMin((qreal) r.width() / mapSize.width(),
+    mImageScale = qMin((qreal) r.width() / mapSize.width(),
                        (qreal) r.height() / mapSize.height());
 
     // Allocate a new image when the size changed
-    const QSize imageSize = mapSize * scale;
+    const QSize imageSize = mapSize * mImageScale;
     if (mMapImage.size() != imageSize) {
-        mMapImage = QImage(imageSize, QImage::Format_ARGB32);
+        if (mMapImage.isNull() || imageSize.isEmpty()) {
+            mMapImage = QImage(imageSize, QImage::Format_ARGB32_Premultiplied);
+            mMapImage.fill(Qt::transparent);
+        } else {
+            mMapImage = mMapImage.scaled(imageSize).convertToFormat(
+                        QImage::Format_ARGB32_Premultiplied);
+        }
         updateImageRect();
     }
 
     if (imageSize.isEmpty())
         return;
 
+    foreach (Layer *layer, mMapDocument->map()->layers()) {
+        if (const ObjectGroup *objectGroup = layer->asObjectGroup()) {
+            foreach (const MapObject *object, objectGroup->objects())
+                mObjectImageRects.insert(object, objectImageRect(object));
+        }
+    }
+
+    mDirtyImageRegion = mMapImage.rect();
+}
+
+/**
+ * Renders the dirty parts of the minimap image, in bands from top to bottom.
+ * When this takes longer than the time budget, the rendering of the
+ * remaining bands is scheduled for the next event loop iteration, so that
+ * rendering large maps doesn't block the user interface.
+ */
+void MiniMap::renderMapToImage()
+{
+    if (mFullRedrawPending)
+        setupMapImage();
+
+    if (mMapImage.isNull())
+        return;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    while (!mDirtyImageRegion.isEmpty()) {
+        QRect band = mDirtyImageRegion.rects().first();
+        if (band.height() > RenderBandHeight)
+            band.setHeight(RenderBandHeight);
+
+        mDirtyImageRegion -= band;
+        renderImageRect(band & mMapImage.rect());
+
+        if (timer.elapsed() > RenderTimeBudget)
+            break;
+    }
+
+    if (!mDirtyImageRegion.isEmpty())
+        mMapImageUpdateTimer.start(0);
+}
+
+/**
+ * Renders the part of the map covered by the given rectangle of the minimap
+ * image.
+ */
+void MiniMap::renderImageRect(const QRect &imageRect)
+{
+    if (imageRect.isEmpty())
+        return;
+
+    MapRenderer *renderer = mMapDocument->renderer();
+
     bool drawObjects = mRenderFlags.testFlag(DrawObjects);
     bool drawTiles = mRenderFlags.testFlag(DrawTiles);
     bool drawImages = mRenderFlags.testFlag(DrawImages);
     bool drawTileGrid = mRenderFlags.testFlag(DrawGrid);
     bool visibleLayersOnly = mRenderFlags.testFlag(IgnoreInvisibleLayer);
 
+    const Map *map = mMapDocument->map();
+    const bool useTileColors =
+            map->tileWidth() * mImageScale < TileColorThreshold &&
+            map->tileHeight() * mImageScale < TileColorThreshold;
+
+    const QRectF exposed(imageRect.x() / mImageScale,
+                         imageRect.y() / mImageScale,
+                         imageRect.width() / mImageScale,
+                         imageRect.height() / mImageScale);
+
+    const QRectF objectQueryRect = renderer->objectQueryRect(exposed);
+
     // Remember the current render flags
     const Tiled::RenderFlags renderFlags = renderer->flags();
     renderer->setFlag(ShowTileObjectOutlines, false);
 
-    mMapImage.fill(Qt::transparent);
     QPainter painter(&mMapImage);
+    painter.setCompositionMode(QPainter::CompositionMode_Source);
+    painter.fillRect(imageRect, Qt::transparent);
+    painter.setCompositionMode(QPainter::CompositionMode_SourceOver);
+    painter.setClipRect(imageRect);
     painter.setRenderHints(QPainter::SmoothPixmapTransform |
                            QPainter::HighQualityAntialiasing);
-    painter.setTransform(QTransform::fromScale(scale, scale));
+    painter.setTransform(QTransform::fromScale(mImageScale, mImageScale));
 
-    foreach (const Layer *layer, mMapDocument->map()->layers()) {
+    foreach (const Layer *layer, map->layers()) {
         if (visibleLayersOnly && !layer->isVisible())
             continue;
 
@@ -225,33 +397,228 @@ void MiniMap::renderMapToImage()
         const ImageLayer *imageLayer = dynamic_cast<const ImageLayer*>(layer);
 
         if (tileLayer && drawTiles) {
-            renderer->drawTileLayer(&painter, tileLayer);
+            if (useTileColors)
+                drawTileColors(&painter, tileLayer, exposed);
+            else
+                renderer->drawTileLayer(&painter, tileLayer, exposed);
         } else if (objGroup && drawObjects) {
-            QList<MapObject*> objects = objGroup->objects();
+            QList<MapObject*> objects;
+            foreach (MapObject *object, objGroup->objectsIntersecting(objectQueryRect)) {
+                if (object->isVisible() &&
+                        mObjectImageRects.value(object).intersects(imageRect))
+                    objects.append(object);
+            }
 
             if (objGroup->drawOrder() == ObjectGroup::TopDownOrder)
                 qStableSort(objects.begin(), objects.end(), objectLessThan);
 
             foreach (const MapObject *object, objects) {
-                if (object->isVisible()) {
-                    const QColor color = MapObjectItem::objectColor(object);
-                    renderer->drawMapObject(&painter, object, color);
-                }
+                const QColor color = MapObjectItem::objectColor(object);
+                renderer->drawMapObject(&painter, object, color);
             }
         } else if (imageLayer && drawImages) {
-            renderer->drawImageLayer(&painter, imageLayer);
+            renderer->drawImageLayer(&painter, imageLayer, exposed);
         }
     }
 
     if (drawTileGrid) {
         Preferences *prefs = Preferences::instance();
-        renderer->drawGrid(&painter, QRectF(QPointF(), renderer->mapSize()),
-                           prefs->gridColor());
+        renderer->drawGrid(&painter, exposed, prefs->gridColor());
     }
 
     renderer->setFlags(renderFlags);
 }
 
+/**
+ * Draws the tiles of the given \a layer as blocks of their average color.
+ * Used when tiles would be scaled down to less than a few pixels, in which
+ * case the individual tile images can't be distinguished anyway. Multiple
+ * tiles are represented by a single block when they'd share a pixel.
+ */
+void MiniMap::drawTileColors(QPainter *painter, const TileLayer *layer,
+                             const QRectF &exposed)
+{
+    const MapRenderer *renderer = mMapDocument->renderer();
+    const Map *map = mMapDocument->map();
+
+    const int step = qMax(1, (int) (1 / (qMax(map->tileWidth(),
+                                              map->tileHeight()) * mImageScale)));
+
+    // Determine the area of tiles covered by the exposed rectangle
+    QPolygonF corners;
+    corners << renderer->pixelToTileCoords(exposed.topLeft())
+            << renderer->pixelToTileCoords(exposed.topRight())
+            << renderer->pixelToTileCoords(exposed.bottomLeft())
+            << renderer->pixelToTileCoords(exposed.bottomRight());
+
+    const QRect tileRect = corners.boundingRect().toAlignedRect()
+            .adjusted(-1, -1, 1, 1) & layer->bounds();
+
+    const int startX = tileRect.left() - (tileRect.left() - layer->x()) % step;
+    const int startY = tileRect.top() - (tileRect.top() - layer->y()) % step;
+
+    painter->save();
+    painter->setRenderHint(QPainter::Antialiasing, false);
+
+    for (int y = startY; y <= tileRect.bottom(); y += step) {
+        for (int x = startX; x <= tileRect.right(); x += step) {
+            const Cell &cell = layer->cellAt(x - layer->x(), y - layer->y());
+            if (cell.isEmpty())
+                continue;
+
+            const QRgb color = tileColor(cell.tile);
+            if (qAlpha(color) == 0)
+                continue;
+
+            painter->fillRect(renderer->boundingRect(QRect(x, y, step, step)),
+                              QColor::fromRgba(color));
+        }
+    }
+
+    painter->restore();
+}
+
+/**
+ * Returns the average color of the given \a tile, which is cached until the
+ * tileset of the tile changes.
+ */
+QRgb MiniMap::tileColor(const Tile *tile)
+{
+    QHash<const Tile*, QRgb>::const_iterator it = mTileColors.constFind(tile);
+    if (it != mTileColors.constEnd())
+        return it.value();
+
+    QRgb color = 0;
+    const QImage image = tile->image().toImage();
+    if (!image.isNull()) {
+        // Smooth scaling averages the pixels of the image
+        color = image.scaled(1, 1,
+                             Qt::IgnoreAspectRatio,
+                             Qt::SmoothTransformation).pixel(0, 0);
+    }
+
+    mTileColors.insert(tile, color);
+    return color;
+}
+
+/**
+ * Returns the area of the minimap image that is covered by \a object.
+ */
+QRect MiniMap::objectImageRect(const MapObject *object) const
+{
+    const QRectF bounds = mMapDocument->renderer()->boundingRect(object);
+    const QRectF scaled(bounds.topLeft() * mImageScale,
+                        bounds.size() * mImageScale);
+    return scaled.toAlignedRect().adjusted(-1, -1, 1, 1);
+}
+
+/**
+ * Marks both the previous and the current area covered by the given
+ * \a object as dirty.
+ */
+void MiniMap::invalidateObject(const MapObject *object)
+{
+    mDirtyImageRegion += mObjectImageRects.value(object);
+
+    if (object->objectGroup()) {
+        const QRect imageRect = objectImageRect(object);
+        mObjectImageRects.insert(object, imageRect);
+        mDirtyImageRegion += imageRect;
+    } else {
+        mObjectImageRects.remove(object);
+    }
+}
+
+void MiniMap::undoIndexChanged()
+{
+    // Any change that wasn't reported in a more specific way requires a full
+    // redraw of the minimap image.
+    if (!mChangeNotified)
+        scheduleMapImageUpdate();
+    else if (!mMapImageUpdateTimer.isActive())
+        mMapImageUpdateTimer.start(100);
+
+    mChangeNotified = false;
+}
+
+void MiniMap::mapChanged()
+{
+    mChangeNotified = true;
+    scheduleMapImageUpdate();
+}
+
+void MiniMap::tilesetChanged(Tileset *tileset)
+{
+    // The tileset may have lost tiles, whose addresses can no longer be
+    // looked up through the tileset
+    mTileColors.clear();
+
+    if (mMapDocument && mMapDocument->map()->isTilesetUsed(tileset))
+        scheduleMapImageUpdate();
+}
+
+/**
+ * Forgets the colors of the tiles of a tileset removed from the map, since
+ * the tiles may be deleted and their addresses reused by other tiles.
+ */
+void MiniMap::tilesetRemoved(Tileset *tileset)
+{
+    for (int i = 0; i < tileset->tileCount(); ++i)
+        mTileColors.remove(tileset->tileAt(i));
+}
+
+/**
+ * Only forgets the colors of the changed tiles. The cells using them are
+ * repainted through the regionChanged signal of the map document.
+ */
+void MiniMap::tileImagesChanged(Tileset *, const QList<Tile*> &tiles)
+{
+    foreach (const Tile *tile, tiles)
+        mTileColors.remove(tile);
+}
+
+void MiniMap::objectsInserted(ObjectGroup *objectGroup, int first, int last)
+{
+    mChangeNotified = true;
+    if (mFullRedrawPending || mMapImage.isNull())
+        return;
+
+    for (int i = first; i <= last; ++i)
+        invalidateObject(objectGroup->objectAt(i));
+}
+
+void MiniMap::objectsRemoved(const QList<MapObject *> &objects)
+{
+    mChangeNotified = true;
+    if (mFullRedrawPending || mMapImage.isNull())
+        return;
+
+    foreach (MapObject *object, objects) {
+        mDirtyImageRegion += mObjectImageRects.value(object);
+        mObjectImageRects.remove(object);
+    }
+}
+
+void MiniMap::objectsChanged(const QList<MapObject *> &objects)
+{
+    mChangeNotified = true;
+    if (mFullRedrawPending || mMapImage.isNull())
+        return;
+
+    foreach (MapObject *object, objects)
+        invalidateObject(object);
+}
+
+void MiniMap::objectsIndexChanged(ObjectGroup *objectGroup, int first, int last)
+{
+    mChangeNotified = true;
+    if (mFullRedrawPending || mMapImage.isNull())
+        return;
+
+    for (int i = first; i <= last; ++i)
+        mDirtyImageRegion += mObjectImageRects.value(objectGroup->objectAt(i));
+}
+
 void MiniMap::centerViewOnLocalPixel(QPoint centerPos, int delta)
 {
     MapView *mapView = DocumentManager::instance()->currentMapView();
@@ -266,6 +633,9 @@ void MiniMap::centerViewOnLocalPixel(QPoint centerPos, int delta)
 
 void MiniMap::redrawTimeout()
 {
+    // Changes reported so far are now being handled, so a later change that
+    // is not reported in detail should again cause a full redraw.
+    mChangeNotified = false;
     mRedrawMapImage = true;
     update();
 }
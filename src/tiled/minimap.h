@@ -23,10 +23,23 @@
 #define MINIMAP_H
 
 #include <QFrame>
+#include <QHash>
 #include <QImage>
+#include <QRegion>
 #include <QTimer>
 
+class QPainter;
+
 namespace Tiled {
+
+class Layer;
+class ImageLayer;
+class MapObject;
+class ObjectGroup;
+class Tile;
+class TileLayer;
+class Tileset;
+
 namespace Internal {
 
 class MapDocument;
@@ -58,6 +71,12 @@ public slots:
     /** Schedules a redraw of the minimap image. */
     void scheduleMapImageUpdate();
 
+    /**
+     * Schedules a redraw of the part of the minimap image covering the
+     * given \a region, which is given in tile coordinates.
+     */
+    void scheduleRegionUpdate(const QRegion &region);
+
 protected:
     void paintEvent(QPaintEvent *);
     void resizeEvent(QResizeEvent *);
@@ -68,22 +87,44 @@ protected:
 
 private slots:
     void redrawTimeout();
+    void undoIndexChanged();
+    void mapChanged();
+    void tilesetChanged(Tileset *tileset);
+    void tilesetRemoved(Tileset *tileset);
+    void tileImagesChanged(Tileset *tileset, const QList<Tile*> &tiles);
+    void objectsInserted(ObjectGroup *objectGroup, int first, int last);
+    void objectsRemoved(const QList<MapObject*> &objects);
+    void objectsChanged(const QList<MapObject*> &objects);
+    void objectsIndexChanged(ObjectGroup *objectGroup, int first, int last);
 
 private:
     MapDocument *mMapDocument;
     QImage mMapImage;
+    qreal mImageScale;
     QRect mImageRect;
     QTimer mMapImageUpdateTimer;
     bool mDragging;
     QPoint mDragOffset;
     bool mMouseMoveCursorState;
     bool mRedrawMapImage;
+    bool mFullRedrawPending;
+    bool mChangeNotified;
+    QRegion mDirtyImageRegion;
+    QHash<const MapObject*, QRect> mObjectImageRects;
+    QHash<const Tile*, QRgb> mTileColors;
     MiniMapRenderFlags mRenderFlags;
 
     QRect viewportRect() const;
     QPointF mapToScene(QPoint p) const;
     void updateImageRect();
+    void setupMapImage();
     void renderMapToImage();
+    void renderImageRect(const QRect &imageRect);
+    void drawTileColors(QPainter *painter, const TileLayer *layer,
+                        const QRectF &exposed);
+    QRgb tileColor(const Tile *tile);
+    QRect objectImageRect(const MapObject *object) const;
+    void invalidateObject(const MapObject *object);
     void centerViewOnLocalPixel(QPoint centerPos, int delta = 0);
 };
 
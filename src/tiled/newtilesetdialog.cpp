@@ -26,7 +26,6 @@
 #include "utils.h"
 
 #include <QFileDialog>
-#include <QImage>
 #include <QMessageBox>
 #include <QSettings>
 #include <QFileInfo>
@@ -150,7 +149,7 @@ void NewTilesetDialog::tryAccept()
             tileset->setTransparentColor(transparentColor);
 
         if (!image.isEmpty()) {
-            if (!tileset->loadFromImage(QImage(image), image)) {
+            if (!tileset->loadFromImage(image)) {
                 QMessageBox::critical(this, tr("Error"),
                                       tr("Failed to load tileset image '%1'.")
                                       .arg(image));
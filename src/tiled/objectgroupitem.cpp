@@ -21,17 +21,38 @@
 #include "objectgroupitem.h"
 
 #include "map.h"
+#include "mapobject.h"
 #include "mapobjectitem.h"
+#include "maprenderer.h"
 #include "objectgroup.h"
 
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
+
 using namespace Tiled;
 using namespace Tiled::Internal;
 
-ObjectGroupItem::ObjectGroupItem(ObjectGroup *objectGroup):
-    mObjectGroup(objectGroup)
+namespace {
+
+struct PaintedObject
+{
+    qreal y;
+    MapObject *object;
+
+    bool operator<(const PaintedObject &other) const
+    { return y < other.y; }
+};
+
+} // anonymous namespace
+
+ObjectGroupItem::ObjectGroupItem(ObjectGroup *objectGroup,
+                                 MapRenderer *renderer):
+    mObjectGroup(objectGroup),
+    mRenderer(0)
 {
     // Since we don't do any painting, we can spare us the call to paint()
     setFlag(QGraphicsItem::ItemHasNoContents);
+    setRenderer(renderer);
 
     const Map *map = objectGroup->map();
     setPos(objectGroup->x() * map->tileWidth(),
@@ -40,13 +61,107 @@ ObjectGroupItem::ObjectGroupItem(ObjectGroup *objectGroup):
     setOpacity(objectGroup->opacity());
 }
 
+void ObjectGroupItem::setRenderer(MapRenderer *renderer)
+{
+    if (mRenderer == renderer)
+        return;
+
+    prepareGeometryChange();
+    mRenderer = renderer;
+    mBoundingRect = QRectF();
+    mObjectsWithItem.clear();
+
+    setFlag(QGraphicsItem::ItemHasNoContents, !mRenderer);
+    setFlag(QGraphicsItem::ItemUsesExtendedStyleOption, mRenderer != 0);
+
+    if (mRenderer) {
+        foreach (const MapObject *object, mObjectGroup->objects()) {
+            mBoundingRect |= MapObjectItem::objectBoundingRect(object,
+                                                               mRenderer);
+        }
+    }
+}
+
+void ObjectGroupItem::setHasObjectItem(MapObject *object, bool hasItem)
+{
+    if (!mRenderer)
+        return;
+
+    if (hasItem)
+        mObjectsWithItem.insert(object);
+    else
+        mObjectsWithItem.remove(object);
+
+    update(MapObjectItem::objectBoundingRect(object, mRenderer));
+}
+
+void ObjectGroupItem::syncWithObject(const MapObject *object)
+{
+    if (!mRenderer)
+        return;
+
+    const QRectF bounds = MapObjectItem::objectBoundingRect(object, mRenderer);
+    if (!mBoundingRect.contains(bounds)) {
+        prepareGeometryChange();
+        mBoundingRect |= bounds;
+    }
+
+    // The previous location of the object is not known
+    update();
+}
+
 QRectF ObjectGroupItem::boundingRect() const
 {
-    return QRectF();
+    return mBoundingRect;
 }
 
-void ObjectGroupItem::paint(QPainter *,
-                            const QStyleOptionGraphicsItem *,
+void ObjectGroupItem::paint(QPainter *painter,
+                            const QStyleOptionGraphicsItem *option,
                             QWidget *)
 {
+    if (!mRenderer)
+        return;
+
+    const QRectF exposed = option->exposedRect;
+    const QRectF queryRect = mRenderer->objectQueryRect(exposed);
+    const bool topDown = mObjectGroup->drawOrder() == ObjectGroup::TopDownOrder;
+
+    // Objects are returned in index order, which may need to be changed to
+    // top-down order.
+    QVector<PaintedObject> objects;
+
+    foreach (MapObject *object, mObjectGroup->objectsIntersecting(queryRect)) {
+        if (!object->isVisible() || mObjectsWithItem.contains(object))
+            continue;
+        if (!MapObjectItem::objectBoundingRect(object, mRenderer).intersects(exposed))
+            continue;
+
+        const PaintedObject paintedObject = {
+            topDown ? mRenderer->tileToPixelCoords(object->position()).y() : 0,
+            object
+        };
+        objects.append(paintedObject);
+    }
+
+    if (topDown)
+        qStableSort(objects);
+
+    foreach (const PaintedObject &paintedObject, objects) {
+        const MapObject *object = paintedObject.object;
+        const QColor color = MapObjectItem::objectColor(object);
+
+        if (object->rotation() != 0) {
+            const QPointF pixelPos =
+                    mRenderer->tileToPixelCoords(object->position());
+
+            painter->save();
+            painter->translate(pixelPos);
+            painter->rotate(object->rotation());
+            painter->translate(-pixelPos);
+            mRenderer->drawMapObject(painter, object, color);
+            painter->restore();
+        } else {
+            mRenderer->drawMapObject(painter, object, color);
+        }
+    }
 }
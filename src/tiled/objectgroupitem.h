@@ -22,27 +22,65 @@
 #define OBJECTGROUPITEM_H
 
 #include <QGraphicsItem>
+#include <QSet>
 
 namespace Tiled {
 
+class MapObject;
+class MapRenderer;
 class ObjectGroup;
 
 namespace Internal {
 
 /**
- * A graphics item representing an object group in a QGraphicsView. It only
- * serves to group together the objects belonging to the same object group.
+ * A graphics item representing an object group in a QGraphicsView. Usually
+ * it only serves to group together the objects belonging to the same object
+ * group.
+ *
+ * For object groups with many objects, the item can be created in
+ * lightweight mode. In this mode it paints the objects itself, so that no
+ * MapObjectItem needs to exist for each object. MapObjectItem instances are
+ * then only created for the objects that are being interacted with, and
+ * those objects are left for their item to paint.
  *
  * @see MapObjectItem
  */
 class ObjectGroupItem : public QGraphicsItem
 {
 public:
-    ObjectGroupItem(ObjectGroup *objectGroup);
+    /**
+     * Constructor. When a \a renderer is given, the item is created in
+     * lightweight mode and uses the renderer to paint the objects.
+     */
+    ObjectGroupItem(ObjectGroup *objectGroup, MapRenderer *renderer = 0);
 
     ObjectGroup *objectGroup() const
     { return mObjectGroup; }
 
+    /**
+     * Returns whether this item paints the objects of its group itself.
+     */
+    bool isLightweight() const
+    { return mRenderer != 0; }
+
+    /**
+     * Switches to lightweight mode when a \a renderer is given, or back to
+     * only grouping the object items when it is 0.
+     */
+    void setRenderer(MapRenderer *renderer);
+
+    /**
+     * Sets whether a MapObjectItem exists for the given \a object, in which
+     * case this item will not paint it.
+     */
+    void setHasObjectItem(MapObject *object, bool hasItem);
+
+    /**
+     * Should be called when the given \a object was added or changed, in
+     * order to update the bounding rect and schedule a repaint.
+     */
+    void syncWithObject(const MapObject *object);
+
     // QGraphicsItem
     QRectF boundingRect() const;
     void paint(QPainter *painter,
@@ -51,6 +89,9 @@ public:
 
 private:
     ObjectGroup *mObjectGroup;
+    MapRenderer *mRenderer;
+    QRectF mBoundingRect;
+    QSet<MapObject*> mObjectsWithItem;
 };
 
 } // namespace Internal
@@ -488,13 +488,11 @@ void ObjectSelectionTool::updateSelection(const QPointF &pos,
     rect.setWidth(qMax(qreal(1), rect.width()));
     rect.setHeight(qMax(qreal(1), rect.height()));
 
-    QSet<MapObjectItem*> selectedItems;
+    QPainterPath path;
+    path.addRect(rect);
 
-    foreach (QGraphicsItem *item, mapScene()->items(rect)) {
-        MapObjectItem *mapObjectItem = dynamic_cast<MapObjectItem*>(item);
-        if (mapObjectItem)
-            selectedItems.insert(mapObjectItem);
-    }
+    QSet<MapObjectItem*> selectedItems =
+            mapScene()->objectItemsIntersecting(path).toSet();
 
     if (modifiers & (Qt::ControlModifier | Qt::ShiftModifier))
         selectedItems |= mapScene()->selectedObjectItems();
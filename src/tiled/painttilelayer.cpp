@@ -23,9 +23,9 @@
 #include "map.h"
 #include "mapdocument.h"
 #include "tilelayer.h"
-#include "tilepainter.h"
 
 #include <QCoreApplication>
+#include <QDataStream>
 
 using namespace Tiled;
 using namespace Tiled::Internal;
@@ -35,36 +35,40 @@ PaintTileLayer::PaintTileLayer(MapDocument *mapDocument,
                                int x,
                                int y,
                                const TileLayer *source):
+    CommandMemoryUsage(mapDocument->undoStorage()),
     mMapDocument(mapDocument),
     mTarget(target),
-    mSource(static_cast<TileLayer*>(source->clone())),
-    mX(x),
-    mY(y),
-    mPaintedRegion(x, y, source->width(), source->height()),
-    mMergeable(false)
+    mMergeable(false),
+    mSwapOffset(-1)
 {
-    mErased = mTarget->copy(mX - mTarget->x(),
-                            mY - mTarget->y(),
-                            mSource->width(), mSource->height());
+    recordChanges(x, y, source);
     setText(QCoreApplication::translate("Undo Commands", "Paint"));
 }
 
 PaintTileLayer::~PaintTileLayer()
 {
-    delete mSource;
-    delete mErased;
+    if (mSwapOffset != -1)
+        undoStorage()->release(mSwapOffset);
 }
 
 void PaintTileLayer::undo()
 {
-    TilePainter painter(mMapDocument, mTarget);
-    painter.setCells(mX, mY, mErased, mPaintedRegion);
+    swapIn();
+
+    for (int i = mRuns.size() - 1; i >= 0; --i)
+        applyRun(mRuns.at(i), mErasedCells);
+
+    mMapDocument->emitRegionChanged(mPaintedRegion);
 }
 
 void PaintTileLayer::redo()
 {
-    TilePainter painter(mMapDocument, mTarget);
-    painter.drawCells(mX, mY, mSource);
+    swapIn();
+
+    foreach (const Run &run, mRuns)
+        applyRun(run, mPaintedCells);
+
+    mMapDocument->emitRegionChanged(mPaintedRegion);
 }
 
 bool PaintTileLayer::mergeWith(const QUndoCommand *other)
@@ -75,33 +79,178 @@ bool PaintTileLayer::mergeWith(const QUndoCommand *other)
           o->mMergeable))
         return false;
 
-    const QRegion newRegion = o->mPaintedRegion.subtracted(mPaintedRegion);
-    const QRegion combinedRegion = mPaintedRegion.united(o->mPaintedRegion);
-    const QRect bounds = QRect(mX, mY, mSource->width(), mSource->height());
-    const QRect combinedBounds = combinedRegion.boundingRect();
+    if (!swapIn())
+        return false;
 
-    // Resize the erased tiles and source layers when necessary
-    if (bounds != combinedBounds) {
-        const QPoint shift = bounds.topLeft() - combinedBounds.topLeft();
-        mErased->resize(combinedBounds.size(), shift);
-        mSource->resize(combinedBounds.size(), shift);
+    // The other command was recorded after this one was applied, so when
+    // both changed a cell, undoing in reverse order restores the original
+    const int offset = mPaintedCells.size();
+    foreach (Run run, o->mRuns) {
+        run.offset += offset;
+        mRuns.append(run);
     }
 
-    mX = combinedBounds.left();
-    mY = combinedBounds.top();
-    mPaintedRegion = combinedRegion;
+    mErasedCells += o->mErasedCells;
+    mPaintedCells += o->mPaintedCells;
+    mPaintedRegion |= o->mPaintedRegion;
+
+    return true;
+}
+
+qint64 PaintTileLayer::memoryUsage() const
+{
+    return sizeof(PaintTileLayer) +
+            mRuns.capacity() * sizeof(Run) +
+            (mErasedCells.capacity() + mPaintedCells.capacity()) * sizeof(Cell) +
+            mPaintedRegion.memoryUsage();
+}
+
+void PaintTileLayer::swapOut()
+{
+    if (mSwapOffset != -1 || mRuns.isEmpty())
+        return;
+
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream << mRuns.size();
+    foreach (const Run &run, mRuns)
+        stream << run.x << run.y << run.length << run.offset;
+    stream << UndoStorage::cellsToData(mErasedCells)
+           << UndoStorage::cellsToData(mPaintedCells);
 
-    // Copy the painted tiles from the other command over
-    const QPoint pos = QPoint(o->mX, o->mY) - combinedBounds.topLeft();
-    mSource->merge(pos, o->mSource);
+    mSwapOffset = undoStorage()->store(data);
+    if (mSwapOffset == -1)
+        return;
+
+    // The painted region can be derived from the runs again
+    mRuns = QVector<Run>();
+    mErasedCells = QVector<Cell>();
+    mPaintedCells = QVector<Cell>();
+    mPaintedRegion = TileRegion();
+}
+
+/**
+ * Loads the runs and cells of this command when they were swapped out.
+ *
+ * Returns false when they could not be loaded, in which case the command no
+ * longer changes anything when undone or redone.
+ */
+bool PaintTileLayer::swapIn()
+{
+    markUsed();
+
+    if (mSwapOffset == -1)
+        return true;
+
+    QByteArray data;
+    const bool loaded = undoStorage()->load(mSwapOffset, &data);
+    undoStorage()->release(mSwapOffset);
+    mSwapOffset = -1;
+
+    if (!loaded)
+        return false;
+
+    QDataStream stream(data);
+    int runCount;
+    stream >> runCount;
+
+    QVector<Run> runs(qMax(runCount, 0));
+    for (int i = 0; i < runs.size(); ++i) {
+        Run &run = runs[i];
+        stream >> run.x >> run.y >> run.length >> run.offset;
+    }
 
-    // Copy the newly erased tiles from the other command over
-    foreach (const QRect &rect, newRegion.rects())
-        for (int y = rect.top(); y <= rect.bottom(); ++y)
-            for (int x = rect.left(); x <= rect.right(); ++x)
-                mErased->setCell(x - mX,
-                                 y - mY,
-                                 o->mErased->cellAt(x - o->mX, y - o->mY));
+    QByteArray erasedCells, paintedCells;
+    stream >> erasedCells >> paintedCells;
+    const QVector<Cell> erased = UndoStorage::cellsFromData(erasedCells);
+    const QVector<Cell> painted = UndoStorage::cellsFromData(paintedCells);
+
+    // Make sure every run refers to cells that were actually loaded
+    bool valid = stream.status() == QDataStream::Ok &&
+            erased.size() == painted.size();
+    foreach (const Run &run, runs) {
+        if (run.length < 0 || run.offset < 0 ||
+                run.offset + run.length > painted.size())
+            valid = false;
+    }
+
+    if (!valid) {
+        reportLoadFailure();
+        return false;
+    }
+
+    mRuns = runs;
+    mErasedCells = erased;
+    mPaintedCells = painted;
+    foreach (const Run &run, mRuns)
+        mPaintedRegion.add(QRect(run.x, run.y, run.length, 1));
 
     return true;
 }
+
+/**
+ * Records the cells that will change when painting \a source at the given
+ * position. Empty cells in the source are not painted, and the painting is
+ * limited to the target layer and the tile selection.
+ */
+void PaintTileLayer::recordChanges(int x, int y, const TileLayer *source)
+{
+    TileRegion region(QRect(x, y, source->width(), source->height()));
+    region &= mTarget->bounds();
+
+    const QRegion &selection = mMapDocument->tileSelection();
+    if (!selection.isEmpty())
+        region &= TileRegion(selection);
+
+    const int targetX = mTarget->x();
+    const int targetY = mTarget->y();
+
+    foreach (const QRect &paintRun, region.runs()) {
+        const int _y = paintRun.y();
+        Run run = { 0, _y, 0, 0 };
+
+        for (int _x = paintRun.left(); _x <= paintRun.right() + 1; ++_x) {
+            bool changed = false;
+
+            if (_x <= paintRun.right()) {
+                const Cell &cell = source->cellAt(_x - x, _y - y);
+                const Cell &current = mTarget->cellAt(_x - targetX,
+                                                      _y - targetY);
+
+                changed = !cell.isEmpty() && cell != current;
+                if (changed) {
+                    if (run.length == 0) {
+                        run.x = _x;
+                        run.offset = mPaintedCells.size();
+                    }
+
+                    mErasedCells.append(current);
+                    mPaintedCells.append(cell);
+                    ++run.length;
+                }
+            }
+
+            if (!changed && run.length > 0) {
+                mRuns.append(run);
+                mPaintedRegion.add(QRect(run.x, run.y, run.length, 1));
+                run.length = 0;
+            }
+        }
+    }
+
+    mErasedCells.squeeze();
+    mPaintedCells.squeeze();
+}
+
+void PaintTileLayer::applyRun(const Run &run, const QVector<Cell> &cells)
+{
+    const int y = run.y - mTarget->y();
+
+    for (int i = 0; i < run.length; ++i) {
+        const int x = run.x + i - mTarget->x();
+
+        // The layer may have been resized since
+        if (mTarget->contains(x, y))
+            mTarget->setCell(x, y, cells.at(run.offset + i));
+    }
+}
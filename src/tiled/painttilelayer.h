@@ -21,23 +21,29 @@
 #ifndef PAINTTILELAYER_H
 #define PAINTTILELAYER_H
 
+#include "tilelayer.h"
+#include "tileregion.h"
 #include "undocommands.h"
+#include "undostorage.h"
 
-#include <QRegion>
 #include <QUndoCommand>
+#include <QVector>
 
 namespace Tiled {
 
-class TileLayer;
-
 namespace Internal {
 
 class MapDocument;
 
 /**
  * A command that paints one tile layer on top of another tile layer.
+ *
+ * Only the cells that are actually changed are stored, as runs of cells
+ * along with their previous contents. Merging another paint command simply
+ * appends its runs, which are applied in order on redo and in reverse order
+ * on undo.
  */
-class PaintTileLayer : public QUndoCommand
+class PaintTileLayer : public QUndoCommand, public CommandMemoryUsage
 {
 public:
     /**
@@ -68,14 +74,35 @@ public:
     int id() const { return Cmd_PaintTileLayer; }
     bool mergeWith(const QUndoCommand *other);
 
+    qint64 memoryUsage() const;
+    void swapOut();
+    bool isSwappedOut() const { return mSwapOffset != -1; }
+
 private:
+    /**
+     * A horizontal run of changed cells, in map coordinates. The cells of
+     * the run are stored in mErasedCells and mPaintedCells, at \a offset.
+     */
+    struct Run
+    {
+        int x;
+        int y;
+        int length;
+        int offset;
+    };
+
+    void recordChanges(int x, int y, const TileLayer *source);
+    void applyRun(const Run &run, const QVector<Cell> &cells);
+    bool swapIn();
+
     MapDocument *mMapDocument;
     TileLayer *mTarget;
-    TileLayer *mSource;
-    TileLayer *mErased;
-    int mX, mY;
-    QRegion mPaintedRegion;
+    QVector<Run> mRuns;
+    QVector<Cell> mErasedCells;
+    QVector<Cell> mPaintedCells;
+    TileRegion mPaintedRegion;
     bool mMergeable;
+    qint64 mSwapOffset;
 };
 
 } // namespace Internal
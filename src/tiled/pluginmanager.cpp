@@ -20,17 +20,32 @@
 
 #include "pluginmanager.h"
 
+#include "mapreaderinterface.h"
 #include "mapwriterinterface.h"
 
 #include <QApplication>
 #include <QDebug>
 #include <QDir>
 #include <QDirIterator>
+#include <QFileInfo>
 #include <QPluginLoader>
+#include <QRegExp>
+
+#if QT_VERSION >= 0x050000
+#include <QJsonArray>
+#include <QJsonObject>
+#endif
 
 using namespace Tiled;
 using namespace Tiled::Internal;
 
+bool Plugin::implements(const char *iid) const
+{
+    if (instance)
+        return instance->qt_metacast(iid) != 0;
+    return interfaces.contains(QLatin1String(iid));
+}
+
 PluginManager *PluginManager::mInstance = 0;
 
 PluginManager::PluginManager()
@@ -55,6 +70,16 @@ void PluginManager::deleteInstance()
     mInstance = 0;
 }
 
+#if QT_VERSION >= 0x050000
+static QStringList toStringList(const QJsonValue &value)
+{
+    QStringList strings;
+    foreach (const QJsonValue &item, value.toArray())
+        strings.append(item.toString());
+    return strings;
+}
+#endif
+
 void PluginManager::loadPlugins()
 {
     // Load static plugins
@@ -79,33 +104,155 @@ void PluginManager::loadPlugins()
             continue;
 
         QPluginLoader loader(pluginFile);
-        QObject *instance = loader.instance();
+        Plugin plugin(pluginFile, 0);
+
+#if QT_VERSION >= 0x050000
+        // Reading the metadata does not require loading the library
+        const QJsonObject metaData =
+                loader.metaData().value(QLatin1String("MetaData")).toObject();
+
+        plugin.interfaces =
+                toStringList(metaData.value(QLatin1String("Interfaces")));
+        plugin.nameFilters =
+                toStringList(metaData.value(QLatin1String("NameFilters")));
+        plugin.translationContext =
+                metaData.value(QLatin1String("TranslationContext")).toString();
+#endif
+
+        // Plugins that don't describe themselves are loaded right away
+        if (plugin.interfaces.isEmpty()) {
+            plugin.instance = loader.instance();
+
+            if (!plugin.instance) {
+                qWarning() << "Error:" << qPrintable(loader.errorString());
+                continue;
+            }
+        }
+
+        mPlugins.append(plugin);
+    }
+}
+
+QObject *PluginManager::load(const Plugin &plugin)
+{
+    if (plugin.instance)
+        return plugin.instance;
+
+    // The plugin may be a copy, for example when iterating over plugins(),
+    // so it is looked up by its file name
+    for (int i = 0; i < mPlugins.size(); ++i)
+        if (mPlugins.at(i).fileName == plugin.fileName)
+            return load(i);
+
+    return 0;
+}
+
+QObject *PluginManager::load(int index)
+{
+    Plugin &plugin = mPlugins[index];
+    if (plugin.instance)
+        return plugin.instance;
+
+    // Plugins that fail to load no longer claim to implement anything, so
+    // that no further attempts are made to load them
+    if (plugin.interfaces.isEmpty())
+        return 0;
+
+    QPluginLoader loader(plugin.fileName);
+    plugin.instance = loader.instance();
 
-        if (!instance) {
-            qWarning() << "Error:" << qPrintable(loader.errorString());
+    if (!plugin.instance) {
+        qWarning() << "Error:" << qPrintable(loader.errorString());
+        plugin.interfaces.clear();
+        plugin.nameFilters.clear();
+        return 0;
+    }
+
+    emit pluginLoaded(plugin.instance);
+    return plugin.instance;
+}
+
+QStringList PluginManager::translatedNameFilters(const Plugin &plugin)
+{
+    const QByteArray context = plugin.translationContext.toLatin1();
+
+    QStringList filters;
+    foreach (const QString &filter, plugin.nameFilters) {
+        filters.append(QCoreApplication::translate(context.constData(),
+                                                   filter.toUtf8().constData()));
+    }
+    return filters;
+}
+
+/**
+ * Returns whether any of the patterns in the given name \a filters, like
+ * "Json files (*.json)", matches the given \a fileName.
+ */
+static bool matchesNameFilters(const QStringList &filters,
+                               const QString &fileName)
+{
+    QRegExp patternFinder(QLatin1String("\\(([^\\)]*)\\)"));
+
+    foreach (const QString &filter, filters) {
+        if (patternFinder.indexIn(filter) == -1)
             continue;
+
+        const QStringList patterns =
+                patternFinder.cap(1).split(QLatin1Char(' '),
+                                           QString::SkipEmptyParts);
+        foreach (const QString &pattern, patterns) {
+            QRegExp wildcard(pattern, Qt::CaseInsensitive, QRegExp::Wildcard);
+            if (wildcard.exactMatch(fileName))
+                return true;
         }
+    }
 
-        mPlugins.append(Plugin(pluginFile, instance));
+    return false;
+}
+
+MapReaderInterface *PluginManager::readerForFile(const QString &fileName)
+{
+    const char *iid = qobject_interface_iid<MapReaderInterface*>();
+    const QString baseName = QFileInfo(fileName).fileName();
+
+    for (int i = 0; i < mPlugins.size(); ++i) {
+        const Plugin &plugin = mPlugins.at(i);
+        if (!plugin.implements(iid))
+            continue;
+
+        // Avoid loading plugins that are known not to support the file
+        if (!plugin.instance && !plugin.nameFilters.isEmpty()
+                && !matchesNameFilters(plugin.nameFilters, baseName))
+            continue;
+
+        MapReaderInterface *reader = qobject_cast<MapReaderInterface*>(load(i));
+        if (reader && reader->supportsFile(fileName))
+            return reader;
     }
+
+    return 0;
 }
 
-const Plugin *PluginManager::pluginByFileName(const QString &pluginFileName) const
+const Plugin *PluginManager::pluginByFileName(const QString &pluginFileName)
 {
-    foreach (const Plugin &plugin, mPlugins)
-        if (pluginFileName == plugin.fileName)
-            return &plugin;
+    for (int i = 0; i < mPlugins.size(); ++i) {
+        if (pluginFileName == mPlugins.at(i).fileName) {
+            load(i);
+            return &mPlugins.at(i);
+        }
+    }
 
     return 0;
 }
 
-const Plugin *PluginManager::pluginByNameFilter(const QString &pluginFilter) const
+const Plugin *PluginManager::pluginByNameFilter(const QString &pluginFilter)
 {
-    foreach (const Plugin &plugin, mPlugins) {
-        MapWriterInterface *writer =
-                qobject_cast<MapWriterInterface*>(plugin.instance);
+    const char *iid = qobject_interface_iid<MapWriterInterface*>();
 
-        if (writer && writer->nameFilters().contains(pluginFilter))
+    for (int i = 0; i < mPlugins.size(); ++i) {
+        const Plugin &plugin = mPlugins.at(i);
+        if (plugin.implements(iid)
+                && nameFilters<MapWriterInterface>(plugin).contains(pluginFilter))
             return &plugin;
     }
 
@@ -24,12 +24,20 @@
 #include <QList>
 #include <QObject>
 #include <QString>
+#include <QStringList>
 
 namespace Tiled {
+
+class MapReaderInterface;
+
 namespace Internal {
 
 /**
- * A loaded plugin.
+ * A plugin, which may not have been loaded yet.
+ *
+ * Plugins can describe the interfaces they implement and the name filters of
+ * the formats they support in their plugin.json metadata. Such plugins are
+ * only loaded once they are actually needed.
  */
 struct Plugin
 {
@@ -38,15 +46,27 @@ struct Plugin
         , instance(instance)
     {}
 
+    /**
+     * Returns whether this plugin implements the interface with the given
+     * \a iid. As long as the plugin is not loaded, this is determined by its
+     * metadata.
+     */
+    bool implements(const char *iid) const;
+
     QString fileName;
-    QObject *instance;
+    QObject *instance;              /**< 0 while the plugin is not loaded */
+    QStringList interfaces;         /**< Interface IIDs from the metadata */
+    QStringList nameFilters;        /**< Name filters from the metadata */
+    QString translationContext;     /**< Context for the name filters */
 };
 
 /**
  * The plugin manager loads the plugins and provides ways to access them.
  */
-class PluginManager
+class PluginManager : public QObject
 {
+    Q_OBJECT
+
 public:
     /**
      * Returns the plugin manager instance.
@@ -56,7 +76,9 @@ public:
     static void deleteInstance();
 
     /**
-     * Scans the plugin directory for plugins and attempts to load them.
+     * Scans the plugin directory for plugins. Plugins that describe the
+     * interfaces they implement in their metadata are only loaded when they
+     * are needed, the others are loaded right away.
      */
     void loadPlugins();
 
@@ -66,9 +88,30 @@ public:
     const QList<Plugin> &plugins() const { return mPlugins; }
 
     /**
-     * Returns the list of plugins that implement a given interface.
+     * Loads the given \a plugin when it was not loaded yet.
+     *
+     * @return the instance of the plugin, or 0 when it failed to load
      */
-    template<typename T> QList<T*> interfaces() const
+    QObject *load(const Plugin &plugin);
+
+    /**
+     * Returns the list of plugins that implement a given interface. Any of
+     * these plugins that were not loaded yet are loaded.
+     */
+    template<typename T> QList<T*> interfaces()
+    {
+        QList<T*> results;
+        for (int i = 0; i < mPlugins.size(); ++i)
+            if (mPlugins.at(i).implements(qobject_interface_iid<T*>()))
+                if (T *result = qobject_cast<T*>(load(i)))
+                    results.append(result);
+        return results;
+    }
+
+    /**
+     * Returns the list of loaded plugins that implement a given interface.
+     */
+    template<typename T> QList<T*> loadedInterfaces() const
     {
         QList<T*> results;
         foreach (const Plugin &plugin, mPlugins)
@@ -77,9 +120,80 @@ public:
         return results;
     }
 
-    const Plugin *pluginByFileName(const QString &pluginFileName) const;
+    /**
+     * Returns the name filters of the given interface for the given
+     * \a plugin. The plugin is only loaded when its metadata does not
+     * specify its name filters.
+     */
+    template<typename T> QStringList nameFilters(const Plugin &plugin)
+    {
+        if (!plugin.instance && !plugin.nameFilters.isEmpty())
+            return translatedNameFilters(plugin);
+        if (T *result = qobject_cast<T*>(load(plugin)))
+            return result->nameFilters();
+        return QStringList();
+    }
+
+    /**
+     * Returns the name filters of all plugins implementing the given
+     * interface, loading only the plugins that need to be asked.
+     */
+    template<typename T> QStringList nameFilters()
+    {
+        QStringList filters;
+        for (int i = 0; i < mPlugins.size(); ++i)
+            if (mPlugins.at(i).implements(qobject_interface_iid<T*>()))
+                filters.append(nameFilters<T>(mPlugins.at(i)));
+        return filters;
+    }
+
+    /**
+     * Returns the name filters of all plugins implementing the given
+     * interface that are known without loading any plugins.
+     */
+    template<typename T> QStringList availableNameFilters() const
+    {
+        QStringList filters;
+        foreach (const Plugin &plugin, mPlugins) {
+            if (T *result = qobject_cast<T*>(plugin.instance))
+                filters.append(result->nameFilters());
+            else if (!plugin.instance
+                     && plugin.implements(qobject_interface_iid<T*>()))
+                filters.append(translatedNameFilters(plugin));
+        }
+        return filters;
+    }
 
-    const Plugin *pluginByNameFilter(const QString &pluginFilter) const;
+    /**
+     * Returns the plugin implementing the given interface that provides
+     * the given name \a filter, loading it when necessary.
+     */
+    template<typename T> T *interfaceForNameFilter(const QString &filter)
+    {
+        for (int i = 0; i < mPlugins.size(); ++i)
+            if (mPlugins.at(i).implements(qobject_interface_iid<T*>()))
+                if (nameFilters<T>(mPlugins.at(i)).contains(filter))
+                    return qobject_cast<T*>(load(i));
+        return 0;
+    }
+
+    /**
+     * Returns a map reader that supports the given file. Only the plugins of
+     * which the name filters match the file, or of which the name filters
+     * are unknown, are loaded to ask them.
+     */
+    MapReaderInterface *readerForFile(const QString &fileName);
+
+    /**
+     * Returns the plugin with the given file name, loading it when
+     * necessary.
+     */
+    const Plugin *pluginByFileName(const QString &pluginFileName);
+
+    /**
+     * Returns the plugin of which the map writer has the given name filter.
+     */
+    const Plugin *pluginByNameFilter(const QString &pluginFilter);
 
     /**
      * Returns the plugin, which implements the given interface.
@@ -95,12 +209,21 @@ public:
         return 0;
     }
 
+signals:
+    /**
+     * Emitted when a plugin has been loaded.
+     */
+    void pluginLoaded(QObject *instance);
+
 private:
     Q_DISABLE_COPY(PluginManager)
 
     PluginManager();
     ~PluginManager();
 
+    QObject *load(int index);
+    static QStringList translatedNameFilters(const Plugin &plugin);
+
     static PluginManager *mInstance;
 
     QList<Plugin> mPlugins;
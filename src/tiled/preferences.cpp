@@ -21,6 +21,7 @@
 #include "preferences.h"
 
 #include "documentmanager.h"
+#include "imagecache.h"
 #include "languagemanager.h"
 #include "tilesetmanager.h"
 
@@ -38,6 +39,21 @@ using namespace Tiled::Internal;
 
 Preferences *Preferences::mInstance = 0;
 
+/**
+ * Returns the directory in which decoded tileset images are cached.
+ */
+static QString imageCacheLocation()
+{
+#if QT_VERSION >= 0x050000
+    const QString path = QStandardPaths::writableLocation(
+                QStandardPaths::CacheLocation);
+#else
+    const QString path = QDesktopServices::storageLocation(
+                QDesktopServices::CacheLocation);
+#endif
+    return path + QLatin1String("/images");
+}
+
 Preferences *Preferences::instance()
 {
     if (!mInstance)
@@ -61,6 +77,9 @@ Preferences::Preferences()
                                         Map::Base64Zlib).toInt();
     mDtdEnabled = boolValue("DtdEnabled");
     mReloadTilesetsOnChange = boolValue("ReloadTilesets", true);
+    mUndoMemoryBudget = intValue("UndoMemoryBudget", 256);
+    mCacheTilesetImages = boolValue("CacheTilesetImages");
+    mImageCacheSizeLimit = intValue("ImageCacheSizeLimit", 512);
     mSettings->endGroup();
 
     // Retrieve interface settings
@@ -100,6 +119,11 @@ Preferences::Preferences()
 
     TilesetManager *tilesetManager = TilesetManager::instance();
     tilesetManager->setReloadTilesetsOnChange(mReloadTilesetsOnChange);
+
+    ImageCache::setDiskCacheSizeLimit(qint64(mImageCacheSizeLimit)
+                                      * 1024 * 1024);
+    if (mCacheTilesetImages)
+        ImageCache::setDiskCacheDirectory(imageCacheLocation());
 }
 
 Preferences::~Preferences()
@@ -260,6 +284,53 @@ void Preferences::setReloadTilesetsOnChanged(bool value)
     tilesetManager->setReloadTilesetsOnChange(mReloadTilesetsOnChange);
 }
 
+/**
+ * Sets the amount of memory in megabytes the undo history of each map may
+ * use before older commands are moved to disk. 0 means no limit.
+ */
+void Preferences::setUndoMemoryBudget(int megabytes)
+{
+    if (mUndoMemoryBudget == megabytes)
+        return;
+
+    mUndoMemoryBudget = megabytes;
+    mSettings->setValue(QLatin1String("Storage/UndoMemoryBudget"),
+                        mUndoMemoryBudget);
+}
+
+/**
+ * Sets whether decoded tileset images are stored on disk, so that they load
+ * faster the next time.
+ */
+void Preferences::setCacheTilesetImages(bool enabled)
+{
+    if (mCacheTilesetImages == enabled)
+        return;
+
+    mCacheTilesetImages = enabled;
+    mSettings->setValue(QLatin1String("Storage/CacheTilesetImages"),
+                        mCacheTilesetImages);
+
+    ImageCache::setDiskCacheDirectory(enabled ? imageCacheLocation()
+                                              : QString());
+}
+
+/**
+ * Sets the amount of disk space in megabytes the cached tileset images may
+ * use. The least recently used images are removed when it is exceeded.
+ */
+void Preferences::setImageCacheSizeLimit(int megabytes)
+{
+    if (mImageCacheSizeLimit == megabytes)
+        return;
+
+    mImageCacheSizeLimit = megabytes;
+    mSettings->setValue(QLatin1String("Storage/ImageCacheSizeLimit"),
+                        mImageCacheSizeLimit);
+
+    ImageCache::setDiskCacheSizeLimit(qint64(megabytes) * 1024 * 1024);
+}
+
 void Preferences::setUseOpenGL(bool useOpenGL)
 {
     if (mUseOpenGL == useOpenGL)
@@ -67,6 +67,15 @@ public:
     bool reloadTilesetsOnChange() const;
     void setReloadTilesetsOnChanged(bool value);
 
+    int undoMemoryBudget() const { return mUndoMemoryBudget; }
+    void setUndoMemoryBudget(int megabytes);
+
+    bool cacheTilesetImages() const { return mCacheTilesetImages; }
+    void setCacheTilesetImages(bool enabled);
+
+    int imageCacheSizeLimit() const { return mImageCacheSizeLimit; }
+    void setImageCacheSizeLimit(int megabytes);
+
     bool useOpenGL() const { return mUseOpenGL; }
     void setUseOpenGL(bool useOpenGL);
 
@@ -148,6 +157,9 @@ private:
     bool mDtdEnabled;
     QString mLanguage;
     bool mReloadTilesetsOnChange;
+    int mUndoMemoryBudget;
+    bool mCacheTilesetImages;
+    int mImageCacheSizeLimit;
     bool mUseOpenGL;
     ObjectTypes mObjectTypes;
 
@@ -303,6 +303,9 @@ void PreferencesDialog::fromPreferences()
     const Preferences *prefs = Preferences::instance();
     mUi->reloadTilesetImages->setChecked(prefs->reloadTilesetsOnChange());
     mUi->enableDtd->setChecked(prefs->dtdEnabled());
+    mUi->undoMemoryBudget->setValue(prefs->undoMemoryBudget());
+    mUi->cacheTilesetImages->setChecked(prefs->cacheTilesetImages());
+    mUi->imageCacheSizeLimit->setValue(prefs->imageCacheSizeLimit());
     if (mUi->openGL->isEnabled())
         mUi->openGL->setChecked(prefs->useOpenGL());
 
@@ -324,6 +327,9 @@ void PreferencesDialog::toPreferences()
 
     prefs->setReloadTilesetsOnChanged(mUi->reloadTilesetImages->isChecked());
     prefs->setDtdEnabled(mUi->enableDtd->isChecked());
+    prefs->setUndoMemoryBudget(mUi->undoMemoryBudget->value());
+    prefs->setCacheTilesetImages(mUi->cacheTilesetImages->isChecked());
+    prefs->setImageCacheSizeLimit(mUi->imageCacheSizeLimit->value());
     prefs->setAutomappingDrawing(mUi->autoMapWhileDrawing->isChecked());
 }
 
@@ -745,9 +745,10 @@ void PropertyBrowser::updateCustomProperties()
     qDeleteAll(mNameToProperty);
     mNameToProperty.clear();
 
-    QMapIterator<QString,QString> it(mObject->properties());
-    while (it.hasNext()) {
-        it.next();
+    const Properties &properties = mObject->properties();
+    Properties::const_iterator it = properties.constBegin();
+    Properties::const_iterator it_end = properties.constEnd();
+    for (; it != it_end; ++it) {
         QtVariantProperty *property = createProperty(CustomProperty,
                                                      QVariant::String,
                                                      it.key(),
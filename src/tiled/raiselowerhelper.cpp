@@ -223,16 +223,13 @@ bool RaiseLowerHelper::initContext()
     }
 
     // The list of related items are all items from the same object group
-    // that share space with the selected items.
-    QList<QGraphicsItem*> items = mMapScene->items(shape,
-                                                   Qt::IntersectsItemShape,
-                                                   Qt::AscendingOrder);
-
-    foreach (QGraphicsItem *item, items) {
-        if (MapObjectItem *mapObjectItem = dynamic_cast<MapObjectItem*>(item)) {
-            if (mapObjectItem->mapObject()->objectGroup() == mObjectGroup)
-                mRelatedObjects.append(mapObjectItem);
-        }
+    // that share space with the selected items, in ascending stacking order.
+    const QList<MapObjectItem*> items = mMapScene->objectItemsIntersecting(shape);
+
+    for (int i = items.size() - 1; i >= 0; --i) {
+        MapObjectItem *mapObjectItem = items.at(i);
+        if (mapObjectItem->mapObject()->objectGroup() == mObjectGroup)
+            mRelatedObjects.append(mapObjectItem);
     }
 
     foreach (MapObjectItem *item, selectedItems) {
@@ -36,9 +36,12 @@ ResizeLayer::ResizeLayer(MapDocument *mapDocument,
                          const QPoint &offset)
     : QUndoCommand(QCoreApplication::translate("Undo Commands",
                                                "Resize Layer"))
+    , CommandMemoryUsage(mapDocument->undoStorage())
     , mMapDocument(mapDocument)
     , mIndex(index)
     , mOriginalLayer(0)
+    , mSwapOffset(-1)
+    , mLoadFailed(false)
 {
     // Create the resized layer (once)
     Layer *layer = mMapDocument->map()->layerAt(mIndex);
@@ -48,12 +51,18 @@ ResizeLayer::ResizeLayer(MapDocument *mapDocument,
 
 ResizeLayer::~ResizeLayer()
 {
+    if (mSwapOffset != -1)
+        undoStorage()->release(mSwapOffset);
+
     delete mOriginalLayer;
     delete mResizedLayer;
 }
 
 void ResizeLayer::undo()
 {
+    if (!swapIn())
+        return;
+
     Q_ASSERT(!mResizedLayer);
     mResizedLayer = swapLayer(mOriginalLayer);
     mOriginalLayer = 0;
@@ -61,11 +70,54 @@ void ResizeLayer::undo()
 
 void ResizeLayer::redo()
 {
+    if (!swapIn())
+        return;
+
     Q_ASSERT(!mOriginalLayer);
     mOriginalLayer = swapLayer(mResizedLayer);
     mResizedLayer = 0;
 }
 
+qint64 ResizeLayer::memoryUsage() const
+{
+    if (mSwapOffset != -1)
+        return sizeof(ResizeLayer);
+
+    return sizeof(ResizeLayer) +
+            UndoStorage::layerMemoryUsage(mOriginalLayer) +
+            UndoStorage::layerMemoryUsage(mResizedLayer);
+}
+
+void ResizeLayer::swapOut()
+{
+    if (mSwapOffset == -1) {
+        Layer *layer = mOriginalLayer ? mOriginalLayer : mResizedLayer;
+        mSwapOffset = undoStorage()->storeLayer(layer);
+    }
+}
+
+/**
+ * Loads the cells of the layer that is not part of the map when they were
+ * swapped out. Returns false when they could not be loaded, in which case
+ * the layers are not swapped, now or on any later undo or redo.
+ */
+bool ResizeLayer::swapIn()
+{
+    markUsed();
+
+    if (mLoadFailed)
+        return false;
+    if (mSwapOffset == -1)
+        return true;
+
+    Layer *layer = mOriginalLayer ? mOriginalLayer : mResizedLayer;
+    mLoadFailed = !undoStorage()->loadLayer(layer, mSwapOffset);
+    undoStorage()->release(mSwapOffset);
+    mSwapOffset = -1;
+
+    return !mLoadFailed;
+}
+
 Layer *ResizeLayer::swapLayer(Layer *layer)
 {
     const int currentIndex = mMapDocument->currentLayerIndex();
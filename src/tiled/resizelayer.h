@@ -21,6 +21,8 @@
 #ifndef RESIZELAYER_H
 #define RESIZELAYER_H
 
+#include "undostorage.h"
+
 #include <QPoint>
 #include <QSize>
 #include <QUndoCommand>
@@ -36,7 +38,7 @@ class MapDocument;
 /**
  * Undo command that resizes a map layer.
  */
-class ResizeLayer : public QUndoCommand
+class ResizeLayer : public QUndoCommand, public CommandMemoryUsage
 {
 public:
     /**
@@ -53,13 +55,20 @@ public:
     void undo();
     void redo();
 
+    qint64 memoryUsage() const;
+    void swapOut();
+    bool isSwappedOut() const { return mSwapOffset != -1; }
+
 private:
+    bool swapIn();
     Layer *swapLayer(Layer *layer);
 
     MapDocument *mMapDocument;
     int mIndex;
     Layer *mOriginalLayer;
     Layer *mResizedLayer;
+    qint64 mSwapOffset;
+    bool mLoadFailed;
 };
 
 } // namespace Internal
@@ -35,7 +35,6 @@
 
 #include <math.h>
 #include <QVector>
-#include <climits>
 
 using namespace Tiled;
 using namespace Tiled::Internal;
@@ -53,6 +52,8 @@ TerrainBrush::TerrainBrush(QObject *parent)
     , mBrushBehavior(Free)
     , mLineReferenceX(0)
     , mLineReferenceY(0)
+    , mQueueHead(0)
+    , mQueueSize(0)
 {
     setBrushMode(PaintTile);
 }
@@ -71,6 +72,7 @@ void TerrainBrush::deactivate(MapScene *scene)
 {
     AbstractTileTool::deactivate(scene);
     mIsActive = false;
+    releaseBuffers();
 }
 
 void TerrainBrush::tilePositionChanged(const QPoint &pos)
@@ -265,34 +267,7 @@ static Tile *findBestTile(Tileset *tileset, unsigned terrain, unsigned considera
     if (terrain == 0xFFFFFFFF)
         return NULL;
 
-    QList<Tile*> matches;
-    int penalty = INT_MAX;
-
-    // TODO: this is a slow linear search, perhaps we could use a better find algorithm...
-    foreach (Tile *t, tileset->tiles()) {
-        if ((t->terrain() & considerationMask) != (terrain & considerationMask))
-            continue;
-
-        // calculate the tile transition penalty based on shortest distance to target terrain type
-        int tr = tileset->terrainTransitionPenalty(t->terrain() >> 24, terrain >> 24);
-        int tl = tileset->terrainTransitionPenalty((t->terrain() >> 16) & 0xFF, (terrain >> 16) & 0xFF);
-        int br = tileset->terrainTransitionPenalty((t->terrain() >> 8) & 0xFF, (terrain >> 8) & 0xFF);
-        int bl = tileset->terrainTransitionPenalty(t->terrain() & 0xFF, terrain & 0xFF);
-
-        // if there is no path to the destination terrain, this isn't a useful transition
-        if (tr < 0 || tl < 0 || br < 0 || bl < 0)
-            continue;
-
-        // add tile to the candidate list
-        int transitionPenalty = tr + tl + br + bl;
-        if (transitionPenalty <= penalty) {
-            if (transitionPenalty < penalty)
-                matches.clear();
-            penalty = transitionPenalty;
-
-            matches.push_back(t);
-        }
-    }
+    const QList<Tile*> matches = tileset->findTerrainMatches(terrain, considerationMask);
 
     // choose a candidate at random, with consideration for terrain probability
     if (!matches.isEmpty()) {
@@ -361,7 +336,6 @@ void TerrainBrush::updateBrush(QPoint cursorPos, const QVector<QPoint> *list)
 
     int layerWidth = currentLayer->width();
     int layerHeight = currentLayer->height();
-    int numTiles = layerWidth * layerHeight;
     int paintCorner = 0;
 
     // if we are in vertex paint mode, the bottom right corner on the map will appear as an invalid tile offset...
@@ -387,40 +361,40 @@ void TerrainBrush::updateBrush(QPoint cursorPos, const QVector<QPoint> *list)
         terrainId = mTerrain->id();
     }
 
-    // allocate a buffer to build the terrain tilemap (TODO: this could be retained per layer to save regular allocation)
-    Tile **newTerrain = new Tile*[numTiles];
+    prepareBuffers();
 
-    // allocate a buffer of flags for each tile that may be considered (TODO: this could be retained per layer to save regular allocation)
-    char *checked = new char[numTiles];
-    memset(checked, 0, numTiles);
+    // the tiles that were added to the brush
+    QVector<QPoint> brushPoints;
 
-    // create a consideration list, and push the start points
-    QList<QPoint> transitionList;
+    // fill the consideration queue with the start points
     int initialTiles = 0;
 
     if (list) {
         // if we were supplied a list of start points
         foreach (const QPoint &p, *list) {
-            transitionList.append(p);
+            enqueue(p);
             ++initialTiles;
         }
     } else {
-        transitionList.append(cursorPos);
+        enqueue(cursorPos);
         initialTiles = 1;
     }
 
     QRect brushRect(cursorPos, cursorPos);
 
     // produce terrain with transitions using a simple, relative naive approach (considers each tile once, and doesn't allow re-consideration if selection was bad)
-    while (!transitionList.isEmpty()) {
-        // get the next point in the consideration list
-        QPoint p = transitionList.takeFirst();
+    while (mQueueSize > 0) {
+        // get the next point in the consideration queue
+        const QPoint p = mQueue.at(mQueueHead);
+        mQueueHead = (mQueueHead + 1) % mQueue.size();
+        --mQueueSize;
+
         int x = p.x(), y = p.y();
         int i = y*layerWidth + x;
 
         // if we have already considered this point, skip to the next
         // TODO: we might want to allow re-consideration if prior tiles... but not for now, this would risk infinite loops
-        if (checked[i])
+        if (mNewTerrain.contains(i))
             continue;
 
         const Tile *tile = currentLayer->cellAt(p).tile;
@@ -470,20 +444,20 @@ void TerrainBrush::updateBrush(QPoint cursorPos, const QVector<QPoint> *list)
             mask = 0;
 
             // depending which connections have been set, we update the preferred terrain of the tile accordingly
-            if (y > 0 && checked[i - layerWidth]) {
-                preferredTerrain = (::terrain(newTerrain[i - layerWidth]) << 16) | (preferredTerrain & 0x0000FFFF);
+            if (y > 0 && mNewTerrain.contains(i - layerWidth)) {
+                preferredTerrain = (::terrain(mNewTerrain.value(i - layerWidth)) << 16) | (preferredTerrain & 0x0000FFFF);
                 mask |= 0xFFFF0000;
             }
-            if (y < layerHeight - 1 && checked[i + layerWidth]) {
-                preferredTerrain = (::terrain(newTerrain[i + layerWidth]) >> 16) | (preferredTerrain & 0xFFFF0000);
+            if (y < layerHeight - 1 && mNewTerrain.contains(i + layerWidth)) {
+                preferredTerrain = (::terrain(mNewTerrain.value(i + layerWidth)) >> 16) | (preferredTerrain & 0xFFFF0000);
                 mask |= 0x0000FFFF;
             }
-            if (x > 0 && checked[i - 1]) {
-                preferredTerrain = ((::terrain(newTerrain[i - 1]) << 8) & 0xFF00FF00) | (preferredTerrain & 0x00FF00FF);
+            if (x > 0 && mNewTerrain.contains(i - 1)) {
+                preferredTerrain = ((::terrain(mNewTerrain.value(i - 1)) << 8) & 0xFF00FF00) | (preferredTerrain & 0x00FF00FF);
                 mask |= 0xFF00FF00;
             }
-            if (x < layerWidth - 1 && checked[i + 1]) {
-                preferredTerrain = ((::terrain(newTerrain[i + 1]) >> 8) & 0x00FF00FF) | (preferredTerrain & 0xFF00FF00);
+            if (x < layerWidth - 1 && mNewTerrain.contains(i + 1)) {
+                preferredTerrain = ((::terrain(mNewTerrain.value(i + 1)) >> 8) & 0x00FF00FF) | (preferredTerrain & 0xFF00FF00);
                 mask |= 0x00FF00FF;
             }
         }
@@ -497,60 +471,51 @@ void TerrainBrush::updateBrush(QPoint cursorPos, const QVector<QPoint> *list)
         }
 
         // add tile to the brush
-        newTerrain[i] = paste;
-        checked[i] = true;
+        mNewTerrain.insert(i, paste);
+        brushPoints.append(p);
 
         // expand the brush rect to fit the edit set
         brushRect |= QRect(p, p);
 
         // consider surrounding tiles if terrain constraints were not satisfied
-        if (y > 0 && !checked[i - layerWidth]) {
+        if (y > 0 && !mNewTerrain.contains(i - layerWidth)) {
             const Tile *above = currentLayer->cellAt(x, y - 1).tile;
             if (topEdge(paste) != bottomEdge(above))
-                transitionList.append(QPoint(x, y - 1));
+                enqueue(QPoint(x, y - 1));
         }
-        if (y < layerHeight - 1 && !checked[i + layerWidth]) {
+        if (y < layerHeight - 1 && !mNewTerrain.contains(i + layerWidth)) {
             const Tile *below = currentLayer->cellAt(x, y + 1).tile;
             if (bottomEdge(paste) != topEdge(below))
-                transitionList.append(QPoint(x, y + 1));
+                enqueue(QPoint(x, y + 1));
         }
-        if (x > 0 && !checked[i - 1]) {
+        if (x > 0 && !mNewTerrain.contains(i - 1)) {
             const Tile *left = currentLayer->cellAt(x - 1, y).tile;
             if (leftEdge(paste) != rightEdge(left))
-                transitionList.append(QPoint(x - 1, y));
+                enqueue(QPoint(x - 1, y));
         }
-        if (x < layerWidth - 1 && !checked[i + 1]) {
+        if (x < layerWidth - 1 && !mNewTerrain.contains(i + 1)) {
             const Tile *right = currentLayer->cellAt(x + 1, y).tile;
             if (rightEdge(paste) != leftEdge(right))
-                transitionList.append(QPoint(x + 1, y));
+                enqueue(QPoint(x + 1, y));
         }
     }
 
     // create a stamp for the terrain block
     TileLayer *stamp = new TileLayer(QString(), 0, 0, brushRect.width(), brushRect.height());
 
-    for (int y = brushRect.top(); y <= brushRect.bottom(); ++y) {
-        for (int x = brushRect.left(); x <= brushRect.right(); ++x) {
-            int i = y*layerWidth + x;
-            if (!checked[i])
-                continue;
-
-            Tile *tile = newTerrain[i];
-            if (tile)
-                stamp->setCell(x - brushRect.left(), y - brushRect.top(), Cell(tile));
-            else {
-                // TODO: we need to do something to erase tiles where checked[i] is true, and newTerrain[i] is NULL
-                // is there an eraser stamp? investigate how the eraser works...
-            }
+    foreach (const QPoint &p, brushPoints) {
+        Tile *tile = mNewTerrain.value(p.y() * layerWidth + p.x());
+        if (tile)
+            stamp->setCell(p.x() - brushRect.left(), p.y() - brushRect.top(), Cell(tile));
+        else {
+            // TODO: we need to do something to erase tiles that were checked, but where newTerrain[i] is NULL
+            // is there an eraser stamp? investigate how the eraser works...
         }
     }
 
     // set the new tile layer as the brush
     brushItem()->setTileLayer(stamp);
 
-    delete[] checked;
-    delete[] newTerrain;
-
 /*
     const QPoint tilePos = tilePosition();
 
@@ -566,3 +531,35 @@ void TerrainBrush::updateBrush(QPoint cursorPos, const QVector<QPoint> *list)
     mOffsetX = cursorPos.x() - brushRect.left();
     mOffsetY = cursorPos.y() - brushRect.top();
 }
+
+void TerrainBrush::prepareBuffers()
+{
+    mNewTerrain.clear();
+
+    mQueueHead = 0;
+    mQueueSize = 0;
+}
+
+void TerrainBrush::releaseBuffers()
+{
+    mNewTerrain.clear();
+
+    mQueue.clear();
+    mQueueHead = 0;
+    mQueueSize = 0;
+}
+
+void TerrainBrush::enqueue(const QPoint &point)
+{
+    // grow the ring buffer when it is full, unwrapping its contents
+    if (mQueueSize == mQueue.size()) {
+        QVector<QPoint> queue(qMax(64, mQueue.size() * 2));
+        for (int i = 0; i < mQueueSize; ++i)
+            queue[i] = mQueue.at((mQueueHead + i) % mQueue.size());
+        mQueue = queue;
+        mQueueHead = 0;
+    }
+
+    mQueue[(mQueueHead + mQueueSize) % mQueue.size()] = point;
+    ++mQueueSize;
+}
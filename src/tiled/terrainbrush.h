@@ -26,6 +26,8 @@
 #include "abstracttiletool.h"
 #include "tilelayer.h"
 
+#include <QHash>
+
 namespace Tiled {
 
 class Tile;
@@ -114,6 +116,21 @@ private:
      */
     void updateBrush(QPoint cursorPos, const QVector<QPoint> *list = NULL);
 
+    /**
+     * Clears the buffers used by updateBrush for a new update.
+     */
+    void prepareBuffers();
+
+    /**
+     * Releases the buffers used by updateBrush.
+     */
+    void releaseBuffers();
+
+    /**
+     * Appends \a point to the ring buffer of tiles to consider.
+     */
+    void enqueue(const QPoint &point);
+
     /**
      * The terrain we are currently painting.
      */
@@ -148,6 +165,18 @@ private:
      * When drawing circles this will be the midpoint.
      */
     int mLineReferenceX, mLineReferenceY;
+
+    /**
+     * The new tile of each tile checked by updateBrush, by its index in the
+     * layer. Only the checked tiles are stored, so the memory used and the
+     * time needed to clear it depend on the affected area rather than on
+     * the size of the layer.
+     */
+    QHash<int, Tile*> mNewTerrain;
+
+    QVector<QPoint> mQueue;
+    int mQueueHead;
+    int mQueueSize;
 };
 
 } // namespace Internal
@@ -13,7 +13,7 @@ win32 {
 }
 
 greaterThan(QT_MAJOR_VERSION, 4) {
-    QT += widgets
+    QT += widgets concurrent
 }
 contains(QT_CONFIG, opengl): QT += opengl
 
@@ -147,6 +147,7 @@ SOURCES += aboutdialog.cpp \
     tmxmapwriter.cpp \
     toolmanager.cpp \
     undodock.cpp \
+    undostorage.cpp \
     utils.cpp \
     varianteditorfactory.cpp \
     variantpropertymanager.cpp \
@@ -263,6 +264,7 @@ HEADERS += aboutdialog.h \
     toolmanager.h \
     undocommands.h \
     undodock.h \
+    undostorage.h \
     utils.h \
     varianteditorfactory.h \
     variantpropertymanager.h \
@@ -25,12 +25,15 @@
 #include "tilelayer.h"
 #include "map.h"
 
+#include <cstring>
+
 using namespace Tiled;
 using namespace Tiled::Internal;
 
 TilePainter::TilePainter(MapDocument *mapDocument, TileLayer *tileLayer)
     : mMapDocument(mapDocument)
     , mTileLayer(tileLayer)
+    , mSelection(mapDocument->tileSelection())
 {
 }
 
@@ -47,8 +50,7 @@ Cell TilePainter::cellAt(int x, int y) const
 
 void TilePainter::setCell(int x, int y, const Cell &cell)
 {
-    const QRegion &selection = mMapDocument->tileSelection();
-    if (!(selection.isEmpty() || selection.contains(QPoint(x, y))))
+    if (!(mSelection.isEmpty() || mSelection.contains(x, y)))
         return;
 
     const int layerX = x - mTileLayer->x();
@@ -58,48 +60,49 @@ void TilePainter::setCell(int x, int y, const Cell &cell)
         return;
 
     mTileLayer->setCell(layerX, layerY, cell);
-    mMapDocument->emitRegionChanged(QRegion(x, y, 1, 1));
+    mMapDocument->emitRegionChanged(TileRegion(QRect(x, y, 1, 1)));
 }
 
 void TilePainter::setCells(int x, int y,
                            TileLayer *tileLayer,
                            const QRegion &mask)
 {
-    QRegion region = paintableRegion(x, y,
-                                     tileLayer->width(),
-                                     tileLayer->height());
+    TileRegion region = paintableRegion(x, y,
+                                        tileLayer->width(),
+                                        tileLayer->height());
     if (!mask.isEmpty())
-        region &= mask;
+        region &= TileRegion(mask);
     if (region.isEmpty())
         return;
 
+    const QRegion changed = region.toRegion();
+
     mTileLayer->setCells(x - mTileLayer->x(),
                          y - mTileLayer->y(),
                          tileLayer,
-                         region.translated(-mTileLayer->position()));
+                         changed.translated(-mTileLayer->position()));
 
     mMapDocument->emitRegionChanged(region);
 }
 
 void TilePainter::drawCells(int x, int y, TileLayer *tileLayer)
 {
-    const QRegion region = paintableRegion(x, y,
-                                           tileLayer->width(),
-                                           tileLayer->height());
+    const TileRegion region = paintableRegion(x, y,
+                                              tileLayer->width(),
+                                              tileLayer->height());
     if (region.isEmpty())
         return;
 
-    foreach (const QRect &rect, region.rects()) {
-        for (int _x = rect.left(); _x <= rect.right(); ++_x) {
-            for (int _y = rect.top(); _y <= rect.bottom(); ++_y) {
-                const Cell &cell = tileLayer->cellAt(_x - x, _y - y);
-                if (cell.isEmpty())
-                    continue;
+    foreach (const QRect &run, region.runs()) {
+        const int _y = run.y();
+        for (int _x = run.left(); _x <= run.right(); ++_x) {
+            const Cell &cell = tileLayer->cellAt(_x - x, _y - y);
+            if (cell.isEmpty())
+                continue;
 
-                mTileLayer->setCell(_x - mTileLayer->x(),
-                                    _y - mTileLayer->y(),
-                                    cell);
-            }
+            mTileLayer->setCell(_x - mTileLayer->x(),
+                                _y - mTileLayer->y(),
+                                cell);
         }
     }
 
@@ -107,13 +110,13 @@ void TilePainter::drawCells(int x, int y, TileLayer *tileLayer)
 }
 
 void TilePainter::drawStamp(const TileLayer *stamp,
-                            const QRegion &drawRegion)
+                            const TileRegion &drawRegion)
 {
     Q_ASSERT(stamp);
     if (stamp->bounds().isEmpty())
         return;
 
-    const QRegion region = paintableRegion(drawRegion);
+    const TileRegion region = paintableRegion(drawRegion);
     if (region.isEmpty())
         return;
 
@@ -121,19 +124,19 @@ void TilePainter::drawStamp(const TileLayer *stamp,
     const int h = stamp->height();
     const QRect regionBounds = region.boundingRect();
 
-    foreach (const QRect &rect, region.rects()) {
-        for (int _x = rect.left(); _x <= rect.right(); ++_x) {
-            for (int _y = rect.top(); _y <= rect.bottom(); ++_y) {
-                const int stampX = (_x - regionBounds.left()) % w;
-                const int stampY = (_y - regionBounds.top()) % h;
-                const Cell &cell = stamp->cellAt(stampX, stampY);
-                if (cell.isEmpty())
-                    continue;
-
-                mTileLayer->setCell(_x - mTileLayer->x(),
-                                    _y - mTileLayer->y(),
-                                    cell);
-            }
+    foreach (const QRect &run, region.runs()) {
+        const int _y = run.y();
+        const int stampY = (_y - regionBounds.top()) % h;
+
+        for (int _x = run.left(); _x <= run.right(); ++_x) {
+            const int stampX = (_x - regionBounds.left()) % w;
+            const Cell &cell = stamp->cellAt(stampX, stampY);
+            if (cell.isEmpty())
+                continue;
+
+            mTileLayer->setCell(_x - mTileLayer->x(),
+                                _y - mTileLayer->y(),
+                                cell);
         }
     }
 
@@ -142,18 +145,19 @@ void TilePainter::drawStamp(const TileLayer *stamp,
 
 void TilePainter::erase(const QRegion &region)
 {
-    const QRegion paintable = paintableRegion(region);
+    const TileRegion paintable = paintableRegion(TileRegion(region));
     if (paintable.isEmpty())
         return;
 
-    mTileLayer->erase(paintable.translated(-mTileLayer->position()));
+    const QRegion changed = paintable.toRegion();
+    mTileLayer->erase(changed.translated(-mTileLayer->position()));
     mMapDocument->emitRegionChanged(paintable);
 }
 
-QRegion TilePainter::computeFillRegion(const QPoint &fillOrigin) const
+TileRegion TilePainter::computeFillRegion(const QPoint &fillOrigin) const
 {
     // Create that region that will hold the fill
-    QRegion fillRegion;
+    TileRegion fillRegion;
 
     // Silently quit if parameters are unsatisfactory
     if (!isDrawable(fillOrigin.x(), fillOrigin.y()))
@@ -162,91 +166,80 @@ QRegion TilePainter::computeFillRegion(const QPoint &fillOrigin) const
     // Cache cell that we will match other cells against
     const Cell matchCell = cellAt(fillOrigin.x(), fillOrigin.y());
 
-    // Grab map dimensions for later use.
-    const int mapWidth = mMapDocument->map()->width();
-    const int mapHeight = mMapDocument->map()->height();
-    const int mapSize = mapWidth * mapHeight;
+    // The fill works on the raw cells of the layer, in layer coordinates
+    const int layerX = mTileLayer->x();
+    const int layerY = mTileLayer->y();
+    const int width = mTileLayer->width();
+    const int height = mTileLayer->height();
+    const Cell *cells = &mTileLayer->cellAt(0, 0);
+
+    // Marks the cells that may still be filled. Starts out as the selection,
+    // and filled cells are cleared so that they are not processed again.
+    QVector<quint8> openVec(width * height);
+    quint8 *open = openVec.data();
+
+    if (mSelection.isEmpty()) {
+        memset(open, 1, width * height);
+    } else {
+        const TileRegion selection =
+                mSelection.intersected(mTileLayer->bounds());
+
+        foreach (const QRect &run, selection.runs()) {
+            memset(&open[(run.y() - layerY) * width + run.left() - layerX],
+                   1,
+                   run.width());
+        }
+    }
+
+    // Stack of positions from which to fill a run of cells
+    QVector<QPoint> fillPositions;
+    fillPositions.append(QPoint(fillOrigin.x() - layerX,
+                                fillOrigin.y() - layerY));
 
-    // Create a queue to hold cells that need filling
-    QList<QPoint> fillPositions;
-    fillPositions.append(fillOrigin);
+    while (!fillPositions.isEmpty()) {
+        const QPoint currentPoint = fillPositions.last();
+        fillPositions.pop_back();
 
-    // Create an array that will store which cells have been processed
-    // This is faster than checking if a given cell is in the region/list
-    QVector<quint8> processedCellsVec(mapSize);
-    quint8 *processedCells = processedCellsVec.data();
+        const int y = currentPoint.y();
+        const int startOfLine = y * width;
 
-    // Loop through queued positions and fill them, while at the same time
-    // checking adjacent positions to see if they should be added
-    while (!fillPositions.empty()) {
-        const QPoint currentPoint = fillPositions.takeFirst();
-        const int startOfLine = currentPoint.y() * mapWidth;
+        // May have been filled since it was added
+        const int start = startOfLine + currentPoint.x();
+        if (!open[start] || cells[start] != matchCell)
+            continue;
 
-        // Seek as far left as we can
+        // Seek as far left and right as we can
         int left = currentPoint.x();
-        while (cellAt(left - 1, currentPoint.y()) == matchCell &&
-               isDrawable(left - 1, currentPoint.y()))
+        while (left > 0 && open[startOfLine + left - 1] &&
+               cells[startOfLine + left - 1] == matchCell)
             --left;
 
-        // Seek as far right as we can
         int right = currentPoint.x();
-        while (cellAt(right + 1, currentPoint.y()) == matchCell &&
-               isDrawable(right + 1, currentPoint.y()))
+        while (right < width - 1 && open[startOfLine + right + 1] &&
+               cells[startOfLine + right + 1] == matchCell)
             ++right;
 
-        // Add cells between left and right to the region
-        fillRegion += QRegion(left, currentPoint.y(), right - left + 1, 1);
-
-        // Add cell strip to processed cells
-        memset(&processedCells[startOfLine + left],
-               1,
-               right - left);
-
-        // These variables cache whether the last cell was added to the queue
-        // or not as an optimization, since adjacent cells on the x axis
-        // do not need to be added to the queue.
-        bool lastAboveCell = false;
-        bool lastBelowCell = false;
-
-        // Loop between left and right and check if cells above or
-        // below need to be added to the queue
-        for (int x = left; x <= right; ++x) {
-            const QPoint fillPoint(x, currentPoint.y());
-
-            // Check cell above
-            if (fillPoint.y() > 0) {
-                QPoint aboveCell(fillPoint.x(), fillPoint.y() - 1);
-                if (!processedCells[aboveCell.y()*mapWidth + aboveCell.x()] &&
-                    cellAt(aboveCell.x(), aboveCell.y()) == matchCell &&
-                    isDrawable(aboveCell.x(), aboveCell.y()))
-                {
-                    // Do not add the above cell to the queue if its
-                    // x-adjacent cell was added.
-                    if (!lastAboveCell)
-                        fillPositions.append(aboveCell);
-
-                    lastAboveCell = true;
-                } else lastAboveCell = false;
-
-                processedCells[aboveCell.y() * mapWidth + aboveCell.x()] = 1;
-            }
-
-            // Check cell below
-            if (fillPoint.y() + 1 < mapHeight) {
-                QPoint belowCell(fillPoint.x(), fillPoint.y() + 1);
-                if (!processedCells[belowCell.y()*mapWidth + belowCell.x()] &&
-                    cellAt(belowCell.x(), belowCell.y()) == matchCell &&
-                    isDrawable(belowCell.x(), belowCell.y()))
-                {
-                    // Do not add the below cell to the queue if its
-                    // x-adjacent cell was added.
-                    if (!lastBelowCell)
-                        fillPositions.append(belowCell);
-
-                    lastBelowCell = true;
-                } else lastBelowCell = false;
-
-                processedCells[belowCell.y() * mapWidth + belowCell.x()] = 1;
+        memset(&open[startOfLine + left], 0, right - left + 1);
+        fillRegion.add(QRect(left + layerX, y + layerY, right - left + 1, 1));
+
+        // Add a position for each run of matching cells above and below
+        for (int dy = -1; dy <= 1; dy += 2) {
+            const int adjacentY = y + dy;
+            if (adjacentY < 0 || adjacentY >= height)
+                continue;
+
+            const int adjacentLine = adjacentY * width;
+            bool inRun = false;
+
+            for (int x = left; x <= right; ++x) {
+                const int index = adjacentLine + x;
+                if (open[index] && cells[index] == matchCell) {
+                    if (!inRun)
+                        fillPositions.append(QPoint(x, adjacentY));
+                    inRun = true;
+                } else {
+                    inRun = false;
+                }
             }
         }
     }
@@ -256,8 +249,7 @@ QRegion TilePainter::computeFillRegion(const QPoint &fillOrigin) const
 
 bool TilePainter::isDrawable(int x, int y) const
 {
-    const QRegion &selection = mMapDocument->tileSelection();
-    if (!(selection.isEmpty() || selection.contains(QPoint(x, y))))
+    if (!(mSelection.isEmpty() || mSelection.contains(x, y)))
         return false;
 
     const int layerX = x - mTileLayer->x();
@@ -269,14 +261,12 @@ bool TilePainter::isDrawable(int x, int y) const
     return true;
 }
 
-QRegion TilePainter::paintableRegion(const QRegion &region) const
+TileRegion TilePainter::paintableRegion(const TileRegion &region) const
 {
-    const QRegion bounds = QRegion(mTileLayer->bounds());
-    QRegion intersection = bounds.intersected(region);
+    TileRegion intersection = region.intersected(mTileLayer->bounds());
 
-    const QRegion &selection = mMapDocument->tileSelection();
-    if (!selection.isEmpty())
-        intersection &= selection;
+    if (!mSelection.isEmpty())
+        intersection &= mSelection;
 
     return intersection;
 }
@@ -22,6 +22,8 @@
 #ifndef TILEPAINTER_H
 #define TILEPAINTER_H
 
+#include "tileregion.h"
+
 #include <QRegion>
 
 namespace Tiled {
@@ -39,7 +41,8 @@ class MapDocument;
  * redraw the changed parts.
  *
  * This class also does bounds checking and when there is a tile selection, it
- * will only draw within this selection.
+ * will only draw within this selection. The selection is looked up when the
+ * tile painter is constructed, so it should not be kept around.
  */
 class TilePainter
 {
@@ -87,7 +90,7 @@ public:
      * Draws the stamp within the given \a drawRegion region, repeating the
      * stamp as needed.
      */
-    void drawStamp(const TileLayer *stamp, const QRegion &drawRegion);
+    void drawStamp(const TileLayer *stamp, const TileRegion &drawRegion);
 
     /**
      * Erases the cells in the given region.
@@ -97,8 +100,10 @@ public:
     /**
      * Computes a fill region made up of all cells of the same type as that
      * at \a fillOrigin that are connected.
+     *
+     * The fill is limited to the tile layer and the tile selection.
      */
-    QRegion computeFillRegion(const QPoint &fillOrigin) const;
+    TileRegion computeFillRegion(const QPoint &fillOrigin) const;
 
     /**
      * Returns true if the given cell is drawable.
@@ -106,12 +111,13 @@ public:
     bool isDrawable(int x, int y) const;
 
 private:
-    QRegion paintableRegion(const QRegion &region) const;
-    QRegion paintableRegion(int x, int y, int width, int height) const
-    { return paintableRegion(QRect(x, y, width, height)); }
+    TileRegion paintableRegion(const TileRegion &region) const;
+    TileRegion paintableRegion(int x, int y, int width, int height) const
+    { return paintableRegion(TileRegion(QRect(x, y, width, height))); }
 
     MapDocument *mMapDocument;
     TileLayer *mTileLayer;
+    TileRegion mSelection;
 };
 
 } // namespace Tiled
@@ -315,6 +315,9 @@ TilesetDock::TilesetDock(QWidget *parent):
 
     connect(TilesetManager::instance(), SIGNAL(tilesetChanged(Tileset*)),
             this, SLOT(tilesetChanged(Tileset*)));
+    connect(TilesetManager::instance(),
+            SIGNAL(tileImagesChanged(Tileset*,QList<Tile*>)),
+            this, SLOT(tileImagesChanged(Tileset*,QList<Tile*>)));
 
     connect(DocumentManager::instance(), SIGNAL(documentCloseRequested(int)),
             SLOT(documentCloseRequested(int)));
@@ -563,6 +566,17 @@ void TilesetDock::tilesetChanged(Tileset *tileset)
         model->tilesetChanged();
 }
 
+void TilesetDock::tileImagesChanged(Tileset *tileset,
+                                    const QList<Tile*> &tiles)
+{
+    const int index = mTilesets.indexOf(tileset);
+    if (index < 0)
+        return;
+
+    if (TilesetModel *model = tilesetViewAt(index)->tilesetModel())
+        model->tilesChanged(tiles);
+}
+
 void TilesetDock::tilesetRemoved(Tileset *tileset)
 {
     // Delete the related tileset view
@@ -108,6 +108,7 @@ private slots:
 
     void tilesetAdded(int index, Tileset *tileset);
     void tilesetChanged(Tileset *tileset);
+    void tileImagesChanged(Tileset *tileset, const QList<Tile*> &tiles);
     void tilesetRemoved(Tileset *tileset);
     void tilesetMoved(int from, int to);
     void tilesetNameChanged(Tileset *tileset);
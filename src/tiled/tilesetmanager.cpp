@@ -22,9 +22,12 @@
 #include "tilesetmanager.h"
 
 #include "filesystemwatcher.h"
+#include "imagecache.h"
+#include "tile.h"
 #include "tileset.h"
 
 #include <QImage>
+#include <QtConcurrentRun>
 
 using namespace Tiled;
 using namespace Tiled::Internal;
@@ -50,6 +53,9 @@ TilesetManager::~TilesetManager()
     // Since all MapDocuments should be deleted first, we assert that there are
     // no remaining tileset references.
     Q_ASSERT(mTilesets.size() == 0);
+
+    foreach (QFutureWatcher<ImageReload> *watcher, mReloads)
+        watcher->waitForFinished();
 }
 
 TilesetManager *TilesetManager::instance()
@@ -113,6 +119,7 @@ void TilesetManager::removeReference(Tileset *tileset)
             mWatcher->removePath(tileset->imageSource());
 
         delete tileset;
+        ImageCache::purge();
     }
 }
 
@@ -165,12 +172,203 @@ void TilesetManager::fileChanged(const QString &path)
 
 void TilesetManager::fileChangedTimeout()
 {
+    foreach (const QString &fileName, mChangedFiles)
+        startReload(fileName);
+
+    mChangedFiles.clear();
+}
+
+/**
+ * Starts reloading the tilesets using the image \a fileName in the
+ * background. When the image is already being reloaded, it is reloaded
+ * again once that has finished.
+ */
+void TilesetManager::startReload(const QString &fileName)
+{
+    if (mReloads.contains(fileName)) {
+        mReloadAgain.insert(fileName);
+        return;
+    }
+
+    ImageReload reload;
+    reload.fileName = fileName;
+
+    // Tilesets sharing their image also share the conversion back to QImage
+    QHash<qint64, QImage> oldImages;
+
     foreach (Tileset *tileset, tilesets()) {
-        QString fileName = tileset->imageSource();
-        if (mChangedFiles.contains(fileName))
-            if (tileset->loadFromImage(QImage(fileName), fileName))
-                emit tilesetChanged(tileset);
+        if (tileset->imageSource() != fileName)
+            continue;
+
+        QImage oldImage;
+        QVector<QRect> tileRects;
+
+        if (Tile *firstTile = tileset->tileAt(0)) {
+            const QPixmap pixmap = firstTile->pixmap();
+            const qint64 cacheKey = pixmap.cacheKey();
+
+            for (int id = 0; id < tileset->tileCount(); ++id) {
+                const Tile *tile = tileset->tileAt(id);
+                if (tile->pixmap().cacheKey() != cacheKey) {
+                    // Not all tiles are from the image, so compare nothing
+                    tileRects.clear();
+                    break;
+                }
+                tileRects.append(tile->imageRect());
+            }
+
+            if (!tileRects.isEmpty()) {
+                QHash<qint64, QImage>::const_iterator it =
+                        oldImages.find(cacheKey);
+                if (it == oldImages.constEnd())
+                    it = oldImages.insert(cacheKey, pixmap.toImage());
+                oldImage = it.value();
+            }
+        }
+
+        reload.tilesets.append(tileset);
+        reload.oldImages.append(oldImage);
+        reload.transparentColors.append(tileset->transparentColor());
+        reload.tileRects.append(tileRects);
     }
 
-    mChangedFiles.clear();
+    if (reload.tilesets.isEmpty())
+        return;
+
+    QFutureWatcher<ImageReload> *watcher =
+            new QFutureWatcher<ImageReload>(this);
+    connect(watcher, SIGNAL(finished()), SLOT(reloadFinished()));
+    mReloads.insert(fileName, watcher);
+
+    watcher->setFuture(QtConcurrent::run(compareImages, reload));
+}
+
+/**
+ * Returns whether the area \a rect looks the same in both images. Pixels
+ * matching the \a transparentColor in the new image are masked out, like
+ * they were in the old image.
+ */
+static bool isSameTileImage(const QImage &oldImage, const QImage &newImage,
+                            const QRect &rect, const QColor &transparentColor)
+{
+    const bool masked = transparentColor.isValid();
+    const QRgb transparent = transparentColor.rgb() & RGB_MASK;
+    const QRect r = rect & newImage.rect();
+
+    for (int y = r.top(); y <= r.bottom(); ++y) {
+        const QRgb *oldLine =
+                reinterpret_cast<const QRgb*>(oldImage.constScanLine(y));
+        const QRgb *newLine =
+                reinterpret_cast<const QRgb*>(newImage.constScanLine(y));
+
+        for (int x = r.left(); x <= r.right(); ++x) {
+            QRgb oldPixel = oldLine[x];
+            QRgb newPixel = newLine[x];
+
+            if (qAlpha(oldPixel) == 0)
+                oldPixel = 0;
+            if (qAlpha(newPixel) == 0
+                    || (masked && (newPixel & RGB_MASK) == transparent))
+                newPixel = 0;
+
+            if (oldPixel != newPixel)
+                return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Decodes the changed image and determines which tiles have changed. Runs
+ * in a background thread.
+ */
+TilesetManager::ImageReload TilesetManager::compareImages(ImageReload reload)
+{
+    reload.image = ImageCache::loadImage(reload.fileName);
+    if (reload.image.isNull())
+        return reload;
+
+    const QImage newImage =
+            reload.image.convertToFormat(QImage::Format_ARGB32);
+
+    for (int i = 0; i < reload.tilesets.size(); ++i) {
+        const QImage oldImage =
+                reload.oldImages.at(i).convertToFormat(QImage::Format_ARGB32);
+        const QVector<QRect> &tileRects = reload.tileRects.at(i);
+        const QColor &transparentColor = reload.transparentColors.at(i);
+
+        QVector<int> changedTiles;
+
+        // When the size differs, the whole tileset will be reloaded
+        if (oldImage.size() == newImage.size()) {
+            for (int id = 0; id < tileRects.size(); ++id) {
+                if (!isSameTileImage(oldImage, newImage, tileRects.at(id),
+                                     transparentColor)) {
+                    changedTiles.append(id);
+                }
+            }
+        }
+
+        reload.changedTiles.append(changedTiles);
+    }
+
+    return reload;
+}
+
+void TilesetManager::reloadFinished()
+{
+    QFutureWatcher<ImageReload> *watcher =
+            static_cast<QFutureWatcher<ImageReload>*>(sender());
+    const ImageReload reload = watcher->result();
+
+    mReloads.remove(reload.fileName);
+    watcher->deleteLater();
+
+    finishReload(reload);
+    ImageCache::purge();
+
+    if (mReloadAgain.remove(reload.fileName))
+        startReload(reload.fileName);
+}
+
+void TilesetManager::finishReload(const ImageReload &reload)
+{
+    // Intermediate versions of the file may fail to load, in which case the
+    // tilesets keep their current images
+    if (reload.image.isNull())
+        return;
+
+    for (int i = 0; i < reload.tilesets.size(); ++i) {
+        Tileset *tileset = reload.tilesets.at(i);
+
+        // The tileset may have been removed or changed in the meantime
+        if (!mTilesets.contains(tileset)
+                || tileset->imageSource() != reload.fileName
+                || tileset->transparentColor() != reload.transparentColors.at(i))
+            continue;
+
+        if (!tileset->loadFromImage(reload.image, reload.fileName))
+            continue;
+
+        // Only report the changed tiles when the tiles are still the same
+        const QVector<QRect> &tileRects = reload.tileRects.at(i);
+        bool sameTiles = reload.oldImages.at(i).size() == reload.image.size()
+                && tileRects.size() == tileset->tileCount();
+
+        for (int id = 0; sameTiles && id < tileRects.size(); ++id)
+            sameTiles = tileset->tileAt(id)->imageRect() == tileRects.at(id);
+
+        if (!sameTiles) {
+            emit tilesetChanged(tileset);
+            continue;
+        }
+
+        QList<Tile*> changedTiles;
+        foreach (int id, reload.changedTiles.at(i))
+            changedTiles.append(tileset->tileAt(id));
+
+        if (!changedTiles.isEmpty())
+            emit tileImagesChanged(tileset, changedTiles);
+    }
 }
@@ -22,15 +22,22 @@
 #ifndef TILESETMANAGER_H
 #define TILESETMANAGER_H
 
+#include <QColor>
+#include <QFutureWatcher>
+#include <QHash>
+#include <QImage>
 #include <QObject>
 #include <QList>
 #include <QMap>
+#include <QRect>
 #include <QString>
 #include <QSet>
 #include <QTimer>
+#include <QVector>
 
 namespace Tiled {
 
+class Tile;
 class Tileset;
 
 namespace Internal {
@@ -54,6 +61,10 @@ struct TilesetSpec
  * The tileset manager keeps track of all tilesets used by loaded maps. It also
  * watches the tileset images for changes and will attempt to reload them when
  * they change.
+ *
+ * Changed images are decoded and compared against the current tile images in
+ * the background. Only the tiles that actually changed are reported, so that
+ * views only need to repaint the cells using those tiles.
  */
 class TilesetManager : public QObject
 {
@@ -132,13 +143,42 @@ signals:
      */
     void tilesetChanged(Tileset *tileset);
 
+    /**
+     * Emitted when the tileset image was reloaded and only the images of the
+     * given \a tiles have changed. All tiles are from the given \a tileset.
+     */
+    void tileImagesChanged(Tileset *tileset, const QList<Tile*> &tiles);
+
 private slots:
     void fileChanged(const QString &path);
     void fileChangedTimeout();
+    void reloadFinished();
 
 private:
     Q_DISABLE_COPY(TilesetManager)
 
+    /**
+     * The state of reloading a changed tileset image, which is passed to and
+     * returned from the background thread. Only the images and rectangles
+     * are accessed there.
+     */
+    struct ImageReload
+    {
+        QString fileName;
+        QList<Tileset*> tilesets;
+        QList<QImage> oldImages;
+        QList<QColor> transparentColors;
+        QList<QVector<QRect> > tileRects;
+
+        QImage image;
+        QList<QVector<int> > changedTiles;
+    };
+
+    static ImageReload compareImages(ImageReload reload);
+
+    void startReload(const QString &fileName);
+    void finishReload(const ImageReload &reload);
+
     /**
      * Constructor. Only used by the tileset manager itself.
      */
@@ -159,6 +199,9 @@ private:
     QSet<QString> mChangedFiles;
     QTimer mChangedFilesTimer;
     bool mReloadTilesetsOnChange;
+
+    QHash<QString, QFutureWatcher<ImageReload>*> mReloads;
+    QSet<QString> mReloadAgain;
 };
 
 } // namespace Internal
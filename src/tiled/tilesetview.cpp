@@ -215,10 +215,9 @@ void TileDelegate::paint(QPainter *painter,
     if (!tile)
         return;
 
-    const QPixmap &tileImage = tile->image();
     const int extra = mTilesetView->drawGrid() ? 1 : 0;
     const qreal zoom = mTilesetView->scale();
-    const QSize tileSize = tileImage.size() * zoom;
+    const QSize tileSize = tile->size() * zoom;
 
     // Compute rectangle to draw the image in: bottom- and left-aligned
     QRect targetRect = option.rect.adjusted(0, 0, -extra, -extra);
@@ -230,7 +229,7 @@ void TileDelegate::paint(QPainter *painter,
         if (zoomable->smoothTransform())
             painter->setRenderHint(QPainter::SmoothPixmapTransform);
 
-    painter->drawPixmap(targetRect, tileImage);
+    painter->drawPixmap(targetRect, tile->pixmap(), tile->imageRect());
 
     // Overlay with highlight color when selected
     if (option.state & QStyle::State_Selected) {
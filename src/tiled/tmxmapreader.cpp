@@ -29,6 +29,7 @@
 
 #include <QBuffer>
 #include <QDir>
+#include <QFileInfo>
 
 using namespace Tiled;
 using namespace Tiled::Internal;
@@ -37,6 +38,11 @@ namespace {
 
 class EditorMapReader : public MapReader
 {
+public:
+    explicit EditorMapReader(const QHash<QString, QImage> *images = 0)
+        : mImages(images)
+    {}
+
 protected:
     /**
      * Overridden to make sure the resolved reference is a clean path.
@@ -47,6 +53,20 @@ protected:
         return QDir::cleanPath(resolved);
     }
 
+    /**
+     * Overridden to use the images that were decoded in advance, if any.
+     */
+    QImage readExternalImage(const QString &source)
+    {
+        if (mImages) {
+            QHash<QString, QImage>::const_iterator it = mImages->find(source);
+            if (it != mImages->end())
+                return it.value();
+        }
+
+        return MapReader::readExternalImage(source);
+    }
+
     /**
      * Overridden in order to check with the TilesetManager whether the tileset
      * is already loaded.
@@ -63,6 +83,9 @@ protected:
 
         return tileset;
     }
+
+private:
+    const QHash<QString, QImage> *mImages;
 };
 
 } // anonymous namespace
@@ -95,6 +118,24 @@ Map *TmxMapReader::fromByteArray(const QByteArray &data)
     return map;
 }
 
+Map *TmxMapReader::fromByteArray(const QByteArray &data,
+                                 const QString &fileName,
+                                 const QHash<QString, QImage> &images)
+{
+    mError.clear();
+
+    QByteArray dataCopy = data;
+    QBuffer buffer(&dataCopy);
+    buffer.open(QBuffer::ReadOnly);
+
+    EditorMapReader reader(&images);
+    Map *map = reader.readMap(&buffer, QFileInfo(fileName).absolutePath());
+    if (!map)
+        mError = reader.errorString();
+
+    return map;
+}
+
 Tileset *TmxMapReader::readTileset(const QString &fileName)
 {
     mError.clear();
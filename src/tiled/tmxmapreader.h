@@ -24,6 +24,8 @@
 #include "mapreaderinterface.h"
 
 #include <QCoreApplication>
+#include <QHash>
+#include <QImage>
 #include <QString>
 
 namespace Tiled {
@@ -50,6 +52,14 @@ public:
      */
     Map *fromByteArray(const QByteArray &data);
 
+    /**
+     * Reads the map given by \a data, which was read from \a fileName.
+     * External images are taken from \a images when they are found there,
+     * so that they can be decoded in advance. Returns 0 on failure.
+     */
+    Map *fromByteArray(const QByteArray &data, const QString &fileName,
+                       const QHash<QString, QImage> &images);
+
     Tileset *readTileset(const QString &fileName);
 
     QString nameFilter() const { return tr("Tiled map files (*.tmx)"); }
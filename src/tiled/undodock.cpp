@@ -21,15 +21,28 @@
 
 #include "undodock.h"
 
+#include "mapdocument.h"
+#include "undostorage.h"
+
 #include <QEvent>
+#include <QLabel>
+#include <QStringList>
+#include <QUndoCommand>
+#include <QUndoGroup>
 #include <QUndoView>
 #include <QVBoxLayout>
 
 using namespace Tiled;
 using namespace Tiled::Internal;
 
+/**
+ * The number of commands listed in the tool tip of the memory usage label.
+ */
+static const int largestCommandCount = 10;
+
 UndoDock::UndoDock(QUndoGroup *undoGroup, QWidget *parent)
     : QDockWidget(parent)
+    , mMapDocument(0)
 {
     setObjectName(QLatin1String("undoViewDock"));
 
@@ -44,10 +57,22 @@ UndoDock::UndoDock(QUndoGroup *undoGroup, QWidget *parent)
     layout->setMargin(5);
     layout->addWidget(mUndoView);
 
+    mMemoryUsageLabel = new QLabel(widget);
+    layout->addWidget(mMemoryUsageLabel);
+
+    connect(undoGroup, SIGNAL(indexChanged(int)),
+            SLOT(updateMemoryUsage()));
+
     setWidget(widget);
     retranslateUi();
 }
 
+void UndoDock::setMapDocument(MapDocument *mapDocument)
+{
+    mMapDocument = mapDocument;
+    updateMemoryUsage();
+}
+
 void UndoDock::changeEvent(QEvent *e)
 {
     QDockWidget::changeEvent(e);
@@ -64,4 +89,63 @@ void UndoDock::retranslateUi()
 {
     setWindowTitle(tr("History"));
     mUndoView->setEmptyLabel(tr("<empty>"));
+    updateMemoryUsage();
+}
+
+static QString formatSize(qint64 bytes)
+{
+    if (bytes < 1024)
+        return UndoDock::tr("%1 bytes").arg(bytes);
+    else if (bytes < 1024 * 1024)
+        return UndoDock::tr("%1 KiB").arg(bytes / 1024.0, 0, 'f', 1);
+    else
+        return UndoDock::tr("%1 MiB").arg(bytes / (1024.0 * 1024.0), 0, 'f', 1);
+}
+
+/**
+ * Shows the approximate amount of memory used by the undo commands of the
+ * current map, including the ones that have been undone. The tool tip lists
+ * the commands that use the most memory.
+ */
+void UndoDock::updateMemoryUsage()
+{
+    if (!mMapDocument) {
+        mMemoryUsageLabel->clear();
+        mMemoryUsageLabel->setToolTip(QString());
+        return;
+    }
+
+    const UndoStorage *storage = mMapDocument->undoStorage();
+    const qint64 swapped = storage->swappedSize();
+
+    QString text = tr("Memory used: %1").arg(formatSize(storage->memoryUsage()));
+    if (swapped > 0)
+        text = tr("%1 (%2 on disk)").arg(text, formatSize(swapped));
+
+    mMemoryUsageLabel->setText(text);
+
+    // List the commands using the most memory in the tool tip
+    QList<QPair<qint64, const CommandMemoryUsage*> > commands;
+    foreach (const CommandMemoryUsage *command, storage->commands())
+        commands.append(qMakePair(command->memoryUsage(), command));
+
+    qSort(commands.begin(), commands.end(),
+          qGreater<QPair<qint64, const CommandMemoryUsage*> >());
+
+    QStringList lines;
+    for (int i = 0; i < commands.size() && i < largestCommandCount; ++i) {
+        const CommandMemoryUsage *command = commands.at(i).second;
+        const QUndoCommand *undoCommand =
+                dynamic_cast<const QUndoCommand*>(command);
+
+        QString line = tr("%1: %2")
+                .arg(undoCommand ? undoCommand->text() : QString(),
+                     formatSize(commands.at(i).first));
+        if (command->isSwappedOut())
+            line = tr("%1 (on disk)").arg(line);
+
+        lines.append(line);
+    }
+
+    mMemoryUsageLabel->setToolTip(lines.join(QLatin1String("\n")));
 }
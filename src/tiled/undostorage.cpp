@@ -0,0 +1,307 @@
+/*
+ * undostorage.cpp
+ * Copyright 2026, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of Tiled.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "undostorage.h"
+
+#include "mapobject.h"
+#include "objectgroup.h"
+#include "tilelayer.h"
+
+#include <QDataStream>
+#include <QDir>
+#include <QTemporaryFile>
+
+#include <cstring>
+
+using namespace Tiled;
+using namespace Tiled::Internal;
+
+CommandMemoryUsage::CommandMemoryUsage(UndoStorage *storage)
+    : mUndoStorage(storage)
+{
+    mUndoStorage->mCommands.append(this);
+}
+
+CommandMemoryUsage::~CommandMemoryUsage()
+{
+    mUndoStorage->mCommands.removeOne(this);
+}
+
+void CommandMemoryUsage::markUsed()
+{
+    QList<CommandMemoryUsage*> &commands = mUndoStorage->mCommands;
+    if (commands.last() != this) {
+        commands.removeOne(this);
+        commands.append(this);
+    }
+}
+
+void CommandMemoryUsage::reportLoadFailure()
+{
+    emit mUndoStorage->loadFailed();
+}
+
+UndoStorage::UndoStorage(QObject *parent)
+    : QObject(parent)
+    , mFile(0)
+    , mFileSize(0)
+    , mStoredSize(0)
+{
+}
+
+UndoStorage::~UndoStorage()
+{
+    Q_ASSERT(mCommands.isEmpty());
+    delete mFile;
+}
+
+qint64 UndoStorage::memoryUsage() const
+{
+    qint64 usage = 0;
+    foreach (const CommandMemoryUsage *command, mCommands)
+        usage += command->memoryUsage();
+    return usage;
+}
+
+qint64 UndoStorage::swappedSize() const
+{
+    return mStoredSize;
+}
+
+void UndoStorage::applyBudget(qint64 budget)
+{
+    qint64 usage = memoryUsage();
+
+    for (int i = 0; i < mCommands.size() - 1 && usage > budget; ++i) {
+        CommandMemoryUsage *command = mCommands.at(i);
+        const qint64 before = command->memoryUsage();
+        command->swapOut();
+        usage -= before - command->memoryUsage();
+    }
+}
+
+qint64 UndoStorage::store(const QByteArray &data)
+{
+    // The file is only created once something needs to be swapped out
+    if (!mFile) {
+        mFile = new QTemporaryFile(QDir::tempPath() +
+                                   QLatin1String("/tiled-undo-XXXXXX"));
+        if (!mFile->open()) {
+            delete mFile;
+            mFile = 0;
+            return -1;
+        }
+    }
+
+    // A checksum is stored along with the data, to detect a damaged file
+    const QByteArray compressed = qCompress(data);
+    QByteArray block;
+    QDataStream stream(&block, QIODevice::WriteOnly);
+    stream << qChecksum(compressed.constData(), compressed.size())
+           << compressed;
+
+    const qint64 offset = allocate(block.size());
+    if (!mFile->seek(offset) || mFile->write(block) != block.size()) {
+        release(offset);
+        return -1;
+    }
+
+    return offset;
+}
+
+bool UndoStorage::load(qint64 offset, QByteArray *data)
+{
+    const qint64 size = mBlocks.value(offset, -1);
+
+    QByteArray block;
+    if (size != -1 && mFile->seek(offset))
+        block = mFile->read(size);
+
+    quint16 checksum = 0;
+    QByteArray compressed;
+    QDataStream stream(block);
+    stream >> checksum >> compressed;
+
+    if (block.size() == size &&
+            stream.status() == QDataStream::Ok &&
+            checksum == qChecksum(compressed.constData(), compressed.size())) {
+        *data = qUncompress(compressed);
+
+        // Empty data is never stored, so this means decompression failed
+        if (!data->isEmpty())
+            return true;
+    }
+
+    emit loadFailed();
+    return false;
+}
+
+void UndoStorage::release(qint64 offset)
+{
+    QMap<qint64, qint64>::iterator block = mBlocks.find(offset);
+    if (block == mBlocks.end())
+        return;
+
+    qint64 size = block.value();
+    mBlocks.erase(block);
+    mStoredSize -= size;
+
+    // Merge with the free range that follows
+    QMap<qint64, qint64>::iterator next = mFreeRanges.find(offset + size);
+    if (next != mFreeRanges.end()) {
+        size += next.value();
+        mFreeRanges.erase(next);
+    }
+
+    // Merge with the free range that precedes
+    QMap<qint64, qint64>::iterator it = mFreeRanges.lowerBound(offset);
+    if (it != mFreeRanges.begin()) {
+        --it;
+        if (it.key() + it.value() == offset) {
+            offset = it.key();
+            size += it.value();
+            mFreeRanges.erase(it);
+        }
+    }
+
+    // Free space at the end of the file is given back
+    if (offset + size == mFileSize) {
+        mFileSize = offset;
+        mFile->resize(mFileSize);
+    } else {
+        mFreeRanges.insert(offset, size);
+    }
+}
+
+/**
+ * Reserves \a size bytes in the file, reusing the first free range that is
+ * large enough. Returns the offset of the reserved space.
+ */
+qint64 UndoStorage::allocate(qint64 size)
+{
+    qint64 offset = mFileSize;
+
+    QMap<qint64, qint64>::iterator it = mFreeRanges.begin();
+    for (; it != mFreeRanges.end(); ++it) {
+        if (it.value() >= size) {
+            offset = it.key();
+            const qint64 remaining = it.value() - size;
+            mFreeRanges.erase(it);
+            if (remaining > 0)
+                mFreeRanges.insert(offset + size, remaining);
+            break;
+        }
+    }
+
+    mFileSize = qMax(mFileSize, offset + size);
+    mBlocks.insert(offset, size);
+    mStoredSize += size;
+
+    return offset;
+}
+
+qint64 UndoStorage::storeLayer(Layer *layer)
+{
+    TileLayer *tileLayer = layer->asTileLayer();
+    if (!tileLayer || tileLayer->size().isEmpty())
+        return -1;
+
+    QVector<Cell> cells;
+    cells.reserve(tileLayer->width() * tileLayer->height());
+    for (int y = 0; y < tileLayer->height(); ++y)
+        for (int x = 0; x < tileLayer->width(); ++x)
+            cells.append(tileLayer->cellAt(x, y));
+
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream << tileLayer->size() << cellsToData(cells);
+
+    // Shrinking the layer releases its cells
+    const qint64 offset = store(data);
+    if (offset != -1)
+        tileLayer->resize(QSize(0, 0), QPoint());
+
+    return offset;
+}
+
+bool UndoStorage::loadLayer(Layer *layer, qint64 offset)
+{
+    TileLayer *tileLayer = layer->asTileLayer();
+    Q_ASSERT(tileLayer);
+
+    QByteArray data;
+    if (!load(offset, &data))
+        return false;
+
+    QSize size;
+    QByteArray cellData;
+    QDataStream stream(data);
+    stream >> size >> cellData;
+
+    const QVector<Cell> cells = cellsFromData(cellData);
+
+    // Only touch the layer once the data is known to be complete
+    if (stream.status() != QDataStream::Ok || size.isEmpty() ||
+            cellData.size() != cells.size() * int(sizeof(Cell)) ||
+            cells.size() != size.width() * size.height()) {
+        emit loadFailed();
+        return false;
+    }
+
+    tileLayer->resize(size, QPoint());
+
+    for (int y = 0, i = 0; y < size.height(); ++y)
+        for (int x = 0; x < size.width(); ++x, ++i)
+            tileLayer->setCell(x, y, cells.at(i));
+
+    return true;
+}
+
+qint64 UndoStorage::layerMemoryUsage(const Layer *layer)
+{
+    if (!layer)
+        return 0;
+
+    if (layer->isTileLayer())
+        return sizeof(TileLayer) +
+                qint64(layer->width()) * layer->height() * sizeof(Cell);
+
+    if (layer->isObjectGroup()) {
+        const ObjectGroup *objectGroup = static_cast<const ObjectGroup*>(layer);
+        return sizeof(ObjectGroup) +
+                objectGroup->objectCount() * sizeof(MapObject);
+    }
+
+    return sizeof(Layer);
+}
+
+QByteArray UndoStorage::cellsToData(const QVector<Cell> &cells)
+{
+    // Cells are copied as-is, including the address of their tile
+    return QByteArray(reinterpret_cast<const char*>(cells.constData()),
+                      cells.size() * sizeof(Cell));
+}
+
+QVector<Cell> UndoStorage::cellsFromData(const QByteArray &data)
+{
+    QVector<Cell> cells(data.size() / sizeof(Cell));
+    std::memcpy(cells.data(), data.constData(), cells.size() * sizeof(Cell));
+    return cells;
+}
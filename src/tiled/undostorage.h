@@ -0,0 +1,192 @@
+/*
+ * undostorage.h
+ * Copyright 2026, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of Tiled.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef UNDOSTORAGE_H
+#define UNDOSTORAGE_H
+
+#include <QByteArray>
+#include <QList>
+#include <QMap>
+#include <QObject>
+#include <QVector>
+
+class QTemporaryFile;
+
+namespace Tiled {
+
+class Cell;
+class Layer;
+
+namespace Internal {
+
+class UndoStorage;
+
+/**
+ * Base class for undo commands that can report how much memory they use,
+ * and that can move their data to disk when the undo history grows beyond
+ * its memory budget.
+ */
+class CommandMemoryUsage
+{
+public:
+    explicit CommandMemoryUsage(UndoStorage *storage);
+    virtual ~CommandMemoryUsage();
+
+    /**
+     * Returns the approximate number of bytes used by this command.
+     */
+    virtual qint64 memoryUsage() const = 0;
+
+    /**
+     * Moves the data of this command to the undo storage, reducing its
+     * memory usage. The command should load its data again using swapIn()
+     * before it is undone or redone. The default implementation does nothing.
+     */
+    virtual void swapOut() {}
+
+    /**
+     * Returns whether the data of this command is currently stored on disk.
+     */
+    virtual bool isSwappedOut() const { return false; }
+
+protected:
+    UndoStorage *undoStorage() const { return mUndoStorage; }
+
+    /**
+     * Marks this command as recently used, which makes it the last one to
+     * be swapped out.
+     */
+    void markUsed();
+
+    /**
+     * Reports that data loaded from the undo storage turned out to be
+     * invalid, causing the storage to emit its loadFailed() signal.
+     */
+    void reportLoadFailure();
+
+private:
+    UndoStorage *mUndoStorage;
+};
+
+/**
+ * Keeps track of the memory used by the undo commands of a map document.
+ * When the commands use more memory than allowed, the data of the least
+ * recently used commands is compressed and moved to a temporary file, from
+ * which it is loaded again when the command is undone or redone.
+ *
+ * The stored data is only valid within the running process, since it may
+ * refer to tiles by their address.
+ */
+class UndoStorage : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit UndoStorage(QObject *parent = 0);
+    ~UndoStorage();
+
+    /**
+     * Returns the approximate number of bytes used by all commands.
+     */
+    qint64 memoryUsage() const;
+
+    /**
+     * Returns the number of bytes stored in the temporary file that are
+     * still in use by commands.
+     */
+    qint64 swappedSize() const;
+
+    /**
+     * Returns the commands using this storage, least recently used first.
+     */
+    const QList<CommandMemoryUsage*> &commands() const { return mCommands; }
+
+    /**
+     * Swaps out the least recently used commands until the commands use at
+     * most \a budget bytes. The most recently used command is never swapped
+     * out, since it may still be merged with.
+     */
+    void applyBudget(qint64 budget);
+
+    /**
+     * Stores the given \a data. Returns the offset at which it was stored,
+     * or -1 when the data could not be written.
+     */
+    qint64 store(const QByteArray &data);
+
+    /**
+     * Loads the data stored at the given \a offset into \a data. Returns
+     * whether the data could be read back intact. When it couldn't, the
+     * loadFailed() signal is emitted.
+     */
+    bool load(qint64 offset, QByteArray *data);
+
+    /**
+     * Releases the data stored at the given \a offset, allowing the space
+     * it used to be reused.
+     */
+    void release(qint64 offset);
+
+    /**
+     * Stores the cells of the given layer and releases them from memory.
+     * Only tile layers are stored. Returns the offset at which the cells
+     * were stored, or -1 when nothing was stored.
+     */
+    qint64 storeLayer(Layer *layer);
+
+    /**
+     * Restores the cells of a layer previously stored with storeLayer().
+     * The layer is left untouched when the cells could not be loaded, in
+     * which case false is returned.
+     */
+    bool loadLayer(Layer *layer, qint64 offset);
+
+    /**
+     * Returns the approximate number of bytes used by the given layer.
+     */
+    static qint64 layerMemoryUsage(const Layer *layer);
+
+    static QByteArray cellsToData(const QVector<Cell> &cells);
+    static QVector<Cell> cellsFromData(const QByteArray &data);
+
+signals:
+    /**
+     * Emitted when stored data could not be read back, which means the
+     * command it belongs to can no longer be undone or redone.
+     */
+    void loadFailed();
+
+private:
+    friend class CommandMemoryUsage;
+
+    qint64 allocate(qint64 size);
+
+    QTemporaryFile *mFile;
+    QList<CommandMemoryUsage*> mCommands;   /**< Least recently used first. */
+    QMap<qint64, qint64> mBlocks;           /**< Offset and size of stored data. */
+    QMap<qint64, qint64> mFreeRanges;       /**< Offset and size of free space. */
+    qint64 mFileSize;
+    qint64 mStoredSize;
+};
+
+} // namespace Internal
+} // namespace Tiled
+
+#endif // UNDOSTORAGE_H
@@ -0,0 +1,213 @@
+#include "map.h"
+#include "isometricrenderer.h"
+#include "tile.h"
+#include "tilelayer.h"
+#include "tileset.h"
+
+#include <QtTest/QtTest>
+#include <QPaintEngine>
+
+#include <climits>
+
+using namespace Tiled;
+
+namespace {
+
+/**
+ * A paint engine that only counts how often it is asked to draw a different
+ * pixmap than the previous one. This matches the number of batches in which
+ * the CellRenderer is able to draw the tiles.
+ */
+class PixmapSwitchCounter : public QPaintEngine
+{
+public:
+    PixmapSwitchCounter()
+        : mLastCacheKey(0)
+        , mSwitches(0)
+    {}
+
+    int switches() const { return mSwitches; }
+
+    bool begin(QPaintDevice *) { return true; }
+    bool end() { return true; }
+    void updateState(const QPaintEngineState &) {}
+    Type type() const { return QPaintEngine::User; }
+
+    void drawPixmap(const QRectF &, const QPixmap &pixmap, const QRectF &)
+    {
+        if (pixmap.cacheKey() != mLastCacheKey) {
+            mLastCacheKey = pixmap.cacheKey();
+            ++mSwitches;
+        }
+    }
+
+private:
+    qint64 mLastCacheKey;
+    int mSwitches;
+};
+
+class CountingPaintDevice : public QPaintDevice
+{
+public:
+    explicit CountingPaintDevice(const QSize &size)
+        : mSize(size)
+    {}
+
+    QPaintEngine *paintEngine() const { return &mEngine; }
+    int switches() const { return mEngine.switches(); }
+
+protected:
+    int metric(PaintDeviceMetric metric) const
+    {
+        switch (metric) {
+        case PdmWidth:      return mSize.width();
+        case PdmHeight:     return mSize.height();
+        case PdmDepth:      return 32;
+        case PdmNumColors:  return INT_MAX;
+        case PdmDpiX:
+        case PdmDpiY:
+        case PdmPhysicalDpiX:
+        case PdmPhysicalDpiY:
+            return 72;
+        default:
+            return 1;
+        }
+    }
+
+private:
+    QSize mSize;
+    mutable PixmapSwitchCounter mEngine;
+};
+
+} // anonymous namespace
+
+class test_IsometricRenderer : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void rowBatching();
+
+    void drawTileLayer_data();
+    void drawTileLayer();
+
+private:
+    Map *mMap;
+    QList<Tileset*> mTilesets;
+};
+
+void test_IsometricRenderer::initTestCase()
+{
+    mMap = new Map(Map::Isometric, 64, 64, 64, 32);
+
+    // Four tilesets, each with tall tiles of 2 different colors. The tiles
+    // of a tileset share its image, so only switching between tilesets
+    // starts a new batch.
+    QList<Tile*> tiles;
+    for (int t = 0; t < 4; ++t) {
+        QImage image(64 * 2, 96, QImage::Format_ARGB32);
+        for (int i = 0; i < 2; ++i) {
+            QPainter painter(&image);
+            painter.fillRect(i * 64, 0, 64, 96,
+                             QColor::fromHsv((t * 2 + i) * 45, 255, 255));
+        }
+
+        const QString name = QString(QLatin1String("tiles%1")).arg(t);
+        Tileset *tileset = new Tileset(name, 64, 96);
+        QVERIFY(tileset->loadFromImage(image, name + QLatin1String(".png")));
+        mMap->addTileset(tileset);
+        mTilesets.append(tileset);
+
+        for (int i = 0; i < tileset->tileCount(); ++i)
+            tiles.append(tileset->tileAt(i));
+    }
+
+    TileLayer *tileLayer = new TileLayer(QString(),
+                                         0, 0,
+                                         mMap->width(), mMap->height());
+
+    // Spread the tiles in a way that neighbouring cells rarely match
+    for (int y = 0; y < tileLayer->height(); ++y) {
+        for (int x = 0; x < tileLayer->width(); ++x) {
+            Tile *tile = tiles.at((x * 7 + y * 13) % tiles.size());
+            tileLayer->setCell(x, y, Cell(tile));
+        }
+    }
+
+    mMap->addLayer(tileLayer);
+}
+
+void test_IsometricRenderer::cleanupTestCase()
+{
+    delete mMap;
+    mMap = 0;
+    qDeleteAll(mTilesets);
+    mTilesets.clear();
+}
+
+/**
+ * Compares the number of batches needed to draw the layer against the number
+ * of batches needed when drawing the cells of each row in their natural order.
+ */
+void test_IsometricRenderer::rowBatching()
+{
+    IsometricRenderer renderer(mMap);
+    const TileLayer *tileLayer = mMap->layerAt(0)->asTileLayer();
+    const int width = tileLayer->width();
+    const int height = tileLayer->height();
+
+    int unsortedBatches = 0;
+    int rowCount = 0;
+    const Tileset *lastTileset = 0;
+
+    for (int diagonal = 0; diagonal <= width + height - 2; ++diagonal) {
+        for (int x = qMax(0, diagonal - height + 1);
+             x <= qMin(width - 1, diagonal); ++x) {
+            const Tile *tile = tileLayer->cellAt(x, diagonal - x).tile;
+            if (tile->tileset() != lastTileset) {
+                lastTileset = tile->tileset();
+                ++unsortedBatches;
+            }
+        }
+        ++rowCount;
+    }
+
+    CountingPaintDevice device(renderer.mapSize());
+    QPainter painter(&device);
+    renderer.drawTileLayer(&painter, tileLayer);
+    painter.end();
+
+    const int batches = device.switches();
+
+    QVERIFY(batches < unsortedBatches);
+    QVERIFY(batches <= rowCount * mTilesets.size());
+}
+
+void test_IsometricRenderer::drawTileLayer_data()
+{
+    QTest::addColumn<QRectF>("exposed");
+
+    QTest::newRow("everything") << QRectF();
+    QTest::newRow("center") << QRectF(1024, 512, 1024, 768);
+}
+
+void test_IsometricRenderer::drawTileLayer()
+{
+    QFETCH(QRectF, exposed);
+
+    IsometricRenderer renderer(mMap);
+    const TileLayer *tileLayer = mMap->layerAt(0)->asTileLayer();
+
+    QImage image(renderer.mapSize(), QImage::Format_ARGB32_Premultiplied);
+    QPainter painter(&image);
+
+    QBENCHMARK {
+        renderer.drawTileLayer(&painter, tileLayer, exposed);
+    }
+}
+
+QTEST_MAIN(test_IsometricRenderer)
+#include "test_isometricrenderer.moc"
@@ -0,0 +1,118 @@
+#include "properties.h"
+
+#include <QtTest/QtTest>
+
+using namespace Tiled;
+
+class test_Properties : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void insertAndValue();
+    void sortedIteration();
+    void remove();
+    void merge();
+    void subscript();
+    void internedNames();
+};
+
+void test_Properties::insertAndValue()
+{
+    Properties properties;
+    QVERIFY(properties.isEmpty());
+
+    properties.insert(QLatin1String("b"), QLatin1String("2"));
+    properties.insert(QLatin1String("a"), QLatin1String("1"));
+    properties.insert(QLatin1String("b"), QLatin1String("3"));
+
+    QCOMPARE(properties.size(), 2);
+    QVERIFY(properties.contains(QLatin1String("a")));
+    QVERIFY(!properties.contains(QLatin1String("c")));
+    QCOMPARE(properties.value(QLatin1String("b")), QString(QLatin1String("3")));
+    QCOMPARE(properties.value(QLatin1String("c"), QLatin1String("x")),
+             QString(QLatin1String("x")));
+}
+
+void test_Properties::sortedIteration()
+{
+    Properties properties;
+    properties.insert(QLatin1String("delta"), QLatin1String("4"));
+    properties.insert(QLatin1String("alpha"), QLatin1String("1"));
+    properties.insert(QLatin1String("charlie"), QLatin1String("3"));
+    properties.insert(QLatin1String("bravo"), QLatin1String("2"));
+
+    QStringList expected;
+    expected << QLatin1String("alpha") << QLatin1String("bravo")
+             << QLatin1String("charlie") << QLatin1String("delta");
+    QCOMPARE(QStringList(properties.keys()), expected);
+
+    int number = 1;
+    Properties::const_iterator it = properties.constBegin();
+    for (; it != properties.constEnd(); ++it, ++number)
+        QCOMPARE(it.value(), QString::number(number));
+}
+
+void test_Properties::remove()
+{
+    Properties properties;
+    properties.insert(QLatin1String("a"), QLatin1String("1"));
+    properties.insert(QLatin1String("b"), QLatin1String("2"));
+
+    QCOMPARE(properties.remove(QLatin1String("c")), 0);
+    QCOMPARE(properties.remove(QLatin1String("a")), 1);
+    QCOMPARE(properties.size(), 1);
+    QCOMPARE(properties.take(QLatin1String("b")), QString(QLatin1String("2")));
+    QVERIFY(properties.isEmpty());
+}
+
+void test_Properties::merge()
+{
+    Properties properties;
+    properties.insert(QLatin1String("a"), QLatin1String("1"));
+    properties.insert(QLatin1String("b"), QLatin1String("2"));
+
+    Properties other;
+    other.insert(QLatin1String("b"), QLatin1String("3"));
+    other.insert(QLatin1String("c"), QLatin1String("4"));
+
+    properties.merge(other);
+
+    Properties expected;
+    expected.insert(QLatin1String("a"), QLatin1String("1"));
+    expected.insert(QLatin1String("b"), QLatin1String("3"));
+    expected.insert(QLatin1String("c"), QLatin1String("4"));
+    QCOMPARE(properties == expected, true);
+
+    Properties empty;
+    empty.merge(other);
+    QCOMPARE(empty == other, true);
+}
+
+void test_Properties::subscript()
+{
+    Properties properties;
+    properties[QLatin1String("a")] = QLatin1String("1");
+    properties[QLatin1String("a")] += QLatin1String("2");
+
+    QCOMPARE(properties.value(QLatin1String("a")), QString(QLatin1String("12")));
+
+    const Properties &constProperties = properties;
+    QCOMPARE(constProperties[QLatin1String("b")], QString());
+    QCOMPARE(properties.size(), 1);
+}
+
+void test_Properties::internedNames()
+{
+    Properties first;
+    Properties second;
+    first.insert(QString(QLatin1String("name")), QString());
+    second.insert(QString(QLatin1String("name")), QString());
+
+    // Both sets should share the same storage for the property name
+    QCOMPARE(first.constBegin().key().constData(),
+             second.constBegin().key().constData());
+}
+
+QTEST_MAIN(test_Properties)
+#include "test_properties.moc"
@@ -0,0 +1,200 @@
+#include "terrain.h"
+#include "tile.h"
+#include "tileset.h"
+
+#include <QtTest/QtTest>
+
+using namespace Tiled;
+
+class test_TerrainDistances : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void directTransitions();
+    void noTerrainIsOnlyIntermediate();
+    void matchesOriginalAlgorithm();
+};
+
+/**
+ * The terrain distance calculation as it was done before switching to
+ * Floyd-Warshall. The result is returned as a matrix with an additional row
+ * and column for 'no terrain', like the one stored by the Tileset.
+ */
+static QVector<int> originalTerrainDistances(const Tileset &tileset)
+{
+    const int terrainCount = tileset.terrainCount();
+    QVector<QVector<int> > distances(terrainCount,
+                                     QVector<int>(terrainCount + 1, -1));
+
+    for (int i = 0; i < terrainCount; ++i) {
+        QVector<int> &distance = distances[i];
+
+        for (int j = 0; j < tileset.tileCount(); ++j) {
+            const Tile *t = tileset.tileAt(j);
+
+            const int tl = t->cornerTerrainId(0);
+            const int tr = t->cornerTerrainId(1);
+            const int bl = t->cornerTerrainId(2);
+            const int br = t->cornerTerrainId(3);
+
+            if (tl != i && tr != i && bl != i && br != i)
+                continue;
+
+            if (tl == i || br == i) {
+                distance[tr + 1] = 1;
+                distance[bl + 1] = 1;
+            }
+            if (tr == i || bl == i) {
+                distance[tl + 1] = 1;
+                distance[br + 1] = 1;
+            }
+
+            distance[i + 1] = 0;
+        }
+    }
+
+    bool newConnections;
+    do {
+        newConnections = false;
+
+        for (int i = 0; i < terrainCount; ++i) {
+            for (int j = 0; j < terrainCount; ++j) {
+                if (i == j)
+                    continue;
+
+                for (int t = -1; t < terrainCount; ++t) {
+                    const int d0 = distances[i][t + 1];
+                    const int d1 = distances[j][t + 1];
+                    if (d0 == -1 || d1 == -1)
+                        continue;
+
+                    const int d = distances[i][j + 1];
+                    if (d == -1 || d0 + d1 < d) {
+                        distances[i][j + 1] = d0 + d1;
+                        distances[j][i + 1] = d0 + d1;
+                        newConnections = true;
+                    }
+                }
+            }
+        }
+    } while (newConnections);
+
+    const int count = terrainCount + 1;
+    QVector<int> matrix(count * count);
+
+    for (int i = -1; i < terrainCount; ++i) {
+        for (int j = -1; j < terrainCount; ++j) {
+            int penalty;
+            if (i == -1 && j == -1)
+                penalty = 0;
+            else if (i == -1)
+                penalty = distances[j][0];
+            else
+                penalty = distances[i][j + 1];
+
+            matrix[(i + 1) * count + j + 1] = penalty;
+        }
+    }
+
+    return matrix;
+}
+
+static unsigned makeTerrain(int topLeft, int topRight,
+                            int bottomLeft, int bottomRight)
+{
+    return (topLeft & 0xFF) << 24 |
+            (topRight & 0xFF) << 16 |
+            (bottomLeft & 0xFF) << 8 |
+            (bottomRight & 0xFF);
+}
+
+static void addTerrainTile(Tileset &tileset, unsigned terrain)
+{
+    tileset.addTile(QPixmap())->setTerrain(terrain);
+}
+
+void test_TerrainDistances::directTransitions()
+{
+    Tileset tileset(QLatin1String("tileset"), 32, 32);
+    for (int i = 0; i < 3; ++i)
+        tileset.addTerrain(QString::number(i), -1);
+
+    addTerrainTile(tileset, makeTerrain(0, 0, 0, 0));
+    addTerrainTile(tileset, makeTerrain(0, 1, 0, 1));
+    addTerrainTile(tileset, makeTerrain(1, 2, 1, 2));
+
+    // Terrain 0 and 2 need a transition through terrain 1
+    QCOMPARE(tileset.terrainTransitionPenalty(0, 0), 0);
+    QCOMPARE(tileset.terrainTransitionPenalty(0, 1), 1);
+    QCOMPARE(tileset.terrainTransitionPenalty(0, 2), 2);
+    QCOMPARE(tileset.terrainTransitionPenalty(2, 0), 2);
+    QCOMPARE(tileset.terrain(0)->transitionDistance(2), 2);
+
+    // Diagonally opposite corners are not neighbours
+    addTerrainTile(tileset, makeTerrain(0, 1, 1, 2));
+    QCOMPARE(tileset.terrainTransitionPenalty(0, 2), 2);
+
+    addTerrainTile(tileset, makeTerrain(0, 2, 0, 2));
+    QCOMPARE(tileset.terrainTransitionPenalty(0, 2), 1);
+    QCOMPARE(tileset.terrainTransitionPenalty(0, -1), -1);
+}
+
+void test_TerrainDistances::noTerrainIsOnlyIntermediate()
+{
+    Tileset tileset(QLatin1String("tileset"), 32, 32);
+    for (int i = 0; i < 3; ++i)
+        tileset.addTerrain(QString::number(i), -1);
+
+    addTerrainTile(tileset, makeTerrain(0, -1, 0, -1));
+    addTerrainTile(tileset, makeTerrain(-1, 1, -1, 1));
+    addTerrainTile(tileset, makeTerrain(1, 2, 1, 2));
+
+    // Terrains may transition through 'no terrain'
+    QCOMPARE(tileset.terrainTransitionPenalty(0, 1), 2);
+    QCOMPARE(tileset.terrainTransitionPenalty(0, 2), 3);
+
+    // But the distances of 'no terrain' only count direct transitions
+    QCOMPARE(tileset.terrainTransitionPenalty(-1, -1), 0);
+    QCOMPARE(tileset.terrainTransitionPenalty(-1, 0), 1);
+    QCOMPARE(tileset.terrainTransitionPenalty(2, -1), -1);
+}
+
+void test_TerrainDistances::matchesOriginalAlgorithm()
+{
+    qsrand(1);
+
+    for (int run = 0; run < 2000; ++run) {
+        Tileset tileset(QLatin1String("tileset"), 32, 32);
+
+        const int terrainCount = 1 + qrand() % 8;
+        for (int i = 0; i < terrainCount; ++i)
+            tileset.addTerrain(QString::number(i), -1);
+
+        const int tileCount = qrand() % 12;
+        for (int i = 0; i < tileCount; ++i) {
+            int corners[4];
+            for (int corner = 0; corner < 4; ++corner)
+                corners[corner] = qrand() % (terrainCount + 1) - 1;
+
+            addTerrainTile(tileset, makeTerrain(corners[0], corners[1],
+                                                corners[2], corners[3]));
+        }
+
+        const QVector<int> expected = originalTerrainDistances(tileset);
+        const int count = terrainCount + 1;
+
+        for (int i = -1; i < terrainCount; ++i) {
+            for (int j = -1; j < terrainCount; ++j) {
+                const int penalty = tileset.terrainTransitionPenalty(i, j);
+                QCOMPARE(penalty, expected.at((i + 1) * count + j + 1));
+
+                if (i != -1)
+                    QCOMPARE(tileset.terrain(i)->transitionDistance(j), penalty);
+            }
+        }
+    }
+}
+
+QTEST_MAIN(test_TerrainDistances)
+#include "test_terraindistances.moc"
@@ -1,4 +1,8 @@
 TEMPLATE=subdirs
 SUBDIRS = \
+    isometricrenderer \
     mapreader \
-    staggeredrenderer
+    properties \
+    staggeredrenderer \
+    terraindistances \
+    tileregion
@@ -0,0 +1,109 @@
+#include "tileregion.h"
+
+#include <QtTest/QtTest>
+
+using namespace Tiled;
+
+class test_TileRegion : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void addAndContains();
+    void remove();
+    void combine();
+    void translate();
+    void runs();
+    void toRegion();
+};
+
+void test_TileRegion::addAndContains()
+{
+    TileRegion region;
+    QVERIFY(region.isEmpty());
+
+    region.add(QRect(-70, 2, 10, 3));
+    region.add(100, 0);
+
+    QCOMPARE(region.boundingRect(), QRect(QPoint(-70, 0), QPoint(100, 4)));
+    QCOMPARE(region.tileCount(), 31);
+    QVERIFY(region.contains(-70, 2));
+    QVERIFY(region.contains(-61, 4));
+    QVERIFY(region.contains(100, 0));
+    QVERIFY(!region.contains(-60, 2));
+    QVERIFY(!region.contains(99, 0));
+    QVERIFY(region.intersects(QRect(-62, 3, 20, 20)));
+    QVERIFY(!region.intersects(QRect(0, 0, 100, 5)));
+}
+
+void test_TileRegion::remove()
+{
+    TileRegion region(QRect(0, 0, 130, 10));
+    region.remove(QRect(0, 0, 130, 5));
+    region.remove(QRect(0, 5, 10, 5));
+
+    QCOMPARE(region.boundingRect(), QRect(10, 5, 120, 5));
+    QCOMPARE(region.tileCount(), 600);
+
+    region.remove(QRect(0, 0, 200, 200));
+    QVERIFY(region.isEmpty());
+}
+
+void test_TileRegion::combine()
+{
+    const TileRegion a(QRect(0, 0, 100, 2));
+    const TileRegion b(QRect(50, 1, 100, 2));
+
+    QCOMPARE((a | b).tileCount(), 200 + 200 - 50);
+    QCOMPARE((a & b), TileRegion(QRect(50, 1, 50, 1)));
+    QCOMPARE((a - b).tileCount(), 150);
+    QVERIFY(!(a - b).contains(50, 1));
+    QVERIFY(a.intersects(b));
+    QVERIFY(!(a - b).intersects(b));
+}
+
+void test_TileRegion::translate()
+{
+    TileRegion region(QRect(0, 0, 3, 3));
+    region.remove(QRect(1, 1, 1, 1));
+
+    const TileRegion moved = region.translated(65, -3);
+    QCOMPARE(moved.boundingRect(), QRect(65, -3, 3, 3));
+    QCOMPARE(moved.tileCount(), 8);
+    QVERIFY(!moved.contains(66, -2));
+
+    QCOMPARE(region.translated(-128, 1).translated(128, -1), region);
+}
+
+void test_TileRegion::runs()
+{
+    TileRegion region;
+
+    // A checkerboard pattern crossing several word boundaries
+    for (int y = 0; y < 4; ++y)
+        for (int x = y % 2; x < 200; x += 2)
+            region.add(x, y);
+
+    const QVector<QRect> runs = region.runs();
+    QCOMPARE(runs.size(), 400);
+    QCOMPARE(runs.first(), QRect(0, 0, 1, 1));
+    QCOMPARE(runs.last(), QRect(199, 3, 1, 1));
+
+    region.add(QRect(0, 10, 200, 1));
+    QCOMPARE(region.runs().last(), QRect(0, 10, 200, 1));
+}
+
+void test_TileRegion::toRegion()
+{
+    QRegion qregion(0, 0, 10, 10);
+    qregion += QRect(20, 0, 10, 10);
+    qregion += QRect(5, 10, 30, 2);
+
+    const TileRegion region(qregion);
+    QCOMPARE(region.rects().size(), 3);
+    QCOMPARE(region.toRegion(), qregion);
+    QCOMPARE(TileRegion(region.toRegion()), region);
+}
+
+QTEST_MAIN(test_TileRegion)
+#include "test_tileregion.moc"